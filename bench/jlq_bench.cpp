@@ -0,0 +1,432 @@
+// Microbenchmarks for the hot paths of a query, each swept over one input
+// parameter so a regression can be pinned to a component:
+//
+//   scan/*    LineScanner::nextBatch over records of growing length.
+//   match/*   Parsing and evaluating a --path/--value query (runQuery, one
+//             thread, --count) over nesting depth, array index, match rate,
+//             value type, line length and parse engine.
+//   mmap/*    MappedFile::openReadonly on a cached file plus one read per page.
+//
+// Every benchmark reports the best of --runs as bytes/s and lines/s, except
+// mmap/*, which reports microseconds per mapping: the file is mapped, not
+// read, and with huge pages a few faults map all of it, so a byte rate would
+// not compare with the others.
+//
+// Usage: jlq_bench [--filter <substring>] [--size-mib <n>] [--runs <n>]
+
+#include "LineScanner.hpp"
+#include "MappedFile.hpp"
+#include "OutputSink.hpp"
+#include "path.hpp"
+#include "Query.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+
+    enum class ValueKind
+    {
+        String,
+        Integer,
+        // Beyond 2^53, where only an exact comparison tells values apart.
+        BigInteger,
+        Decimal,
+        Bool,
+        Null,
+    };
+
+    [[nodiscard]] std::string_view kindName(ValueKind kind) noexcept
+    {
+        switch (kind)
+        {
+        case ValueKind::String:
+            return "string";
+        case ValueKind::Integer:
+            return "integer";
+        case ValueKind::BigInteger:
+            return "big_integer";
+        case ValueKind::Decimal:
+            return "decimal";
+        case ValueKind::Bool:
+            return "bool";
+        case ValueKind::Null:
+            return "null";
+        }
+        return "?";
+    }
+
+    // The records a match benchmark runs over: the queried value sits under
+    // `depth` nested objects or, with `index`, in an array at that index,
+    // after a padding string that brings lines to about `line_length` bytes.
+    struct Shape
+    {
+        std::size_t depth{1};
+        std::optional<std::size_t> index{};
+        std::size_t line_length{128};
+        std::size_t match_percent{10};
+        ValueKind kind{ValueKind::Integer};
+        jlq::ParseEngine engine{jlq::ParseEngine::Line};
+    };
+
+    // JSON for the value of a matching and of a non-matching line.
+    [[nodiscard]] std::string_view valueText(ValueKind kind, bool match) noexcept
+    {
+        switch (kind)
+        {
+        case ValueKind::String:
+            return match ? "\"hit\"" : "\"miss\"";
+        case ValueKind::Integer:
+            return match ? "42" : "43";
+        case ValueKind::BigInteger:
+            return match ? "9007199254740993" : "9007199254740992";
+        case ValueKind::Decimal:
+            return match ? "2.5" : "3.5";
+        case ValueKind::Bool:
+            return match ? "true" : "false";
+        case ValueKind::Null:
+            return match ? "null" : "0";
+        }
+        return "null";
+    }
+
+    [[nodiscard]] std::string pathText(const Shape &shape)
+    {
+        if (shape.index.has_value())
+        {
+            return "a." + std::to_string(*shape.index) + ".id";
+        }
+        std::string path = "a";
+        for (std::size_t i = 1; i < shape.depth; ++i)
+        {
+            path += ".a";
+        }
+        return path;
+    }
+
+    [[nodiscard]] std::string makeRecord(const Shape &shape, bool match)
+    {
+        std::string target;
+        const std::string_view value = valueText(shape.kind, match);
+        if (shape.index.has_value())
+        {
+            target = "[";
+            for (std::size_t i = 0; i < *shape.index; ++i)
+            {
+                target += "{\"id\":0},";
+            }
+            target += "{\"id\":" + std::string(value) + "}]";
+        }
+        else
+        {
+            for (std::size_t i = 1; i < shape.depth; ++i)
+            {
+                target += "{\"a\":";
+            }
+            target += value;
+            target.append(shape.depth - 1, '}');
+        }
+        const std::size_t fixed = target.size() + 20;
+        const std::size_t pad = (shape.line_length > fixed) ? shape.line_length - fixed : 1;
+        return "{\"pad\":\"" + std::string(pad, 'x') + "\",\"a\":" + target + "}\n";
+    }
+
+    // Input of about `size` bytes followed by the parser's padding.
+    struct Input
+    {
+        std::vector<std::byte> bytes;
+        std::size_t size{0};
+        std::size_t lines{0};
+        std::size_t matches{0};
+
+        [[nodiscard]] std::span<const std::byte> data() const noexcept { return std::span(bytes).first(size); }
+    };
+
+    [[nodiscard]] Input makeInput(const Shape &shape, std::size_t size)
+    {
+        const std::string hit = makeRecord(shape, true);
+        const std::string miss = makeRecord(shape, false);
+        Input input;
+        input.bytes.reserve(size + hit.size() + jlq::requiredInputPadding());
+        while (input.bytes.size() < size)
+        {
+            // Spreads the matches evenly, so branch prediction sees no pattern.
+            const bool match = (input.lines * 37 % 100) < shape.match_percent;
+            for (const char c : match ? hit : miss)
+            {
+                input.bytes.push_back(static_cast<std::byte>(c));
+            }
+            ++input.lines;
+            input.matches += match;
+        }
+        input.size = input.bytes.size();
+        input.bytes.resize(input.size + jlq::requiredInputPadding());
+        return input;
+    }
+
+    template <typename Fn>
+    [[nodiscard]] double bestSeconds(std::size_t runs, std::uint64_t &checksum, Fn &&fn)
+    {
+        double best = 1e300;
+        for (std::size_t r = 0; r < runs; ++r)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            checksum += fn();
+            const auto end = std::chrono::steady_clock::now();
+            best = std::min(best, std::chrono::duration<double>(end - start).count());
+        }
+        return best;
+    }
+
+    struct Options
+    {
+        std::string_view filter;
+        std::size_t size_mib{64};
+        std::size_t runs{5};
+    };
+
+    class Reporter
+    {
+    public:
+        explicit Reporter(const Options &options) : options_{options}
+        {
+            std::cout << std::left << std::setw(40) << "benchmark" << std::right << std::setw(12) << "MB/s"
+                      << std::setw(12) << "Mlines/s" << "\n";
+        }
+
+        [[nodiscard]] bool selected(std::string_view name) const noexcept
+        {
+            return name.find(options_.filter) != std::string_view::npos;
+        }
+
+        void report(std::string_view name, std::size_t bytes, std::size_t lines, double seconds)
+        {
+            std::cout << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(12) << static_cast<double>(bytes) / seconds / 1e6 << std::setprecision(2)
+                      << std::setw(12) << static_cast<double>(lines) / seconds / 1e6 << "\n";
+        }
+
+        // For benchmarks whose work is not proportional to bytes read.
+        void reportPerCall(std::string_view name, std::size_t calls, double seconds)
+        {
+            std::cout << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(12) << seconds / static_cast<double>(calls) * 1e6 << " us/call\n";
+        }
+
+    private:
+        const Options &options_;
+    };
+
+    void benchScan(Reporter &reporter, const Options &options, std::uint64_t &checksum)
+    {
+        for (const std::size_t line_length : {64, 256, 1024, 4096})
+        {
+            const std::string name = "scan/line_length:" + std::to_string(line_length);
+            if (!reporter.selected(name))
+            {
+                continue;
+            }
+            const Input input = makeInput(Shape{.line_length = line_length}, options.size_mib << 20);
+            const double seconds = bestSeconds(options.runs, checksum, [&]
+                                               {
+                jlq::LineScanner scanner(input.data());
+                std::vector<jlq::ScannedLine> lines(256);
+                std::uint64_t n = 0;
+                for (std::size_t count = scanner.nextBatch(lines); count != 0; count = scanner.nextBatch(lines))
+                {
+                    for (std::size_t i = 0; i < count; ++i)
+                    {
+                        n += lines[i].json.size();
+                    }
+                }
+                return n; });
+            reporter.report(name, input.size, input.lines, seconds);
+        }
+    }
+
+    // Returns false if the query found other matches than the input holds.
+    [[nodiscard]] bool benchMatch(Reporter &reporter, const Options &options, std::uint64_t &checksum,
+                                  const std::string &name, const Shape &shape)
+    {
+        if (!reporter.selected(name))
+        {
+            return true;
+        }
+        const Input input = makeInput(shape, options.size_mib << 20);
+        // The query's keys view `path`, which outlives the runs.
+        const std::string path = pathText(shape);
+        jlq::QueryConfig config;
+        config.path_segments = jlq::parseDotPath(path);
+        config.output = jlq::OutputMode::Count;
+        config.engine = shape.engine;
+        switch (shape.kind)
+        {
+        case ValueKind::String:
+            config.value = std::string_view("hit");
+            break;
+        case ValueKind::Integer:
+            config.value = 42.0;
+            config.integer_value = jlq::IntegerValue{42, 0, false};
+            break;
+        case ValueKind::BigInteger:
+            config.value = 9007199254740993.0;
+            config.integer_value = jlq::IntegerValue{9007199254740993, 0, false};
+            break;
+        case ValueKind::Decimal:
+            config.value = 2.5;
+            break;
+        case ValueKind::Bool:
+            config.value = true;
+            break;
+        case ValueKind::Null:
+            config.value = std::monostate{};
+            break;
+        }
+
+        std::size_t matches = 0;
+        const double seconds = bestSeconds(options.runs, checksum, [&]
+                                           {
+            std::ostringstream out;
+            jlq::StreamSink sink(out);
+            jlq::QueryStats stats;
+            static_cast<void>(jlq::runQuery(jlq::QueryInput{input.data(), jlq::requiredInputPadding()}, config, sink, stats));
+            matches = stats.matches;
+            return stats.matches; });
+        reporter.report(name, input.size, input.lines, seconds);
+        if (matches != input.matches)
+        {
+            std::cerr << name << ": " << matches << " matches, expected " << input.matches << "\n";
+            return false;
+        }
+        return true;
+    }
+
+    [[nodiscard]] bool benchMatches(Reporter &reporter, const Options &options, std::uint64_t &checksum)
+    {
+        bool ok = true;
+        for (const std::size_t depth : {1, 2, 4, 8})
+        {
+            ok &= benchMatch(reporter, options, checksum, "match/depth:" + std::to_string(depth), Shape{.depth = depth});
+        }
+        for (const std::size_t index : {0, 4, 16, 64})
+        {
+            ok &= benchMatch(reporter, options, checksum, "match/index:" + std::to_string(index),
+                             Shape{.index = index, .line_length = 1024});
+        }
+        for (const std::size_t percent : {0, 1, 10, 50, 100})
+        {
+            ok &= benchMatch(reporter, options, checksum, "match/rate:" + std::to_string(percent),
+                             Shape{.match_percent = percent});
+        }
+        for (const ValueKind kind : {ValueKind::String, ValueKind::Integer, ValueKind::BigInteger, ValueKind::Decimal,
+                                     ValueKind::Bool, ValueKind::Null})
+        {
+            ok &= benchMatch(reporter, options, checksum, "match/type:" + std::string(kindName(kind)),
+                             Shape{.kind = kind});
+        }
+        for (const std::size_t line_length : {64, 256, 1024, 4096})
+        {
+            ok &= benchMatch(reporter, options, checksum, "match/line_length:" + std::to_string(line_length),
+                             Shape{.line_length = line_length});
+        }
+        ok &= benchMatch(reporter, options, checksum, "match/engine:line", Shape{.line_length = 64});
+        ok &= benchMatch(reporter, options, checksum, "match/engine:stream",
+                         Shape{.line_length = 64, .engine = jlq::ParseEngine::Stream});
+        return ok;
+    }
+
+    void benchMap(Reporter &reporter, const Options &options, std::uint64_t &checksum)
+    {
+        for (const std::size_t size_mib : {1, 16, 128})
+        {
+            const std::string name = "mmap/size_mib:" + std::to_string(size_mib);
+            if (!reporter.selected(name))
+            {
+                continue;
+            }
+            const Input input = makeInput(Shape{}, size_mib << 20);
+            const std::filesystem::path file =
+                std::filesystem::temp_directory_path() / ("jlq_bench_" + std::to_string(::getpid()) + ".jsonl");
+            {
+                std::ofstream out(file, std::ios::binary);
+                out.write(reinterpret_cast<const char *>(input.bytes.data()), static_cast<std::streamsize>(input.size));
+            }
+            // Small files are mapped many times per run, so opening dominates.
+            const std::size_t repeat = std::max<std::size_t>(1, 128 / size_mib);
+            const auto page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+            const double seconds = bestSeconds(options.runs, checksum, [&]
+                                               {
+                std::uint64_t n = 0;
+                for (std::size_t r = 0; r < repeat; ++r)
+                {
+                    const jlq::MappedFile mf = jlq::MappedFile::openReadonly(file.string(), jlq::requiredInputPadding());
+                    const std::span<const std::byte> bytes = mf.bytes();
+                    for (std::size_t i = 0; i < bytes.size(); i += page_size)
+                    {
+                        n += static_cast<std::uint64_t>(bytes[i]);
+                    }
+                }
+                return n; });
+            std::filesystem::remove(file);
+            reporter.reportPerCall(name, repeat, seconds);
+        }
+    }
+
+    [[nodiscard]] bool parseSize(std::string_view s, std::size_t &out)
+    {
+        const auto result = std::from_chars(s.data(), s.data() + s.size(), out);
+        return result.ec == std::errc{} && result.ptr == s.data() + s.size() && out > 0;
+    }
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const std::string_view flag = argv[i];
+        const std::string_view value = argv[i + 1];
+        if (flag == "--filter")
+        {
+            options.filter = value;
+            continue;
+        }
+        std::size_t *target = (flag == "--size-mib") ? &options.size_mib : (flag == "--runs") ? &options.runs
+                                                                                               : nullptr;
+        if (target == nullptr || !parseSize(value, *target))
+        {
+            std::cerr << "Usage: jlq_bench [--filter <substring>] [--size-mib <n>] [--runs <n>]\n";
+            return 1;
+        }
+    }
+    if (argc % 2 == 0)
+    {
+        std::cerr << "Usage: jlq_bench [--filter <substring>] [--size-mib <n>] [--runs <n>]\n";
+        return 1;
+    }
+
+    Reporter reporter(options);
+    std::uint64_t checksum = 0;
+    benchScan(reporter, options, checksum);
+    const bool ok = benchMatches(reporter, options, checksum);
+    benchMap(reporter, options, checksum);
+    std::cout << "(checksum " << checksum << ")\n";
+    return ok ? 0 : 1;
+}
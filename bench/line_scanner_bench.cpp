@@ -0,0 +1,174 @@
+// Microbenchmark: newline scanning throughput of LineScanner versus the original
+// byte-at-a-time loop.
+//
+// Usage: line_scanner_bench [--size-mib <n>] [--line-length <n>] [--runs <n>]
+
+#include "LineScanner.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+
+    // The scanner loop LineScanner used before the SIMD kernel, kept as the baseline.
+    class ByteLoopScanner
+    {
+    public:
+        explicit ByteLoopScanner(std::span<const std::byte> bytes) noexcept : bytes_{bytes} {}
+
+        bool next(jlq::ScannedLine &out) noexcept
+        {
+            while (offset_ < bytes_.size())
+            {
+                const std::size_t line_begin = offset_;
+                std::size_t line_end = line_begin;
+                bool had_newline = false;
+                for (; line_end < bytes_.size(); ++line_end)
+                {
+                    if (bytes_[line_end] == static_cast<std::byte>('\n'))
+                    {
+                        had_newline = true;
+                        break;
+                    }
+                }
+                offset_ = had_newline ? (line_end + 1) : line_end;
+
+                const std::size_t raw_len = line_end - line_begin;
+                if (raw_len == 0)
+                {
+                    continue;
+                }
+
+                out = {};
+                out.had_newline = had_newline;
+                out.oversized = (raw_len > jlq::LineScanner::max_line_length);
+                out.raw = bytes_.subspan(line_begin, raw_len);
+                out.json = (out.raw.back() == static_cast<std::byte>('\r')) ? out.raw.first(raw_len - 1) : out.raw;
+                if (out.json.empty())
+                {
+                    continue;
+                }
+                return true;
+            }
+            return false;
+        }
+
+    private:
+        std::span<const std::byte> bytes_;
+        std::size_t offset_{0};
+    };
+
+    [[nodiscard]] std::vector<std::byte> makeInput(std::size_t size, std::size_t line_length)
+    {
+        const std::string line_text = "{\"a\":{\"b\":\"" + std::string(line_length > 16 ? line_length - 16 : 1, 'x') + "\"}}\n";
+        std::vector<std::byte> input;
+        input.reserve(size + line_text.size());
+        while (input.size() < size)
+        {
+            for (const char c : line_text)
+            {
+                input.push_back(static_cast<std::byte>(c));
+            }
+        }
+        return input;
+    }
+
+    template <typename Fn>
+    [[nodiscard]] double bestSeconds(std::size_t runs, std::uint64_t &checksum, Fn &&fn)
+    {
+        double best = 1e300;
+        for (std::size_t r = 0; r < runs; ++r)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            checksum += fn();
+            const auto end = std::chrono::steady_clock::now();
+            best = std::min(best, std::chrono::duration<double>(end - start).count());
+        }
+        return best;
+    }
+
+    [[nodiscard]] bool parseSize(std::string_view s, std::size_t &out)
+    {
+        const auto result = std::from_chars(s.data(), s.data() + s.size(), out);
+        return result.ec == std::errc{} && result.ptr == s.data() + s.size() && out > 0;
+    }
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::size_t size_mib = 256;
+    std::size_t line_length = 256;
+    std::size_t runs = 5;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const std::string_view flag = argv[i];
+        const std::string_view value = argv[i + 1];
+        std::size_t *target = (flag == "--size-mib") ? &size_mib : (flag == "--line-length") ? &line_length
+                                                               : (flag == "--runs")          ? &runs
+                                                                                             : nullptr;
+        if (target == nullptr || !parseSize(value, *target))
+        {
+            std::cerr << "Usage: line_scanner_bench [--size-mib <n>] [--line-length <n>] [--runs <n>]\n";
+            return 1;
+        }
+    }
+
+    const std::vector<std::byte> input = makeInput(size_mib * 1024 * 1024, line_length);
+    const std::span<const std::byte> bytes(input);
+    std::uint64_t checksum = 0;
+
+    const double byte_loop = bestSeconds(runs, checksum, [&]
+                                         {
+        ByteLoopScanner scanner(bytes);
+        jlq::ScannedLine line;
+        std::uint64_t n = 0;
+        while (scanner.next(line))
+        {
+            n += line.json.size();
+        }
+        return n; });
+
+    const double next = bestSeconds(runs, checksum, [&]
+                                    {
+        jlq::LineScanner scanner(bytes);
+        jlq::ScannedLine line;
+        std::uint64_t n = 0;
+        while (scanner.next(line))
+        {
+            n += line.json.size();
+        }
+        return n; });
+
+    const double batch = bestSeconds(runs, checksum, [&]
+                                     {
+        jlq::LineScanner scanner(bytes);
+        std::vector<jlq::ScannedLine> lines(256);
+        std::uint64_t n = 0;
+        for (std::size_t count = scanner.nextBatch(lines); count != 0; count = scanner.nextBatch(lines))
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                n += lines[i].json.size();
+            }
+        }
+        return n; });
+
+    const double gb = static_cast<double>(input.size()) / 1e9;
+    std::cout << "input: " << input.size() << " bytes, ~" << line_length << " bytes/line, best of " << runs << "\n";
+    std::cout << "byte loop              " << gb / byte_loop << " GB/s\n";
+    std::cout << "LineScanner::next      " << gb / next << " GB/s\n";
+    std::cout << "LineScanner::nextBatch " << gb / batch << " GB/s\n";
+    std::cout << "(checksum " << checksum << ")\n";
+    return 0;
+}
@@ -8,6 +8,8 @@ namespace jlq
 {
 
     int run(std::span<const std::string_view> args, std::ostream &out, std::ostream &err);
+    // Writes matches to `out_fd` instead of `out` unless it is -1.
+    int run(std::span<const std::string_view> args, std::ostream &out, std::ostream &err, int out_fd);
     int run(std::span<const std::string_view> args);
 
 } // namespace jlq
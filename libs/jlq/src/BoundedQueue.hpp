@@ -0,0 +1,145 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <utility>
+
+namespace jlq
+{
+
+    // Bounded lock-free multi-producer/multi-consumer queue.
+    // Implementation follows Dmitry Vyukov's design: a power-of-two ring of cells,
+    // each carrying a sequence number that tells producers and consumers whether
+    // the cell is free or filled for their current lap. Push and pop each cost one
+    // CAS on the shared position plus one release store on the cell.
+    //
+    // `T` must be default-constructible and move-assignable. Values stay in their
+    // cell until popped, so memory is bounded by `capacity` elements.
+    template <typename T>
+    class BoundedQueue
+    {
+    public:
+        explicit BoundedQueue(std::size_t capacity)
+            : capacity_{std::bit_ceil(capacity < 2 ? std::size_t{2} : capacity)},
+              cells_{std::make_unique<Cell[]>(capacity_)}
+        {
+            for (std::size_t i = 0; i < capacity_; ++i)
+            {
+                cells_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        BoundedQueue(const BoundedQueue &) = delete;
+        BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+        // Moves `value` into the queue. Returns false (leaving `value` untouched)
+        // when the queue is full.
+        [[nodiscard]] bool tryPush(T &value)
+        {
+            std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                Cell &cell = cells_[pos & (capacity_ - 1)];
+                const std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+                if (seq == pos)
+                {
+                    if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        cell.value = std::move(value);
+                        cell.sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (seq < pos)
+                {
+                    return false;
+                }
+                else
+                {
+                    pos = enqueue_pos_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Moves the oldest element into `out`. Returns false when the queue is empty.
+        [[nodiscard]] bool tryPop(T &out)
+        {
+            std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                Cell &cell = cells_[pos & (capacity_ - 1)];
+                const std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+                if (seq == pos + 1)
+                {
+                    if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        out = std::move(cell.value);
+                        cell.sequence.store(pos + capacity_, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (seq < pos + 1)
+                {
+                    return false;
+                }
+                else
+                {
+                    pos = dequeue_pos_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        [[nodiscard]] std::size_t capacity() const noexcept { return capacity_; }
+
+    private:
+        struct Cell
+        {
+            std::atomic<std::size_t> sequence{0};
+            T value{};
+        };
+
+        // Keeps the producer and consumer positions on separate cache lines.
+        static constexpr std::size_t cache_line = 64;
+
+        std::size_t capacity_;
+        std::unique_ptr<Cell[]> cells_;
+        alignas(cache_line) std::atomic<std::size_t> enqueue_pos_{0};
+        alignas(cache_line) std::atomic<std::size_t> dequeue_pos_{0};
+    };
+
+    // Escalating wait used by pipeline stages while a queue is full or empty:
+    // spin briefly, then yield, then sleep so a stalled stage (e.g. a writer blocked
+    // on a slow pipe) does not keep the other cores busy.
+    class Backoff
+    {
+    public:
+        void pause() noexcept
+        {
+            if (step_ < spin_steps)
+            {
+                ++step_;
+                return;
+            }
+            if (step_ < spin_steps + yield_steps)
+            {
+                ++step_;
+                std::this_thread::yield();
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+
+        void reset() noexcept { step_ = 0; }
+
+    private:
+        static constexpr unsigned spin_steps = 64;
+        static constexpr unsigned yield_steps = 64;
+
+        unsigned step_{0};
+    };
+
+} // namespace jlq
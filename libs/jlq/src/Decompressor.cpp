@@ -0,0 +1,150 @@
+#include "Decompressor.hpp"
+
+#include <zlib.h>
+#include <zstd.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace jlq
+{
+
+    namespace
+    {
+
+        constexpr std::uint8_t gzip_magic[] = {0x1f, 0x8b};
+        constexpr std::uint8_t zstd_magic[] = {0x28, 0xb5, 0x2f, 0xfd};
+
+        [[nodiscard]] bool startsWith(std::span<const std::byte> bytes, std::span<const std::uint8_t> magic) noexcept
+        {
+            return bytes.size() >= magic.size() &&
+                   std::equal(magic.begin(), magic.end(), bytes.begin(), [](std::uint8_t m, std::byte b)
+                              { return static_cast<std::uint8_t>(b) == m; });
+        }
+
+    } // namespace
+
+    Compression detectCompression(std::span<const std::byte> prefix) noexcept
+    {
+        if (startsWith(prefix, gzip_magic))
+        {
+            return Compression::Gzip;
+        }
+        if (startsWith(prefix, zstd_magic))
+        {
+            return Compression::Zstd;
+        }
+        return Compression::None;
+    }
+
+    struct Decompressor::State
+    {
+        Compression compression;
+        std::span<const std::byte> input;
+        std::size_t consumed{0};
+        z_stream gzip{};
+        ZSTD_DCtx *zstd{nullptr};
+        // Whether the current gzip member or zstd frame is complete.
+        bool frame_done{true};
+    };
+
+    Decompressor::Decompressor(std::span<const std::byte> compressed, Compression compression)
+        : state_{std::make_unique<State>()}
+    {
+        state_->compression = compression;
+        state_->input = compressed;
+        if (compression == Compression::Gzip)
+        {
+            // 16 + MAX_WBITS: gzip framing only.
+            if (inflateInit2(&state_->gzip, 16 + MAX_WBITS) != Z_OK)
+            {
+                throw std::runtime_error("gzip: cannot initialize decoder");
+            }
+        }
+        else
+        {
+            state_->zstd = ZSTD_createDCtx();
+            if (state_->zstd == nullptr)
+            {
+                throw std::runtime_error("zstd: cannot initialize decoder");
+            }
+        }
+    }
+
+    Decompressor::~Decompressor()
+    {
+        if (state_->compression == Compression::Gzip)
+        {
+            inflateEnd(&state_->gzip);
+        }
+        else
+        {
+            ZSTD_freeDCtx(state_->zstd);
+        }
+    }
+
+    std::size_t Decompressor::read(std::span<std::byte> out)
+    {
+        State &s = *state_;
+        std::size_t produced = 0;
+        while (produced < out.size())
+        {
+            const std::span<const std::byte> rest = s.input.subspan(s.consumed);
+            if (rest.empty())
+            {
+                if (!s.frame_done)
+                {
+                    throw std::runtime_error(s.compression == Compression::Gzip ? "gzip: unexpected end of input"
+                                                                                 : "zstd: unexpected end of input");
+                }
+                break;
+            }
+
+            if (s.compression == Compression::Gzip)
+            {
+                if (s.frame_done && inflateReset(&s.gzip) != Z_OK)
+                {
+                    throw std::runtime_error("gzip: cannot reset decoder");
+                }
+                // zlib counts in uInt.
+                s.gzip.next_in = reinterpret_cast<Bytef *>(const_cast<std::byte *>(rest.data()));
+                s.gzip.avail_in = static_cast<uInt>(std::min<std::size_t>(rest.size(), UINT_MAX));
+                s.gzip.next_out = reinterpret_cast<Bytef *>(out.data() + produced);
+                s.gzip.avail_out = static_cast<uInt>(std::min<std::size_t>(out.size() - produced, UINT_MAX));
+                const uInt avail_in = s.gzip.avail_in;
+                const uInt avail_out = s.gzip.avail_out;
+                const int rc = inflate(&s.gzip, Z_NO_FLUSH);
+                if (rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR)
+                {
+                    throw std::runtime_error(std::string("gzip: ") + (s.gzip.msg != nullptr ? s.gzip.msg : "invalid data"));
+                }
+                s.consumed += avail_in - s.gzip.avail_in;
+                produced += avail_out - s.gzip.avail_out;
+                s.frame_done = (rc == Z_STREAM_END);
+                if (rc == Z_BUF_ERROR && avail_in == s.gzip.avail_in && avail_out == s.gzip.avail_out)
+                {
+                    throw std::runtime_error("gzip: invalid data");
+                }
+            }
+            else
+            {
+                ZSTD_inBuffer in{rest.data(), rest.size(), 0};
+                ZSTD_outBuffer out_buffer{out.data() + produced, out.size() - produced, 0};
+                const std::size_t rc = ZSTD_decompressStream(s.zstd, &out_buffer, &in);
+                if (ZSTD_isError(rc) != 0)
+                {
+                    throw std::runtime_error(std::string("zstd: ") + ZSTD_getErrorName(rc));
+                }
+                s.consumed += in.pos;
+                produced += out_buffer.pos;
+                // 0 once a frame is fully decoded and flushed.
+                s.frame_done = (rc == 0);
+            }
+        }
+        return produced;
+    }
+
+} // namespace jlq
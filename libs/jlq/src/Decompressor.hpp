@@ -0,0 +1,43 @@
+#pragma once
+
+#include "WindowReader.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <span>
+
+namespace jlq
+{
+
+    enum class Compression
+    {
+        None,
+        Gzip,
+        Zstd,
+    };
+
+    // Format of data starting with `prefix`, by its magic bytes.
+    [[nodiscard]] Compression detectCompression(std::span<const std::byte> prefix) noexcept;
+
+    // Streams the decompressed contents of gzip or zstd data, including
+    // concatenated members/frames as written by `pigz` or `zstd -T`.
+    class Decompressor final : public ByteSource
+    {
+    public:
+        // `compressed` (not Compression::None) must outlive the decompressor.
+        Decompressor(std::span<const std::byte> compressed, Compression compression);
+        ~Decompressor() override;
+
+        Decompressor(const Decompressor &) = delete;
+        Decompressor &operator=(const Decompressor &) = delete;
+
+        // Throws std::runtime_error for corrupt or truncated input.
+        std::size_t read(std::span<std::byte> out) override;
+
+    private:
+        struct State;
+
+        std::unique_ptr<State> state_;
+    };
+
+} // namespace jlq
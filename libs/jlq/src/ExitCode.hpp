@@ -9,6 +9,8 @@ namespace jlq
         UsageError = 1,
         OsError = 2,
         ParseError = 3,
+        // --quiet only: no line matched.
+        NoMatch = 4,
     };
 
 } // namespace jlq
@@ -0,0 +1,560 @@
+#include "FileSet.hpp"
+#include "BoundedQueue.hpp"
+#include "Decompressor.hpp"
+#include "LineIndex.hpp"
+#include "MappedFile.hpp"
+#include "Sidecar.hpp"
+#include "ValueIndex.hpp"
+#include "WindowReader.hpp"
+#include "ZoneMap.hpp"
+
+#include <glob.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace jlq
+{
+
+    namespace
+    {
+
+        // Files above this size are split into chunks of about this size.
+        constexpr std::size_t chunk_bytes = 4ULL << 20;
+        // Tasks that may run ahead of the oldest unwritten one, per worker. Bounds
+        // the open files and the buffered output.
+        constexpr std::size_t in_flight_tasks_per_thread = 2;
+
+        [[nodiscard]] bool isPattern(std::string_view input) noexcept
+        {
+            return input.find_first_of("*?[") != std::string_view::npos;
+        }
+
+        void appendDirectory(const std::filesystem::path &dir, std::vector<std::string> &out)
+        {
+            std::vector<std::string> files;
+            for (const auto &entry : std::filesystem::recursive_directory_iterator(dir))
+            {
+                if (entry.is_regular_file() && !isSidecarPath(entry.path().native()))
+                {
+                    files.push_back(entry.path().string());
+                }
+            }
+            std::sort(files.begin(), files.end());
+            out.insert(out.end(), std::make_move_iterator(files.begin()), std::make_move_iterator(files.end()));
+        }
+
+        // Appends the paths matching the shell pattern `pattern`, sorted.
+        void appendGlob(const std::string &pattern, std::vector<std::string> &out)
+        {
+            glob_t matches{};
+            const int rc = ::glob(pattern.c_str(), 0, nullptr, &matches);
+            if (rc != 0)
+            {
+                ::globfree(&matches);
+                throw std::runtime_error(pattern + ": no matching files");
+            }
+            for (std::size_t i = 0; i < matches.gl_pathc; ++i)
+            {
+                const std::filesystem::path match(matches.gl_pathv[i]);
+                if (std::filesystem::is_directory(match))
+                {
+                    appendDirectory(match, out);
+                }
+                else if (!isSidecarPath(match.native()))
+                {
+                    out.push_back(match.string());
+                }
+            }
+            ::globfree(&matches);
+        }
+
+        // A data file while any of its tasks is in flight.
+        struct OpenFile
+        {
+            OpenFile(const std::string &path, const FileSetOptions &options)
+                : mapping{MappedFile::openReadonly(path, requiredInputPadding())},
+                  compression{detectCompression(mapping.bytes())},
+                  release{options.release_files}
+            {
+                if (compression != Compression::None)
+                {
+                    return;
+                }
+                // Missing or stale indexes are ignored, as for a single file.
+                const FileStamp stamp = stampOf(mapping.fd());
+                line_index = LineIndex::open(lineIndexPath(path), stamp);
+                if (!options.value_path.empty())
+                {
+                    value_index = ValueIndex::open(valueIndexPath(path, options.value_path), stamp, options.value_path);
+                }
+                zone_map = ZoneMap::open(zoneMapPath(path), stamp);
+            }
+
+            OpenFile(const OpenFile &) = delete;
+            OpenFile &operator=(const OpenFile &) = delete;
+
+            // Runs once the last task of the file is done.
+            ~OpenFile()
+            {
+                if (release)
+                {
+                    mapping.release(0, mapping.size());
+                }
+            }
+
+            // Whether the file is queried by one task: the decompressor and the
+            // indexes each read the file as a whole.
+            [[nodiscard]] bool wholeFile() const noexcept
+            {
+                return compression != Compression::None || value_index.has_value() || zone_map.has_value() ||
+                       mapping.size() <= chunk_bytes;
+            }
+
+            MappedFile mapping;
+            Compression compression;
+            std::optional<LineIndex> line_index;
+            std::optional<ValueIndex> value_index;
+            std::optional<ZoneMap> zone_map;
+            bool release;
+        };
+
+        struct FileTask
+        {
+            std::size_t seq{0};
+            std::size_t file_index{0};
+            std::shared_ptr<OpenFile> file;
+            // Byte range of the chunk; its lines are those starting inside it.
+            // Unused for whole-file tasks.
+            std::size_t begin{0};
+            std::size_t end{0};
+            bool whole{true};
+            bool last_of_file{true};
+            // The file could not be opened; the task only hands this on.
+            std::exception_ptr error;
+        };
+
+        struct TaskResult
+        {
+            std::size_t seq{0};
+            std::size_t file_index{0};
+            bool last_of_file{true};
+            // Matching lines (OutputMode::Lines), each ending in '\n'.
+            std::string output;
+            std::size_t matches{0};
+            // The task's --group-by counts and --distinct sketch.
+            GroupCounts groups;
+            HyperLogLog distinct;
+            QueryStatus status{QueryStatus::Ok};
+            std::exception_ptr error;
+        };
+
+        // Offset of the first line start at or after `offset`.
+        [[nodiscard]] std::size_t lineStartFrom(std::span<const std::byte> bytes, std::size_t offset) noexcept
+        {
+            if (offset == 0 || offset >= bytes.size())
+            {
+                return std::min(offset, bytes.size());
+            }
+            const void *nl = std::memchr(bytes.data() + offset - 1, '\n', bytes.size() - offset + 1);
+            return (nl == nullptr) ? bytes.size()
+                                   : static_cast<std::size_t>(static_cast<const std::byte *>(nl) - bytes.data()) + 1;
+        }
+
+        void runTask(const FileTask &task, const QueryConfig &config, std::string_view prefix, TaskResult &result)
+        {
+            BufferSink sink{std::string(prefix)};
+            QueryStats stats;
+            OpenFile &file = *task.file;
+            if (file.compression != Compression::None)
+            {
+                Decompressor decompressor(file.mapping.bytes(), file.compression);
+                WindowReader reader(decompressor, requiredInputPadding());
+                result.status = runQuery(reader, config, sink, stats);
+            }
+            else if (task.whole)
+            {
+                file.mapping.adviseSequential();
+                const QueryInput input{file.mapping.bytes(),
+                                       file.mapping.padding(),
+                                       file.line_index ? &*file.line_index : nullptr,
+                                       file.value_index ? &*file.value_index : nullptr,
+                                       file.zone_map ? &*file.zone_map : nullptr,
+                                       &file.mapping,
+                                       0};
+                result.status = runQuery(input, config, sink, stats);
+            }
+            else
+            {
+                const std::span<const std::byte> bytes = file.mapping.bytes();
+                const std::size_t begin = lineStartFrom(bytes, task.begin);
+                const std::size_t end = lineStartFrom(bytes, task.end);
+                if (begin < end)
+                {
+                    // Lines are parsed in place up to the mapping's own padding.
+                    const QueryInput input{bytes.subspan(begin, end - begin), bytes.size() - end + file.mapping.padding()};
+                    result.status = runQuery(input, config, sink, stats);
+                }
+            }
+            sink.flush();
+            result.output = std::move(sink.buffer());
+            // Only a file's last line can lack its newline; the next file's
+            // output must not run into it.
+            if (!result.output.empty() && result.output.back() != '\n')
+            {
+                result.output.push_back('\n');
+            }
+            result.matches = stats.matches;
+            result.groups = std::move(stats.groups);
+            result.distinct = std::move(stats.distinct);
+        }
+
+        // Runs `task`, capturing a failure as the result's error with `path`
+        // in its message.
+        void runGuarded(const FileTask &task, const QueryConfig &config, std::string_view prefix,
+                        const std::string &path, TaskResult &result)
+        {
+            try
+            {
+                runTask(task, config, prefix, result);
+            }
+            catch (const std::exception &e)
+            {
+                result.error = std::make_exception_ptr(std::runtime_error(path + ": " + e.what()));
+            }
+            catch (...)
+            {
+                result.error = std::current_exception();
+            }
+        }
+
+        struct Scheduler
+        {
+            explicit Scheduler(std::size_t max_in_flight)
+                : max_in_flight{max_in_flight}, tasks{max_in_flight}, results{max_in_flight} {}
+
+            const std::size_t max_in_flight;
+            BoundedQueue<FileTask> tasks;
+            BoundedQueue<TaskResult> results;
+            // Set once every task has been queued, or the run is over.
+            std::atomic<bool> done{false};
+            // The run is decided; remaining tasks need not run.
+            std::atomic<bool> cancelled{false};
+        };
+
+        void workerLoop(Scheduler &s, std::span<const std::string> paths, const QueryConfig &config,
+                        const FileSetOptions &options)
+        {
+            FileTask task;
+            Backoff backoff;
+            for (;;)
+            {
+                const bool done = s.done.load(std::memory_order_acquire);
+                if (!s.tasks.tryPop(task))
+                {
+                    if (done)
+                    {
+                        return;
+                    }
+                    backoff.pause();
+                    continue;
+                }
+                backoff.reset();
+                if (s.cancelled.load(std::memory_order_acquire))
+                {
+                    // The run is decided; nobody reads the result.
+                    task = FileTask{};
+                    continue;
+                }
+
+                TaskResult result;
+                result.seq = task.seq;
+                result.file_index = task.file_index;
+                result.last_of_file = task.last_of_file;
+                const std::string &path = paths[task.file_index];
+                if (task.error)
+                {
+                    result.error = std::move(task.error);
+                }
+                else
+                {
+                    runGuarded(task, config, options.with_filename ? path + ":" : std::string{}, path, result);
+                }
+                // Unmaps the file (or drops a reference) before the writer sees
+                // the result, so the open file count stays bounded.
+                task = FileTask{};
+
+                // There is room: at most `max_in_flight` tasks are outstanding.
+                while (!s.results.tryPush(result))
+                {
+                    backoff.pause();
+                }
+                backoff.reset();
+            }
+        }
+
+        // Hands out the tasks of `paths` in order, opening each file when its
+        // first task is created.
+        class TaskSource
+        {
+        public:
+            TaskSource(std::span<const std::string> paths, const FileSetOptions &options) noexcept
+                : paths_{paths}, options_{options} {}
+
+            [[nodiscard]] bool next(FileTask &task)
+            {
+                if (chunk_ == chunks_)
+                {
+                    file_.reset();
+                    if (file_index_ == paths_.size())
+                    {
+                        return false;
+                    }
+                    open(file_index_++);
+                }
+
+                task = FileTask{};
+                task.seq = seq_++;
+                task.file_index = file_index_ - 1;
+                task.file = file_;
+                // A file that failed to open is one task, the sole owner of its error.
+                task.error = std::move(error_);
+                task.whole = (chunks_ == 1);
+                task.begin = chunk_ * chunk_bytes;
+                task.end = (chunk_ + 1) * chunk_bytes;
+                task.last_of_file = (++chunk_ == chunks_);
+                return true;
+            }
+
+        private:
+            void open(std::size_t index)
+            {
+                error_ = nullptr;
+                chunk_ = 0;
+                chunks_ = 1;
+                try
+                {
+                    file_ = std::make_shared<OpenFile>(paths_[index], options_);
+                    if (!file_->wholeFile())
+                    {
+                        chunks_ = (file_->mapping.size() + chunk_bytes - 1) / chunk_bytes;
+                    }
+                }
+                catch (const std::exception &e)
+                {
+                    error_ = std::make_exception_ptr(std::runtime_error(paths_[index] + ": " + e.what()));
+                }
+            }
+
+            std::span<const std::string> paths_;
+            const FileSetOptions &options_;
+            std::size_t file_index_{0};
+            std::size_t seq_{0};
+            std::shared_ptr<OpenFile> file_;
+            std::exception_ptr error_;
+            std::size_t chunk_{0};
+            std::size_t chunks_{0};
+        };
+
+        // The first `lines` lines of `text`.
+        [[nodiscard]] std::string_view firstLines(std::string_view text, std::size_t lines) noexcept
+        {
+            std::size_t end = 0;
+            for (std::size_t i = 0; i < lines && end < text.size(); ++i)
+            {
+                const std::size_t newline = text.find('\n', end);
+                end = (newline == std::string_view::npos) ? text.size() : newline + 1;
+            }
+            return text.substr(0, end);
+        }
+
+        // Consumes results in order on the calling thread, refilling the task
+        // queue as the window moves. Returns the final status.
+        QueryStatus writeResults(Scheduler &s, TaskSource &source, std::span<const std::string> paths,
+                                 const QueryConfig &config, const FileSetOptions &options, OutputSink &out,
+                                 QueryStats &stats)
+        {
+            const std::size_t limit = matchLimit(config);
+            std::vector<std::optional<TaskResult>> pending(s.max_in_flight);
+            std::size_t queued = 0;
+            std::size_t written = 0;
+            std::size_t file_matches = 0;
+            bool exhausted = false;
+            FileTask task;
+            TaskResult result;
+            Backoff backoff;
+
+            auto writeCount = [&](std::size_t file_index)
+            {
+                if (config.output == OutputMode::Count && options.with_filename)
+                {
+                    const std::string text = paths[file_index] + ":" + std::to_string(file_matches) + "\n";
+                    out.write(std::as_bytes(std::span(text)));
+                }
+                file_matches = 0;
+            };
+
+            // Returns the final status once the run is decided.
+            auto emit = [&](TaskResult &r) -> std::optional<QueryStatus>
+            {
+                ++written;
+                if (r.error)
+                {
+                    std::rethrow_exception(r.error);
+                }
+                const std::size_t take = std::min(r.matches, limit - stats.matches);
+                if (config.output == OutputMode::Lines)
+                {
+                    const std::string_view text =
+                        (take == r.matches) ? std::string_view(r.output) : firstLines(r.output, take);
+                    out.write(std::as_bytes(std::span(text)));
+                }
+                stats.matches += take;
+                stats.groups.merge(r.groups);
+                stats.distinct.merge(r.distinct);
+                file_matches += take;
+
+                const bool finished = (stats.matches == limit) || (r.status == QueryStatus::ParseError);
+                if (r.last_of_file || finished)
+                {
+                    writeCount(r.file_index);
+                }
+                if (finished)
+                {
+                    return r.status;
+                }
+                return std::nullopt;
+            };
+
+            for (;;)
+            {
+                while (!exhausted && queued < written + s.max_in_flight)
+                {
+                    if (!source.next(task))
+                    {
+                        exhausted = true;
+                        s.done.store(true, std::memory_order_release);
+                        break;
+                    }
+                    while (!s.tasks.tryPush(task))
+                    {
+                        backoff.pause();
+                    }
+                    ++queued;
+                }
+                if (exhausted && written == queued)
+                {
+                    return QueryStatus::Ok;
+                }
+
+                if (!s.results.tryPop(result))
+                {
+                    backoff.pause();
+                    continue;
+                }
+                backoff.reset();
+
+                pending[result.seq % s.max_in_flight] = std::move(result);
+                for (auto *slot = &pending[written % s.max_in_flight];
+                     slot->has_value() && (*slot)->seq == written;
+                     slot = &pending[written % s.max_in_flight])
+                {
+                    TaskResult ready = std::move(**slot);
+                    slot->reset();
+                    if (const auto status = emit(ready))
+                    {
+                        return (stats.matches == limit) ? QueryStatus::Ok : *status;
+                    }
+                }
+            }
+        }
+
+    } // namespace
+
+    std::vector<std::string> expandInputPaths(std::span<const std::string_view> inputs)
+    {
+        std::vector<std::string> paths;
+        for (const std::string_view input : inputs)
+        {
+            const std::filesystem::path path(input);
+            std::error_code ec;
+            if (std::filesystem::is_directory(path, ec))
+            {
+                appendDirectory(path, paths);
+            }
+            else if (isPattern(input) && !std::filesystem::exists(path, ec))
+            {
+                appendGlob(std::string(input), paths);
+            }
+            else
+            {
+                paths.emplace_back(input);
+            }
+        }
+        return paths;
+    }
+
+    QueryStatus runFiles(std::span<const std::string> paths,
+                         const QueryConfig &config,
+                         const FileSetOptions &options,
+                         OutputSink &out,
+                         QueryStats &stats)
+    {
+        stats = {};
+        if (matchLimit(config) == 0 || paths.empty())
+        {
+            out.flush();
+            return QueryStatus::Ok;
+        }
+
+        // Each task is queried serially; the pool supplies the parallelism. A
+        // task needs no more than the matches the whole run may print.
+        QueryConfig task_config = config;
+        task_config.threads = 1;
+        task_config.max_count = matchLimit(config);
+
+        Scheduler s(config.threads * in_flight_tasks_per_thread);
+        TaskSource source(paths, options);
+        QueryStatus status = QueryStatus::Ok;
+        std::exception_ptr failure;
+        {
+            std::vector<std::jthread> workers;
+            workers.reserve(config.threads);
+            for (std::size_t i = 0; i < config.threads; ++i)
+            {
+                workers.emplace_back([&]
+                                     { workerLoop(s, paths, task_config, options); });
+            }
+
+            try
+            {
+                status = writeResults(s, source, paths, config, options, out, stats);
+            }
+            catch (...)
+            {
+                failure = std::current_exception();
+            }
+
+            // Queued tasks are dropped unrun; the jthreads join here.
+            s.cancelled.store(true, std::memory_order_release);
+            s.done.store(true, std::memory_order_release);
+        }
+
+        out.flush();
+        if (failure)
+        {
+            std::rethrow_exception(failure);
+        }
+        return status;
+    }
+
+} // namespace jlq
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "OutputSink.hpp"
+#include "Query.hpp"
+#include "QueryConfig.hpp"
+
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace jlq
+{
+
+    // Expands command-line inputs into data files, in order: a directory becomes
+    // the regular files below it (sorted, sidecar files skipped), and a pattern
+    // with `*`, `?` or `[` that names no file is expanded like the shell does.
+    // Throws std::runtime_error for a pattern that matches nothing and
+    // std::filesystem::filesystem_error for unreadable directories.
+    [[nodiscard]] std::vector<std::string> expandInputPaths(std::span<const std::string_view> inputs);
+
+    struct FileSetOptions
+    {
+        // Prefix every output line (and, with --count, each file's count) with
+        // "<path>:".
+        bool with_filename{false};
+        // The --path text, to find each file's value index by name.
+        std::string_view value_path{};
+        // Drop each file's pages from the page cache once it is done (--max-rss).
+        bool release_files{false};
+    };
+
+    // Runs the query over `paths` as if over their concatenation, on a pool of
+    // `config.threads` workers shared by all files. Files larger than a few MiB
+    // are split into line-aligned chunks so one big file also spreads over the
+    // workers; compressed files and files with a value index or zone map are
+    // each one task that uses them. Only a few files per worker are open at a
+    // time, and workers run only a bounded number of tasks ahead of the output.
+    //
+    // Output is always in input order (file by file), as for a serial scan;
+    // `config.max_count` caps the matches over all files. A file that cannot be
+    // read throws, with its path in the message, once the output of the files
+    // before it is written. With OutputMode::Count and `with_filename`, each
+    // file's count is written as "<path>:<n>"; otherwise counting is left to
+    // the caller, as for runQuery.
+    [[nodiscard]] QueryStatus runFiles(std::span<const std::string> paths,
+                                       const QueryConfig &config,
+                                       const FileSetOptions &options,
+                                       OutputSink &out,
+                                       QueryStats &stats);
+
+} // namespace jlq
@@ -0,0 +1,328 @@
+#include "FileSource.hpp"
+
+#include <linux/io_uring.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <system_error>
+#include <vector>
+
+namespace jlq
+{
+
+    namespace
+    {
+
+        [[noreturn]] void throwErrno(const char *what, int err)
+        {
+            throw std::system_error(std::error_code(err, std::generic_category()), what);
+        }
+
+        // Tells the kernel the file is read once, front to back: a larger
+        // read-ahead window. Best effort.
+        void adviseSequential(int fd) noexcept
+        {
+            (void)::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        }
+
+        // Drops [offset, offset + length) of the file from the page cache. Best
+        // effort.
+        void releaseCache(int fd, std::uint64_t offset, std::size_t length) noexcept
+        {
+            if (length != 0)
+            {
+                (void)::posix_fadvise(fd, static_cast<off_t>(offset), static_cast<off_t>(length), POSIX_FADV_DONTNEED);
+            }
+        }
+
+    } // namespace
+
+    std::optional<IoBackend> parseIoBackend(std::string_view s) noexcept
+    {
+        if (s == "mmap")
+        {
+            return IoBackend::Mmap;
+        }
+        if (s == "pread")
+        {
+            return IoBackend::Pread;
+        }
+        if (s == "io_uring")
+        {
+            return IoBackend::IoUring;
+        }
+        return std::nullopt;
+    }
+
+    PreadSource::PreadSource(int fd, bool release_cache) : fd_{fd}, release_cache_{release_cache}
+    {
+        adviseSequential(fd_);
+    }
+
+    std::size_t PreadSource::read(std::span<std::byte> out)
+    {
+        std::size_t filled = 0;
+        while (filled < out.size())
+        {
+            const ssize_t n = ::pread(fd_, out.data() + filled, out.size() - filled, static_cast<off_t>(offset_));
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                throwErrno("pread", errno);
+            }
+            if (n == 0)
+            {
+                break;
+            }
+            filled += static_cast<std::size_t>(n);
+            offset_ += static_cast<std::uint64_t>(n);
+        }
+        if (release_cache_)
+        {
+            releaseCache(fd_, offset_ - filled, filled);
+        }
+        return filled;
+    }
+
+    // The kernel-shared submission and completion rings, set up with raw
+    // syscalls (liburing is not required).
+    struct IoUringSource::Ring
+    {
+        int fd{-1};
+        void *sq_ring{MAP_FAILED};
+        std::size_t sq_ring_bytes{0};
+        void *cq_ring{MAP_FAILED};
+        std::size_t cq_ring_bytes{0};
+        io_uring_sqe *sqes{nullptr};
+        std::size_t sqes_bytes{0};
+        unsigned sq_entries{0};
+
+        unsigned *sq_tail{nullptr};
+        unsigned *sq_mask{nullptr};
+        unsigned *sq_array{nullptr};
+        unsigned *cq_head{nullptr};
+        unsigned *cq_tail{nullptr};
+        unsigned *cq_mask{nullptr};
+        io_uring_cqe *cqes{nullptr};
+
+        ~Ring()
+        {
+            if (sqes != nullptr)
+            {
+                ::munmap(sqes, sqes_bytes);
+            }
+            if (cq_ring != MAP_FAILED && cq_ring != sq_ring)
+            {
+                ::munmap(cq_ring, cq_ring_bytes);
+            }
+            if (sq_ring != MAP_FAILED)
+            {
+                ::munmap(sq_ring, sq_ring_bytes);
+            }
+            if (fd != -1)
+            {
+                ::close(fd);
+            }
+        }
+
+        [[nodiscard]] static unsigned *field(void *ring, std::uint32_t offset) noexcept
+        {
+            return reinterpret_cast<unsigned *>(static_cast<char *>(ring) + offset);
+        }
+
+        // Submits `count` queued entries.
+        void enter(unsigned count) const
+        {
+            unsigned submitted = 0;
+            while (submitted < count)
+            {
+                const long rc = ::syscall(__NR_io_uring_enter, fd, count - submitted, 0, 0, nullptr, 0);
+                if (rc < 0)
+                {
+                    if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+                    {
+                        continue;
+                    }
+                    throwErrno("io_uring_enter", errno);
+                }
+                submitted += static_cast<unsigned>(rc);
+            }
+        }
+
+        // Waits until at least one completion is queued.
+        void wait() const
+        {
+            for (;;)
+            {
+                const long rc = ::syscall(__NR_io_uring_enter, fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+                if (rc >= 0)
+                {
+                    return;
+                }
+                if (errno != EINTR)
+                {
+                    throwErrno("io_uring_enter", errno);
+                }
+            }
+        }
+    };
+
+    IoUringSource::IoUringSource(int fd, bool release_cache)
+        : ring_{std::make_unique<Ring>()}, fd_{fd}, release_cache_{release_cache}
+    {
+        struct stat st{};
+        if (::fstat(fd_, &st) != 0)
+        {
+            throwErrno("fstat", errno);
+        }
+        size_ = static_cast<std::uint64_t>(std::max<off_t>(st.st_size, 0));
+        adviseSequential(fd_);
+
+        Ring &r = *ring_;
+        io_uring_params params{};
+        const long ring_fd = ::syscall(__NR_io_uring_setup, queue_depth, &params);
+        if (ring_fd < 0)
+        {
+            throwErrno("io_uring_setup", errno);
+        }
+        r.fd = static_cast<int>(ring_fd);
+        r.sq_entries = params.sq_entries;
+
+        r.sq_ring_bytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        r.cq_ring_bytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap)
+        {
+            r.sq_ring_bytes = r.cq_ring_bytes = std::max(r.sq_ring_bytes, r.cq_ring_bytes);
+        }
+        r.sq_ring = ::mmap(nullptr, r.sq_ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r.fd,
+                           IORING_OFF_SQ_RING);
+        if (r.sq_ring == MAP_FAILED)
+        {
+            throwErrno("mmap", errno);
+        }
+        r.cq_ring = single_mmap ? r.sq_ring
+                                : ::mmap(nullptr, r.cq_ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                         r.fd, IORING_OFF_CQ_RING);
+        if (r.cq_ring == MAP_FAILED)
+        {
+            throwErrno("mmap", errno);
+        }
+        r.sqes_bytes = params.sq_entries * sizeof(io_uring_sqe);
+        void *sqes = ::mmap(nullptr, r.sqes_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r.fd,
+                            IORING_OFF_SQES);
+        if (sqes == MAP_FAILED)
+        {
+            throwErrno("mmap", errno);
+        }
+        r.sqes = static_cast<io_uring_sqe *>(sqes);
+
+        r.sq_tail = Ring::field(r.sq_ring, params.sq_off.tail);
+        r.sq_mask = Ring::field(r.sq_ring, params.sq_off.ring_mask);
+        r.sq_array = Ring::field(r.sq_ring, params.sq_off.array);
+        r.cq_head = Ring::field(r.cq_ring, params.cq_off.head);
+        r.cq_tail = Ring::field(r.cq_ring, params.cq_off.tail);
+        r.cq_mask = Ring::field(r.cq_ring, params.cq_off.ring_mask);
+        r.cqes = reinterpret_cast<io_uring_cqe *>(static_cast<char *>(r.cq_ring) + params.cq_off.cqes);
+    }
+
+    IoUringSource::~IoUringSource() = default;
+
+    std::size_t IoUringSource::finishRead(std::size_t filled) noexcept
+    {
+        if (release_cache_)
+        {
+            releaseCache(fd_, offset_, filled);
+        }
+        offset_ += filled;
+        return filled;
+    }
+
+    std::size_t IoUringSource::read(std::span<std::byte> out)
+    {
+        Ring &r = *ring_;
+        const std::size_t want = static_cast<std::size_t>(std::min<std::uint64_t>(out.size(), size_ - offset_));
+        std::size_t filled = 0;
+        std::vector<std::size_t> results;
+        while (filled < want)
+        {
+            // One batch of chunk reads covering as much of the rest as fits.
+            const std::size_t rest = want - filled;
+            const auto count = static_cast<unsigned>(
+                std::min<std::size_t>((rest + chunk_bytes - 1) / chunk_bytes, r.sq_entries));
+            unsigned tail = std::atomic_ref(*r.sq_tail).load(std::memory_order_relaxed);
+            for (unsigned i = 0; i < count; ++i)
+            {
+                const std::size_t begin = filled + i * chunk_bytes;
+                const unsigned index = tail & *r.sq_mask;
+                io_uring_sqe &sqe = r.sqes[index];
+                sqe = io_uring_sqe{};
+                sqe.opcode = IORING_OP_READ;
+                sqe.fd = fd_;
+                sqe.addr = reinterpret_cast<std::uint64_t>(out.data() + begin);
+                sqe.len = static_cast<std::uint32_t>(std::min(chunk_bytes, want - begin));
+                sqe.off = offset_ + begin;
+                sqe.user_data = i;
+                r.sq_array[index] = index;
+                ++tail;
+            }
+            std::atomic_ref(*r.sq_tail).store(tail, std::memory_order_release);
+            r.enter(count);
+
+            results.assign(count, 0);
+            int error = 0;
+            for (unsigned done = 0; done < count;)
+            {
+                unsigned head = std::atomic_ref(*r.cq_head).load(std::memory_order_relaxed);
+                const unsigned cq_tail = std::atomic_ref(*r.cq_tail).load(std::memory_order_acquire);
+                if (head == cq_tail)
+                {
+                    r.wait();
+                    continue;
+                }
+                for (; head != cq_tail; ++head, ++done)
+                {
+                    const io_uring_cqe &cqe = r.cqes[head & *r.cq_mask];
+                    if (cqe.res < 0)
+                    {
+                        error = -cqe.res;
+                    }
+                    else
+                    {
+                        results[cqe.user_data] = static_cast<std::size_t>(cqe.res);
+                    }
+                }
+                std::atomic_ref(*r.cq_head).store(head, std::memory_order_release);
+            }
+            // Reported once the whole batch is reaped, so none is left in flight.
+            if (error != 0)
+            {
+                throwErrno("io_uring read", error);
+            }
+
+            // Only the prefix read without gaps counts; a short chunk (the file
+            // shrank, or the kernel split the read) ends the batch there.
+            for (unsigned i = 0; i < count; ++i)
+            {
+                const std::size_t len = std::min(chunk_bytes, want - (filled + i * chunk_bytes));
+                if (results[i] < len)
+                {
+                    filled += i * chunk_bytes + results[i];
+                    return finishRead(filled);
+                }
+            }
+            filled += std::min<std::size_t>(count * chunk_bytes, rest);
+        }
+        return finishRead(filled);
+    }
+
+} // namespace jlq
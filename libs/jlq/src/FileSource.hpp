@@ -0,0 +1,78 @@
+#pragma once
+
+#include "WindowReader.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+
+namespace jlq
+{
+
+    // How a scan of an uncompressed file reads it (`--io`).
+    enum class IoBackend
+    {
+        // Parse the mapping in place, with read-ahead hints ahead of the scan.
+        Mmap,
+        // Stream the file through a WindowReader with large pread()s.
+        Pread,
+        // Stream the file through a WindowReader with batches of io_uring reads.
+        IoUring,
+    };
+
+    [[nodiscard]] std::optional<IoBackend> parseIoBackend(std::string_view s) noexcept;
+
+    // Reads a regular file front to back, filling each read() whole with
+    // pread()s. With `release_cache`, what was read is dropped from the page
+    // cache (the caller holds its own copy). `fd` is not owned.
+    class PreadSource final : public ByteSource
+    {
+    public:
+        explicit PreadSource(int fd, bool release_cache = false);
+
+        // Throws std::system_error on read errors.
+        std::size_t read(std::span<std::byte> out) override;
+
+    private:
+        int fd_;
+        bool release_cache_;
+        std::uint64_t offset_{0};
+    };
+
+    // Reads a regular file front to back through io_uring. Each read() is split
+    // into `chunk_bytes` requests submitted together, so the device sees up to
+    // `queue_depth` reads at once rather than one. `release_cache` is as for
+    // PreadSource. `fd` is not owned.
+    class IoUringSource final : public ByteSource
+    {
+    public:
+        static constexpr std::size_t chunk_bytes = 128ULL << 10;
+        static constexpr unsigned queue_depth = 64;
+
+        // Throws std::system_error if the kernel does not provide io_uring.
+        explicit IoUringSource(int fd, bool release_cache = false);
+        ~IoUringSource() override;
+
+        IoUringSource(const IoUringSource &) = delete;
+        IoUringSource &operator=(const IoUringSource &) = delete;
+
+        // Throws std::system_error on read errors.
+        std::size_t read(std::span<std::byte> out) override;
+
+    private:
+        struct Ring;
+
+        // Advances past the `filled` bytes just read; returns `filled`.
+        std::size_t finishRead(std::size_t filled) noexcept;
+
+        std::unique_ptr<Ring> ring_;
+        int fd_;
+        bool release_cache_;
+        std::uint64_t offset_{0};
+        std::uint64_t size_{0};
+    };
+
+} // namespace jlq
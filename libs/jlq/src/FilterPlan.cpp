@@ -0,0 +1,506 @@
+#include "FilterPlan.hpp"
+
+#include "ValueSet.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace jlq
+{
+
+    namespace
+    {
+
+        // Three-valued results plus "not known yet", ordered so that the
+        // connectives can take the maximum.
+        constexpr std::uint8_t truth_false = 0;
+        constexpr std::uint8_t truth_true = 1;
+        constexpr std::uint8_t truth_unknown = 2;
+        constexpr std::uint8_t truth_pending = 3;
+
+        [[nodiscard]] constexpr std::uint8_t toTruth(MatchResult result) noexcept
+        {
+            switch (result)
+            {
+            case MatchResult::Match:
+                return truth_true;
+            case MatchResult::NoMatch:
+                return truth_false;
+            default:
+                return truth_unknown;
+            }
+        }
+
+        [[nodiscard]] constexpr std::uint8_t truthAnd(std::uint8_t a, std::uint8_t b) noexcept
+        {
+            if (a == truth_false || b == truth_false)
+            {
+                return truth_false;
+            }
+            return std::max(a, b);
+        }
+
+        [[nodiscard]] constexpr std::uint8_t truthOr(std::uint8_t a, std::uint8_t b) noexcept
+        {
+            if (a == truth_true || b == truth_true)
+            {
+                return truth_true;
+            }
+            return (a == truth_false) ? b : (b == truth_false) ? a : std::max(a, b);
+        }
+
+        [[nodiscard]] constexpr std::uint8_t truthNot(std::uint8_t a) noexcept
+        {
+            return (a == truth_true) ? truth_false : (a == truth_false) ? truth_true : a;
+        }
+
+        // The JSON type a predicate's value can match, if there is only one.
+        [[nodiscard]] std::optional<simdjson::ondemand::json_type> predicateType(const Predicate &predicate) noexcept
+        {
+            if (predicate.values != nullptr)
+            {
+                return std::nullopt;
+            }
+            if (predicate.range.has_value())
+            {
+                return simdjson::ondemand::json_type::number;
+            }
+            return std::visit(
+                [](const auto &v) -> simdjson::ondemand::json_type
+                {
+                    using T = std::decay_t<decltype(v)>;
+                    if constexpr (std::is_same_v<T, std::string_view>)
+                    {
+                        return simdjson::ondemand::json_type::string;
+                    }
+                    else if constexpr (std::is_same_v<T, double>)
+                    {
+                        return simdjson::ondemand::json_type::number;
+                    }
+                    else if constexpr (std::is_same_v<T, bool>)
+                    {
+                        return simdjson::ondemand::json_type::boolean;
+                    }
+                    else
+                    {
+                        return simdjson::ondemand::json_type::null;
+                    }
+                },
+                predicate.value);
+        }
+
+    } // namespace
+
+    FilterPlan::FilterPlan(const QueryConfig &config)
+        : predicates_{config.filter->predicates}, program_{config.filter->program}
+    {
+        if (!config.path_segments.empty())
+        {
+            predicates_.push_back(
+                Predicate{config.path_segments, config.value, config.range, config.values, config.integer_value});
+            program_.push_back(FilterOp{FilterOp::Kind::Predicate, predicates_.size() - 1});
+            program_.push_back(FilterOp{FilterOp::Kind::And, 0});
+        }
+
+        nodes_.emplace_back();
+        for (std::size_t p = 0; p < predicates_.size(); ++p)
+        {
+            std::size_t node = 0;
+            nodes_[node].subtree.push_back(p);
+            for (const PathSegment &seg : predicates_[p].path_segments)
+            {
+                std::size_t child = nodes_.size();
+                if (seg.kind == PathSegmentKind::Key)
+                {
+                    auto &keys = nodes_[node].keys;
+                    const auto it = std::find_if(keys.begin(), keys.end(), [&](const auto &k)
+                                                 { return k.first == seg.key; });
+                    if (it == keys.end())
+                    {
+                        keys.emplace_back(seg.key, child);
+                        nodes_.emplace_back();
+                    }
+                    else
+                    {
+                        child = it->second;
+                    }
+                }
+                else
+                {
+                    auto &indices = nodes_[node].indices;
+                    const auto it = std::lower_bound(indices.begin(), indices.end(), seg.index, [](const auto &i, std::size_t index)
+                                                     { return i.first < index; });
+                    if (it == indices.end() || it->first != seg.index)
+                    {
+                        indices.emplace(it, seg.index, child);
+                        nodes_.emplace_back();
+                    }
+                    else
+                    {
+                        child = it->second;
+                    }
+                }
+                node = child;
+                nodes_[node].subtree.push_back(p);
+            }
+            nodes_[node].predicates.push_back(p);
+        }
+
+        integer_texts_.reserve(predicates_.size());
+        for (const Predicate &predicate : predicates_)
+        {
+            integer_texts_.push_back(predicate.integer_value.has_value() ? predicate.integer_value->text() : std::string());
+        }
+
+        for (Node &node : nodes_)
+        {
+            node.read_integers = std::any_of(node.predicates.begin(), node.predicates.end(), [&](std::size_t p)
+                                             {
+                const Predicate &predicate = predicates_[p];
+                return (predicate.range.has_value() && predicate.range->integer_bounds) ||
+                       (predicate.values != nullptr && predicate.values->hasIntegers()); });
+            if (node.predicates.empty() || !node.keys.empty() || !node.indices.empty())
+            {
+                continue;
+            }
+            const auto type = predicateType(predicates_[node.predicates.front()]);
+            if (std::all_of(node.predicates.begin(), node.predicates.end(), [&](std::size_t p)
+                            { return predicateType(predicates_[p]) == type; }))
+            {
+                node.leaf_type = type;
+            }
+        }
+    }
+
+    MatchResult FilterPlan::evaluateRoot(simdjson::ondemand::value root, Scratch &scratch) const
+    {
+        scratch.results.assign(predicates_.size(), truth_pending);
+        static_cast<void>(walkValue(root, nodes_.front(), scratch));
+
+        // Whatever the walk did not reach is absent from the document.
+        for (std::uint8_t &result : scratch.results)
+        {
+            if (result == truth_pending)
+            {
+                result = truth_false;
+            }
+        }
+        switch (decide(scratch))
+        {
+        case truth_true:
+            return MatchResult::Match;
+        case truth_false:
+            return MatchResult::NoMatch;
+        default:
+            return MatchResult::Malformed;
+        }
+    }
+
+    bool FilterPlan::walkValue(simdjson::ondemand::value value, const Node &start, Scratch &scratch) const
+    {
+        // Follow single-child steps in this frame, as findPath() does: calls
+        // per step cost as much as the lookups themselves on short lines.
+        const Node *chain = &start;
+        while (chain->predicates.empty() && chain->keys.size() + chain->indices.size() == 1)
+        {
+            simdjson::error_code ec{};
+            if (!chain->keys.empty())
+            {
+                simdjson::ondemand::object object;
+                ec = value.get_object().get(object);
+                if (!ec)
+                {
+                    ec = object.find_field_unordered(chain->keys.front().first).get(value);
+                }
+            }
+            else
+            {
+                simdjson::ondemand::array array;
+                ec = value.get_array().get(array);
+                if (!ec)
+                {
+                    ec = array.at(chain->indices.front().first).get(value);
+                }
+            }
+            if (ec)
+            {
+                return fail(*chain, ec, scratch);
+            }
+            chain = &nodes_[chain->keys.empty() ? chain->indices.front().second : chain->keys.front().second];
+        }
+        const Node &node = *chain;
+        if (node.leaf_type.has_value())
+        {
+            return compareAt(value, *node.leaf_type, node, scratch);
+        }
+
+        simdjson::ondemand::json_type type{};
+        if (const auto ec = value.type().get(type))
+        {
+            return fail(node, ec, scratch);
+        }
+        if (!node.predicates.empty() && !compareAt(value, type, node, scratch))
+        {
+            return false;
+        }
+
+        if (type == simdjson::ondemand::json_type::object && !node.keys.empty())
+        {
+            simdjson::ondemand::object object;
+            if (const auto ec = value.get_object().get(object))
+            {
+                return fail(node, ec, scratch);
+            }
+            if (!walkObject(object, node, scratch))
+            {
+                return false;
+            }
+        }
+        else if (type == simdjson::ondemand::json_type::array && !node.indices.empty())
+        {
+            simdjson::ondemand::array array;
+            if (const auto ec = value.get_array().get(array))
+            {
+                return fail(node, ec, scratch);
+            }
+            if (!walkArray(array, node, scratch))
+            {
+                return false;
+            }
+        }
+
+        // Paths below this value that were not found do not exist.
+        return settle(node, MatchResult::NoMatch, scratch);
+    }
+
+    bool FilterPlan::walkObject(simdjson::ondemand::object object, const Node &node, Scratch &scratch) const
+    {
+        // A single key is looked up exactly as findPath() does, which skips
+        // unwanted fields faster than iterating them.
+        if (node.keys.size() == 1)
+        {
+            simdjson::ondemand::value value;
+            if (const auto ec = object.find_field_unordered(node.keys.front().first).get(value))
+            {
+                return fail(node, ec, scratch);
+            }
+            return walkValue(value, nodes_[node.keys.front().second], scratch);
+        }
+
+        // Like find_field_unordered() on a fresh object: raw keys, first
+        // occurrence wins.
+        std::size_t remaining = node.keys.size();
+        for (auto field_result : object)
+        {
+            simdjson::ondemand::field field;
+            if (const auto ec = std::move(field_result).get(field))
+            {
+                return fail(node, ec, scratch);
+            }
+            const simdjson::ondemand::raw_json_string key = field.key();
+            for (const auto &[name, child] : node.keys)
+            {
+                if (!key.unsafe_is_equal(name))
+                {
+                    continue;
+                }
+                const Node &child_node = nodes_[child];
+                if (scratch.results[child_node.subtree.front()] == truth_pending)
+                {
+                    if (!walkValue(field.value(), child_node, scratch))
+                    {
+                        return false;
+                    }
+                    if (--remaining == 0)
+                    {
+                        return true;
+                    }
+                }
+                break;
+            }
+        }
+        return true;
+    }
+
+    bool FilterPlan::walkArray(simdjson::ondemand::array array, const Node &node, Scratch &scratch) const
+    {
+        auto next = node.indices.begin();
+        std::size_t index = 0;
+        for (auto element : array)
+        {
+            simdjson::ondemand::value value;
+            if (const auto ec = std::move(element).get(value))
+            {
+                return fail(node, ec, scratch);
+            }
+            if (index == next->first)
+            {
+                if (!walkValue(value, nodes_[next->second], scratch))
+                {
+                    return false;
+                }
+                if (++next == node.indices.end())
+                {
+                    return true;
+                }
+            }
+            ++index;
+        }
+        return true;
+    }
+
+    template <typename T, typename Read>
+    bool FilterPlan::compareAs(const Node &node, Scratch &scratch, Read &&read) const
+    {
+        // Every predicate of type T reads the value with the same getter, so it
+        // is read at most once.
+        std::optional<simdjson::error_code> ec;
+        T actual{};
+        for (const std::size_t p : node.predicates)
+        {
+            const Predicate &predicate = predicates_[p];
+            const T *wanted = std::get_if<T>(&predicate.value);
+            MatchResult result = MatchResult::NoMatch;
+            if (predicate.values != nullptr || (wanted != nullptr && !predicate.range.has_value()))
+            {
+                if (!ec.has_value())
+                {
+                    ec = read(actual);
+                }
+                const bool matches =
+                    (predicate.values != nullptr) ? predicate.values->contains(QueryValue{actual}) : actual == *wanted;
+                result = *ec ? classifyError(*ec) : matches ? MatchResult::Match
+                                                            : MatchResult::NoMatch;
+            }
+            if (!settle(p, result, scratch))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool FilterPlan::compareNumbers(simdjson::ondemand::value &value, const Node &node, Scratch &scratch) const
+    {
+        // Like compareAs<double>(), but integers compare exactly.
+        std::optional<simdjson::error_code> ec;
+        NumberValue actual;
+        for (const std::size_t p : node.predicates)
+        {
+            const Predicate &predicate = predicates_[p];
+            const double *wanted = std::get_if<double>(&predicate.value);
+            MatchResult result = MatchResult::NoMatch;
+            if (predicate.integer_value.has_value())
+            {
+                result = integerMatches(value, *predicate.integer_value, integer_texts_[p]);
+            }
+            else if (predicate.values != nullptr || predicate.range.has_value() || wanted != nullptr)
+            {
+                if (!ec.has_value())
+                {
+                    ec = readNumber(value, node.read_integers, actual);
+                }
+                const bool matches = (predicate.values != nullptr) ? predicate.values->contains(actual)
+                                     : predicate.range.has_value() ? predicate.range->contains(actual)
+                                                                   : actual.real == *wanted;
+                result = *ec ? classifyError(*ec) : matches ? MatchResult::Match
+                                                            : MatchResult::NoMatch;
+            }
+            if (!settle(p, result, scratch))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool FilterPlan::compareAt(simdjson::ondemand::value &value, simdjson::ondemand::json_type type,
+                               const Node &node, Scratch &scratch) const
+    {
+        // A predicate of another type than the value's does not match, as with
+        // the type-specific getters of a single --path query.
+        switch (type)
+        {
+        case simdjson::ondemand::json_type::string:
+            return compareAs<std::string_view>(node, scratch, [&](std::string_view &s)
+                                               { return readString(value, s); });
+        case simdjson::ondemand::json_type::number:
+            return compareNumbers(value, node, scratch);
+        case simdjson::ondemand::json_type::boolean:
+            return compareAs<bool>(node, scratch, [&](bool &b)
+                                   { return value.get_bool().get(b); });
+        case simdjson::ondemand::json_type::null:
+            return compareAs<std::monostate>(node, scratch, [&](std::monostate &)
+                                             {
+                bool is_null = false;
+                const auto ec = value.is_null().get(is_null);
+                return (ec || is_null) ? ec : simdjson::INCORRECT_TYPE; });
+        default:
+            for (const std::size_t p : node.predicates)
+            {
+                if (!settle(p, MatchResult::NoMatch, scratch))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+    bool FilterPlan::settle(const Node &node, MatchResult result, Scratch &scratch) const
+    {
+        for (const std::size_t p : node.subtree)
+        {
+            if (scratch.results[p] == truth_pending)
+            {
+                scratch.results[p] = toTruth(result);
+            }
+        }
+        return decide(scratch) == truth_pending;
+    }
+
+    bool FilterPlan::settle(std::size_t predicate, MatchResult result, Scratch &scratch) const
+    {
+        scratch.results[predicate] = toTruth(result);
+        return decide(scratch) == truth_pending;
+    }
+
+    bool FilterPlan::fail(const Node &node, simdjson::error_code ec, Scratch &scratch) const
+    {
+        const MatchResult result = classifyError(ec);
+        // A malformed document cannot be walked any further.
+        return settle(result == MatchResult::Malformed ? nodes_.front() : node, result, scratch);
+    }
+
+    std::uint8_t FilterPlan::decide(Scratch &scratch) const
+    {
+        auto &stack = scratch.stack;
+        stack.clear();
+        for (const FilterOp &op : program_)
+        {
+            switch (op.kind)
+            {
+            case FilterOp::Kind::Predicate:
+                stack.push_back(scratch.results[op.predicate]);
+                break;
+            case FilterOp::Kind::Not:
+                stack.back() = truthNot(stack.back());
+                break;
+            case FilterOp::Kind::And:
+            case FilterOp::Kind::Or:
+            {
+                const std::uint8_t b = stack.back();
+                stack.pop_back();
+                stack.back() = (op.kind == FilterOp::Kind::And) ? truthAnd(stack.back(), b) : truthOr(stack.back(), b);
+                break;
+            }
+            }
+        }
+        return stack.back();
+    }
+
+} // namespace jlq
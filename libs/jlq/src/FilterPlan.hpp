@@ -0,0 +1,93 @@
+#pragma once
+
+#include "JsonPath.hpp"
+#include "QueryConfig.hpp"
+
+#include <simdjson.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace jlq
+{
+
+    // A query's predicates compiled for evaluation in one pass over a document.
+    //
+    // The predicates' paths are merged into a trie, so a prefix shared by several
+    // predicates is walked once and every object on the way is scanned once for
+    // all the keys wanted from it. Results use three-valued logic (a malformed
+    // value is unknown: `false AND unknown` is false), and the walk stops as soon
+    // as the filter's result is decided.
+    class FilterPlan
+    {
+    public:
+        // Compiles `config.filter`, ANDed with `config.path_segments`/`value`
+        // when a path is set. `config` must have a filter.
+        explicit FilterPlan(const QueryConfig &config);
+
+        // Per-thread evaluation state, reused across documents.
+        struct Scratch
+        {
+            std::vector<std::uint8_t> results;
+            std::vector<std::uint8_t> stack;
+        };
+
+        // `Document` is an ondemand::document or a document_reference. Like
+        // findPath(), throws simdjson_error for a scalar document.
+        template <typename Document>
+        [[nodiscard]] MatchResult evaluate(Document &doc, Scratch &scratch) const
+        {
+            return evaluateRoot(doc, scratch);
+        }
+
+    private:
+        struct Node
+        {
+            // Child per object key, and per array index (sorted by index).
+            std::vector<std::pair<std::string_view, std::size_t>> keys;
+            std::vector<std::pair<std::size_t, std::size_t>> indices;
+            // Predicates on the value at this node.
+            std::vector<std::size_t> predicates;
+            // Predicates at or below this node.
+            std::vector<std::size_t> subtree;
+            // Set for a leaf whose predicates all compare against one JSON type:
+            // the value is then read with that type's getter without a type()
+            // check, which settles any other type as a non-match anyway.
+            std::optional<simdjson::ondemand::json_type> leaf_type;
+            // Whether a range or value set here compares integers exactly, so
+            // numbers are read as integers first.
+            bool read_integers{false};
+        };
+
+        [[nodiscard]] MatchResult evaluateRoot(simdjson::ondemand::value root, Scratch &scratch) const;
+
+        // Walkers return false once the result is decided.
+        [[nodiscard]] bool walkValue(simdjson::ondemand::value value, const Node &node, Scratch &scratch) const;
+        [[nodiscard]] bool walkObject(simdjson::ondemand::object object, const Node &node, Scratch &scratch) const;
+        [[nodiscard]] bool walkArray(simdjson::ondemand::array array, const Node &node, Scratch &scratch) const;
+        [[nodiscard]] bool compareAt(simdjson::ondemand::value &value, simdjson::ondemand::json_type type,
+                                     const Node &node, Scratch &scratch) const;
+        [[nodiscard]] bool compareNumbers(simdjson::ondemand::value &value, const Node &node, Scratch &scratch) const;
+        template <typename T, typename Read>
+        [[nodiscard]] bool compareAs(const Node &node, Scratch &scratch, Read &&read) const;
+
+        // Records `result` for every undecided predicate in `node`'s subtree.
+        [[nodiscard]] bool settle(const Node &node, MatchResult result, Scratch &scratch) const;
+        [[nodiscard]] bool settle(std::size_t predicate, MatchResult result, Scratch &scratch) const;
+        [[nodiscard]] bool fail(const Node &node, simdjson::error_code ec, Scratch &scratch) const;
+        [[nodiscard]] std::uint8_t decide(Scratch &scratch) const;
+
+        std::vector<Predicate> predicates_;
+        // Per predicate, the text() of its `integer_value`, if any.
+        std::vector<std::string> integer_texts_;
+        std::vector<FilterOp> program_;
+        // nodes_[0] is the document root.
+        std::vector<Node> nodes_;
+    };
+
+} // namespace jlq
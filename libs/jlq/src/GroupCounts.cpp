@@ -0,0 +1,36 @@
+#include "GroupCounts.hpp"
+
+#include <algorithm>
+
+namespace jlq
+{
+
+    void GroupCounts::add(std::string_view key, std::size_t count)
+    {
+        // Look up by view first: most matches hit an existing group and then
+        // allocate nothing.
+        if (const auto it = counts_.find(key); it != counts_.end())
+        {
+            it->second += count;
+            return;
+        }
+        counts_.emplace(std::string(key), count);
+    }
+
+    void GroupCounts::merge(const GroupCounts &other)
+    {
+        for (const auto &[key, count] : other.counts_)
+        {
+            add(key, count);
+        }
+    }
+
+    std::vector<std::pair<std::string_view, std::size_t>> GroupCounts::sorted() const
+    {
+        std::vector<std::pair<std::string_view, std::size_t>> groups(counts_.begin(), counts_.end());
+        std::ranges::sort(groups, [](const auto &a, const auto &b)
+                          { return (a.second != b.second) ? a.second > b.second : a.first < b.first; });
+        return groups;
+    }
+
+} // namespace jlq
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace jlq
+{
+
+    // Match counts per value at the --group-by path, keyed by the value's raw
+    // JSON bytes: `"a"` and `"\u0061"` are different groups, as are `1` and
+    // `1.0`. Each worker fills its own and the run merges them at the end.
+    class GroupCounts
+    {
+    public:
+        void add(std::string_view key, std::size_t count = 1);
+        void merge(const GroupCounts &other);
+
+        [[nodiscard]] std::size_t size() const noexcept { return counts_.size(); }
+        [[nodiscard]] bool empty() const noexcept { return counts_.empty(); }
+
+        // The groups, most frequent first; ties in byte order of the keys.
+        [[nodiscard]] std::vector<std::pair<std::string_view, std::size_t>> sorted() const;
+
+    private:
+        struct Hash
+        {
+            using is_transparent = void;
+            [[nodiscard]] std::size_t operator()(std::string_view s) const noexcept
+            {
+                return std::hash<std::string_view>{}(s);
+            }
+        };
+
+        std::unordered_map<std::string, std::size_t, Hash, std::equal_to<>> counts_;
+    };
+
+} // namespace jlq
@@ -0,0 +1,70 @@
+#include "HyperLogLog.hpp"
+
+#include "PathValue.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <functional>
+
+namespace jlq
+{
+
+    void HyperLogLog::add(std::string_view value)
+    {
+        if (registers_.empty())
+        {
+            registers_.resize(register_count);
+        }
+        // std::hash need not spread its bits; the register index and rank
+        // both depend on them, so they are mixed first.
+        const std::uint64_t h = mix64(std::hash<std::string_view>{}(value));
+        const std::size_t index = static_cast<std::size_t>(h >> (64 - precision));
+        // The guard bit caps the rank at 64 - precision + 1.
+        const std::uint64_t rest = (h << precision) | (std::uint64_t{1} << (precision - 1));
+        const auto rank = static_cast<std::uint8_t>(std::countl_zero(rest) + 1);
+        registers_[index] = std::max(registers_[index], rank);
+    }
+
+    void HyperLogLog::merge(const HyperLogLog &other)
+    {
+        if (other.registers_.empty())
+        {
+            return;
+        }
+        if (registers_.empty())
+        {
+            registers_ = other.registers_;
+            return;
+        }
+        for (std::size_t i = 0; i < register_count; ++i)
+        {
+            registers_[i] = std::max(registers_[i], other.registers_[i]);
+        }
+    }
+
+    std::uint64_t HyperLogLog::estimate() const noexcept
+    {
+        if (registers_.empty())
+        {
+            return 0;
+        }
+        constexpr double m = static_cast<double>(register_count);
+        double sum = 0.0;
+        std::size_t zeros = 0;
+        for (const std::uint8_t r : registers_)
+        {
+            sum += std::ldexp(1.0, -static_cast<int>(r));
+            zeros += (r == 0);
+        }
+        double estimate = (0.7213 / (1.0 + 1.079 / m)) * m * m / sum;
+        // Small cardinalities leave registers empty; linear counting is then
+        // more accurate. A 64-bit hash needs no large-range correction.
+        if (estimate <= 2.5 * m && zeros != 0)
+        {
+            estimate = m * std::log(m / static_cast<double>(zeros));
+        }
+        return static_cast<std::uint64_t>(std::llround(estimate));
+    }
+
+} // namespace jlq
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace jlq
+{
+
+    // Approximate count of distinct byte strings (--distinct): a HyperLogLog
+    // sketch of 2^12 one-byte registers, so 4 KiB however many values are
+    // added, with a standard error of about 1.6%. Sketches of the same stream's
+    // parts merge into the sketch of the whole. The registers are only
+    // allocated by the first add() or merge().
+    class HyperLogLog
+    {
+    public:
+        static constexpr unsigned precision = 12;
+        static constexpr std::size_t register_count = std::size_t{1} << precision;
+
+        void add(std::string_view value);
+        void merge(const HyperLogLog &other);
+
+        [[nodiscard]] bool empty() const noexcept { return registers_.empty(); }
+
+        // The estimated number of distinct values added.
+        [[nodiscard]] std::uint64_t estimate() const noexcept;
+
+    private:
+        std::vector<std::uint8_t> registers_;
+    };
+
+} // namespace jlq
@@ -0,0 +1,195 @@
+#pragma once
+
+#include "NumberRange.hpp"
+#include "path.hpp"
+
+#include <simdjson.h>
+
+#include <algorithm>
+#include <span>
+#include <string_view>
+
+namespace jlq
+{
+
+    // Errors that mean "the value is not there or not comparable" rather than
+    // "the line is malformed": they make a line a non-match even in strict mode.
+    [[nodiscard]] inline bool isNonMatchError(simdjson::error_code ec) noexcept
+    {
+        return ec == simdjson::NO_SUCH_FIELD || ec == simdjson::INCORRECT_TYPE ||
+               ec == simdjson::NUMBER_OUT_OF_RANGE || ec == simdjson::BIGINT_ERROR ||
+               ec == simdjson::INDEX_OUT_OF_BOUNDS;
+    }
+
+    enum class MatchResult
+    {
+        Match,
+        NoMatch,
+        Malformed,
+    };
+
+    [[nodiscard]] inline MatchResult classifyError(simdjson::error_code ec) noexcept
+    {
+        if (ec == simdjson::SUCCESS)
+        {
+            return MatchResult::Match;
+        }
+
+        // Non-fatal for query semantics: treat as non-match.
+        if (isNonMatchError(ec))
+        {
+            return MatchResult::NoMatch;
+        }
+
+        // Everything else is treated as malformed JSON (especially in strict mode).
+        return MatchResult::Malformed;
+    }
+
+    // Reads a number for comparisons, as an exact int64 or, above INT64_MAX,
+    // uint64 first if `integer` is set and the literal is an integer that
+    // fits, else with get_double().
+    [[nodiscard]] inline simdjson::error_code readNumber(simdjson::ondemand::value &value, bool integer,
+                                                         NumberValue &out) noexcept
+    {
+        if (integer)
+        {
+            out.integer = IntegerValue{};
+            const auto ec = value.get_int64().get(out.integer.int64);
+            if (ec == simdjson::SUCCESS)
+            {
+                out.is_integer = true;
+                out.real = static_cast<double>(out.integer.int64);
+                return simdjson::SUCCESS;
+            }
+            // get_int64() fails alike for decimals and for integers above
+            // INT64_MAX, which take at least 19 digits.
+            if (ec == simdjson::INCORRECT_TYPE && value.raw_json_token().size() >= 19 &&
+                value.get_uint64().get(out.integer.uint64) == simdjson::SUCCESS)
+            {
+                out.integer.int64 = 0;
+                out.integer.is_unsigned = true;
+                out.is_integer = true;
+                out.real = static_cast<double>(out.integer.uint64);
+                return simdjson::SUCCESS;
+            }
+        }
+        out.is_integer = false;
+        return value.get_double().get(out.real);
+    }
+
+    // `raw` without the whitespace a raw JSON token carries up to the next one.
+    [[nodiscard]] inline std::string_view trimJsonToken(std::string_view raw) noexcept
+    {
+        while (!raw.empty() && (raw.back() == ' ' || raw.back() == '\t' || raw.back() == '\r' || raw.back() == '\n'))
+        {
+            raw.remove_suffix(1);
+        }
+        return raw;
+    }
+
+    // Whether `token` is an integer of at most 20 digits in canonical
+    // form, so that equal integers are equal tokens. Such a token always
+    // converts to a double, as get_double() would.
+    [[nodiscard]] inline bool isCanonicalInteger(std::string_view token) noexcept
+    {
+        if (!token.empty() && token.front() == '-')
+        {
+            token.remove_prefix(1);
+            // -0 is 0.
+            if (token == "0")
+            {
+                return false;
+            }
+        }
+        if (token.empty() || token.size() > 20 || (token.front() == '0' && token.size() > 1))
+        {
+            return false;
+        }
+        return std::ranges::all_of(token, [](char c)
+                                   { return c >= '0' && c <= '9'; });
+    }
+
+    // Compares the number `value` with `integer`, whose text() is `text`.
+    // Integers written canonically are compared as text, without parsing
+    // them. Other numbers (decimals, exponents, -0) are read as doubles and
+    // must be exactly the integer, which a double comparison alone gets wrong
+    // beyond 2^53.
+    [[nodiscard]] inline MatchResult integerMatches(simdjson::ondemand::value &value, const IntegerValue &integer,
+                                                    std::string_view text) noexcept
+    {
+        const std::string_view token = trimJsonToken(value.raw_json_token());
+        if (token == text)
+        {
+            return MatchResult::Match;
+        }
+        if (isCanonicalInteger(token))
+        {
+            return MatchResult::NoMatch;
+        }
+        double d = 0.0;
+        if (const auto ec = value.get_double().get(d))
+        {
+            return classifyError(ec);
+        }
+        return integer.equals(d) ? MatchResult::Match : MatchResult::NoMatch;
+    }
+
+    // Reads a string like get_string(), but a string whose token has no
+    // backslash is not unescaped: `out` then views its bytes in the input.
+    [[nodiscard]] inline simdjson::error_code readString(simdjson::ondemand::value &value,
+                                                         std::string_view &out) noexcept
+    {
+        const std::string_view raw = value.raw_json_token();
+        if (!raw.empty() && raw.front() == '"')
+        {
+            const std::size_t end = raw.find_first_of("\"\\", 1);
+            if (end != std::string_view::npos && raw[end] == '"')
+            {
+                out = raw.substr(1, end - 1);
+                return simdjson::SUCCESS;
+            }
+        }
+        return value.get_string().get(out);
+    }
+
+    // Walks `path` from the root of `doc` (an ondemand::document or, for streamed
+    // input, a document_reference) and stores the value found in `out`. Returns
+    // the error of the first step that fails. Throws simdjson_error if the root
+    // is not a value (e.g. a scalar document).
+    template <typename Document>
+    [[nodiscard]] simdjson::error_code findPath(Document &doc, std::span<const PathSegment> path,
+                                                simdjson::ondemand::value &out)
+    {
+        simdjson::ondemand::value current = doc;
+        for (const PathSegment &seg : path)
+        {
+            if (seg.kind == PathSegmentKind::Key)
+            {
+                simdjson::ondemand::object obj;
+                if (const auto ec = current.get_object().get(obj))
+                {
+                    return ec;
+                }
+                if (const auto ec = obj.find_field_unordered(seg.key).get(current))
+                {
+                    return ec;
+                }
+            }
+            else
+            {
+                simdjson::ondemand::array arr;
+                if (const auto ec = current.get_array().get(arr))
+                {
+                    return ec;
+                }
+                if (const auto ec = arr.at(seg.index).get(current))
+                {
+                    return ec;
+                }
+            }
+        }
+        out = current;
+        return simdjson::SUCCESS;
+    }
+
+} // namespace jlq
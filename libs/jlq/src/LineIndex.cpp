@@ -0,0 +1,223 @@
+#include "LineIndex.hpp"
+
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace jlq
+{
+
+    namespace
+    {
+
+        constexpr char index_magic[8] = {'J', 'L', 'Q', 'L', 'I', 'D', 'X', '\0'};
+        constexpr std::uint32_t index_version = 1;
+
+        struct Header
+        {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t checkpoint_interval;
+            std::uint64_t file_size;
+            std::int64_t file_mtime_ns;
+            std::uint64_t line_count;
+            std::uint64_t delta_bytes;
+        };
+
+        constexpr std::size_t checkpoint_size = 2 * sizeof(std::uint64_t);
+
+        [[noreturn]] void throwCorrupt()
+        {
+            throw std::runtime_error("line index does not match the data file");
+        }
+
+        [[nodiscard]] std::span<const std::byte> asBytes(const auto &value) noexcept
+        {
+            return std::as_bytes(std::span(&value, 1));
+        }
+
+    } // namespace
+
+    std::string lineIndexPath(std::string_view data_path)
+    {
+        return std::string(data_path) + ".jlqidx";
+    }
+
+    void LineIndex::write(const std::string &index_path, std::span<const std::byte> bytes, FileStamp stamp)
+    {
+        std::vector<std::uint64_t> checkpoints;
+        std::vector<std::byte> deltas;
+        deltas.reserve(bytes.size() / 64);
+
+        std::size_t line = 0;
+        std::size_t start = 0;
+        std::size_t previous = 0;
+        while (start < bytes.size())
+        {
+            if (line > 0)
+            {
+                appendVarint(deltas, start - previous);
+            }
+            if (line % checkpoint_interval == 0)
+            {
+                checkpoints.push_back(start);
+                checkpoints.push_back(deltas.size());
+            }
+            previous = start;
+            ++line;
+
+            const void *nl = std::memchr(bytes.data() + start, '\n', bytes.size() - start);
+            start = (nl == nullptr) ? bytes.size()
+                                    : static_cast<std::size_t>(static_cast<const std::byte *>(nl) - bytes.data()) + 1;
+        }
+
+        Header header{};
+        std::memcpy(header.magic, index_magic, sizeof(index_magic));
+        header.version = index_version;
+        header.checkpoint_interval = checkpoint_interval;
+        header.file_size = stamp.size;
+        header.file_mtime_ns = stamp.mtime_ns;
+        header.line_count = line;
+        header.delta_bytes = deltas.size();
+
+        const std::span<const std::byte> parts[] = {asBytes(header), std::as_bytes(std::span(checkpoints)),
+                                                    std::as_bytes(std::span(deltas))};
+        writeFileAtomically(index_path, parts);
+    }
+
+    std::optional<LineIndex> LineIndex::open(const std::string &index_path, FileStamp expected)
+    {
+        LineIndex index;
+        try
+        {
+            index.file_ = MappedFile::openReadonly(index_path);
+        }
+        catch (const std::exception &)
+        {
+            return std::nullopt;
+        }
+
+        const auto bytes = index.file_.bytes();
+        Header header{};
+        if (bytes.size() < sizeof(header))
+        {
+            return std::nullopt;
+        }
+        std::memcpy(&header, bytes.data(), sizeof(header));
+
+        const std::uint64_t checkpoints = (header.line_count + checkpoint_interval - 1) / checkpoint_interval;
+        if (std::memcmp(header.magic, index_magic, sizeof(index_magic)) != 0 || header.version != index_version ||
+            header.checkpoint_interval != checkpoint_interval ||
+            FileStamp{header.file_size, header.file_mtime_ns} != expected ||
+            header.line_count > header.file_size ||
+            bytes.size() - sizeof(header) != checkpoints * checkpoint_size + header.delta_bytes)
+        {
+            return std::nullopt;
+        }
+
+        index.stamp_ = expected;
+        index.line_count_ = static_cast<std::size_t>(header.line_count);
+        index.checkpoints_ = bytes.subspan(sizeof(header), checkpoints * checkpoint_size);
+        index.deltas_ = bytes.subspan(sizeof(header) + index.checkpoints_.size());
+        return index;
+    }
+
+    LineIndex::Checkpoint LineIndex::checkpoint(std::size_t k) const noexcept
+    {
+        Checkpoint cp{};
+        std::memcpy(&cp.line_start, checkpoints_.data() + k * checkpoint_size, sizeof(cp.line_start));
+        std::memcpy(&cp.delta_pos, checkpoints_.data() + k * checkpoint_size + sizeof(cp.line_start), sizeof(cp.delta_pos));
+        return cp;
+    }
+
+    std::uint64_t LineIndex::lineStart(std::size_t line) const
+    {
+        if (line >= line_count_)
+        {
+            throw std::out_of_range("line index out of range");
+        }
+        const Checkpoint cp = checkpoint(line / checkpoint_interval);
+        std::uint64_t start = cp.line_start;
+        auto pos = static_cast<std::size_t>(cp.delta_pos);
+        for (std::size_t i = line % checkpoint_interval; i > 0; --i)
+        {
+            std::uint64_t delta = 0;
+            if (!readVarint(deltas_, pos, delta))
+            {
+                throwCorrupt();
+            }
+            start += delta;
+        }
+        return start;
+    }
+
+    LineIndex::Cursor LineIndex::cursor(std::span<const std::byte> bytes, std::size_t first_line, std::size_t end_line) const
+    {
+        if (bytes.size() != stamp_.size)
+        {
+            throwCorrupt();
+        }
+        return Cursor(*this, bytes, first_line, end_line);
+    }
+
+    LineIndex::Cursor::Cursor(const LineIndex &index, std::span<const std::byte> bytes, std::size_t first_line,
+                              std::size_t end_line)
+        : index_{&index}, bytes_{bytes}, line_{0}, end_line_{std::min(end_line, index.line_count_)}, start_{0},
+          delta_pos_{0}
+    {
+        if (first_line >= end_line_)
+        {
+            line_ = end_line_;
+            return;
+        }
+
+        const Checkpoint cp = index.checkpoint(first_line / checkpoint_interval);
+        line_ = first_line - first_line % checkpoint_interval;
+        start_ = cp.line_start;
+        delta_pos_ = static_cast<std::size_t>(cp.delta_pos);
+        for (; line_ < first_line; ++line_)
+        {
+            std::uint64_t delta = 0;
+            if (!readVarint(index.deltas_, delta_pos_, delta))
+            {
+                throwCorrupt();
+            }
+            start_ += delta;
+        }
+    }
+
+    std::size_t LineIndex::Cursor::nextBatch(std::span<ScannedLine> out)
+    {
+        std::size_t count = 0;
+        while (count < out.size() && line_ < end_line_)
+        {
+            std::uint64_t end = bytes_.size();
+            if (line_ + 1 < index_->line_count_)
+            {
+                std::uint64_t delta = 0;
+                if (!readVarint(index_->deltas_, delta_pos_, delta))
+                {
+                    throwCorrupt();
+                }
+                end = start_ + delta;
+            }
+            if (end <= start_ || end > bytes_.size())
+            {
+                throwCorrupt();
+            }
+
+            const bool had_newline = (bytes_[end - 1] == static_cast<std::byte>('\n'));
+            const std::size_t raw_end = end - (had_newline ? 1 : 0);
+            if (makeScannedLine(bytes_, start_, raw_end, had_newline, out[count]))
+            {
+                ++count;
+            }
+            start_ = end;
+            ++line_;
+        }
+        return count;
+    }
+
+} // namespace jlq
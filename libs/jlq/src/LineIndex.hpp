@@ -0,0 +1,94 @@
+#pragma once
+
+#include "LineScanner.hpp"
+#include "MappedFile.hpp"
+#include "Sidecar.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace jlq
+{
+
+    // Sidecar holding the start offset of every physical line of a data file
+    // (`jlq index <file>` writes it to `<file>.jlqidx`).
+    //
+    // Layout (native endianness):
+    //   Header
+    //   checkpoints  u64 line start + u64 delta position, one per
+    //                `checkpoint_interval` lines
+    //   deltas       LEB128 differences between consecutive line starts
+    //
+    // A checkpoint lets a reader start at any line after decoding fewer than
+    // `checkpoint_interval` deltas, so the file can be split into line ranges
+    // without scanning it.
+    class LineIndex
+    {
+    public:
+        static constexpr std::size_t checkpoint_interval = 1024;
+
+        class Cursor
+        {
+        public:
+            // Fills `out` with up to `out.size()` consecutive non-empty lines, using
+            // the same rules as LineScanner. Returns 0 at the end of the range.
+            // Throws std::runtime_error if the index does not fit the data.
+            [[nodiscard]] std::size_t nextBatch(std::span<ScannedLine> out);
+
+        private:
+            friend class LineIndex;
+
+            Cursor(const LineIndex &index, std::span<const std::byte> bytes, std::size_t first_line, std::size_t end_line);
+
+            const LineIndex *index_;
+            std::span<const std::byte> bytes_;
+            std::size_t line_;
+            std::size_t end_line_;
+            std::uint64_t start_;
+            // Position in the delta stream of the delta leading to line `line_ + 1`.
+            std::size_t delta_pos_;
+        };
+
+        // Writes the index of `bytes` (the contents of the file stamped `stamp`).
+        static void write(const std::string &index_path, std::span<const std::byte> bytes, FileStamp stamp);
+
+        // Maps the index at `index_path`. Returns nullopt if it is missing,
+        // malformed, or was built for a different version of the file.
+        [[nodiscard]] static std::optional<LineIndex> open(const std::string &index_path, FileStamp expected);
+
+        // Physical lines, empty ones included.
+        [[nodiscard]] std::size_t lineCount() const noexcept { return line_count_; }
+
+        // Byte offset of line `line` (< lineCount()) in the data file.
+        [[nodiscard]] std::uint64_t lineStart(std::size_t line) const;
+
+        // Lines [first_line, end_line) of `bytes`, the data file's contents.
+        [[nodiscard]] Cursor cursor(std::span<const std::byte> bytes, std::size_t first_line, std::size_t end_line) const;
+        [[nodiscard]] Cursor cursor(std::span<const std::byte> bytes) const { return cursor(bytes, 0, line_count_); }
+
+    private:
+        LineIndex() = default;
+
+        struct Checkpoint
+        {
+            std::uint64_t line_start;
+            std::uint64_t delta_pos;
+        };
+
+        [[nodiscard]] Checkpoint checkpoint(std::size_t k) const noexcept;
+
+        MappedFile file_;
+        FileStamp stamp_;
+        std::size_t line_count_{0};
+        std::span<const std::byte> checkpoints_;
+        std::span<const std::byte> deltas_;
+    };
+
+    // Sidecar path for the line index of `data_path`.
+    [[nodiscard]] std::string lineIndexPath(std::string_view data_path);
+
+} // namespace jlq
@@ -1,71 +1,196 @@
 #include "LineScanner.hpp"
 
+#include <bit>
 #include <cstddef>
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 namespace jlq
 {
 
-    LineScanner::LineScanner(std::span<const std::byte> bytes) noexcept : bytes_{bytes} {}
-
-    bool LineScanner::next(ScannedLine &out) noexcept
+    namespace
     {
-        while (offset_ <= bytes_.size())
+
+#if defined(__x86_64__) && !defined(__AVX2__) && (defined(__GNUC__) || defined(__clang__))
+        // Default x86_64 builds target SSE2 only; the AVX2 kernel is compiled
+        // for AVX2 anyway and picked at run time on CPUs that have it.
+#define JLQ_AVX2_DISPATCH 1
+#endif
+
+#if defined(__AVX2__) || defined(JLQ_AVX2_DISPATCH)
+#if defined(JLQ_AVX2_DISPATCH)
+        __attribute__((target("avx2")))
+#endif
+        [[nodiscard]] inline std::uint64_t newlineMaskAvx2(const std::byte *block) noexcept
         {
-            if (offset_ == bytes_.size())
+            const __m256i nl = _mm256_set1_epi8('\n');
+            const auto *p = reinterpret_cast<const __m256i *>(block);
+            const auto lo = static_cast<std::uint32_t>(
+                _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(p), nl)));
+            const auto hi = static_cast<std::uint32_t>(
+                _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(p + 1), nl)));
+            return static_cast<std::uint64_t>(lo) | (static_cast<std::uint64_t>(hi) << 32);
+        }
+#endif
+
+#if defined(JLQ_AVX2_DISPATCH)
+        [[nodiscard]] bool cpuHasAvx2() noexcept
+        {
+            static const bool has_avx2 = []
+            {
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("avx2") != 0;
+            }();
+            return has_avx2;
+        }
+#endif
+
+        // Returns a mask with bit i set when block[i] == '\n', for a 64-byte block.
+        // `avx2` selects the AVX2 kernel in builds that dispatch at run time.
+        [[nodiscard]] inline std::uint64_t newlineMask(const std::byte *block, [[maybe_unused]] bool avx2) noexcept
+        {
+#if defined(__AVX2__)
+            return newlineMaskAvx2(block);
+#elif defined(__SSE2__)
+#if defined(JLQ_AVX2_DISPATCH)
+            if (avx2)
+            {
+                return newlineMaskAvx2(block);
+            }
+#endif
+            const __m128i nl = _mm_set1_epi8('\n');
+            const auto *p = reinterpret_cast<const __m128i *>(block);
+            std::uint64_t mask = 0;
+            for (unsigned i = 0; i < 4; ++i)
+            {
+                const auto m = static_cast<std::uint16_t>(
+                    _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(p + i), nl)));
+                mask |= static_cast<std::uint64_t>(m) << (16 * i);
+            }
+            return mask;
+#elif defined(__ARM_NEON)
+            // NEON has no movemask: keep one distinct bit per lane, then fold the
+            // four 16-byte compares into 64 bits with pairwise adds.
+            const uint8x16_t nl = vdupq_n_u8('\n');
+            const uint8x16_t bits = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+            const auto *p = reinterpret_cast<const std::uint8_t *>(block);
+            const uint8x16_t m0 = vandq_u8(vceqq_u8(vld1q_u8(p), nl), bits);
+            const uint8x16_t m1 = vandq_u8(vceqq_u8(vld1q_u8(p + 16), nl), bits);
+            const uint8x16_t m2 = vandq_u8(vceqq_u8(vld1q_u8(p + 32), nl), bits);
+            const uint8x16_t m3 = vandq_u8(vceqq_u8(vld1q_u8(p + 48), nl), bits);
+            uint8x16_t sum = vpaddq_u8(vpaddq_u8(m0, m1), vpaddq_u8(m2, m3));
+            sum = vpaddq_u8(sum, sum);
+            return vgetq_lane_u64(vreinterpretq_u64_u8(sum), 0);
+#else
+            std::uint64_t mask = 0;
+            for (unsigned i = 0; i < 64; ++i)
             {
-                return false;
+                mask |= static_cast<std::uint64_t>(block[i] == static_cast<std::byte>('\n')) << i;
             }
+            return mask;
+#endif
+        }
 
-            const std::size_t line_begin = offset_;
+    } // namespace
+
+    LineScanner::LineScanner(std::span<const std::byte> bytes) noexcept : bytes_{bytes}
+    {
+#if defined(JLQ_AVX2_DISPATCH)
+        avx2_ = cpuHasAvx2();
+#endif
+    }
+
+    bool LineScanner::loadBlock() noexcept
+    {
+        if (next_block_ >= bytes_.size())
+        {
+            return false;
+        }
+
+        block_ = next_block_;
+        next_block_ += block_size;
 
-            std::size_t line_end = line_begin;
-            bool had_newline = false;
+        const std::size_t available = bytes_.size() - block_;
+        if (available >= block_size)
+        {
+            mask_ = newlineMask(bytes_.data() + block_, avx2_);
+        }
+        else
+        {
+            // Never read past the end of the input: scan the tail from a
+            // zero-filled copy ('\0' is not a newline).
+            std::byte tail[block_size]{};
+            std::memcpy(tail, bytes_.data() + block_, available);
+            mask_ = newlineMask(tail, avx2_);
+        }
+        return true;
+    }
 
-            for (; line_end < bytes_.size(); ++line_end)
+    std::size_t LineScanner::findNewline() noexcept
+    {
+        while (mask_ == 0)
+        {
+            if (!loadBlock())
             {
-                if (bytes_[line_end] == static_cast<std::byte>('\n'))
-                {
-                    had_newline = true;
-                    break;
-                }
+                return npos;
             }
+        }
 
-            // raw excludes the '\n'
-            const std::size_t raw_end = line_end;
-            offset_ = had_newline ? (line_end + 1) : line_end;
+        const auto bit = static_cast<std::size_t>(std::countr_zero(mask_));
+        mask_ &= mask_ - 1;
+        return block_ + bit;
+    }
+
+    bool LineScanner::next(ScannedLine &out) noexcept
+    {
+        while (offset_ < bytes_.size())
+        {
+            const std::size_t line_begin = offset_;
 
-            const std::size_t raw_len = raw_end - line_begin;
+            const std::size_t newline = findNewline();
+            const bool had_newline = (newline != npos);
+
+            // raw excludes the '\n'
+            const std::size_t raw_end = had_newline ? newline : bytes_.size();
+            offset_ = had_newline ? (newline + 1) : raw_end;
 
-            // Ignore empty lines.
-            if (raw_len == 0)
+            if (makeScannedLine(bytes_, line_begin, raw_end, had_newline, out))
             {
-                continue;
+                return true;
             }
+        }
 
-            out = {};
-            out.had_newline = had_newline;
-            out.oversized = (raw_len > max_line_length);
-            out.raw = bytes_.subspan(line_begin, raw_len);
+        return false;
+    }
 
-            // CRLF tolerance: trim a single trailing '\r' for parsing.
-            if (!out.raw.empty() && out.raw.back() == static_cast<std::byte>('\r'))
+    std::size_t LineScanner::nextBatch(std::span<ScannedLine> out) noexcept
+    {
+        std::size_t count = 0;
+        while (count < out.size() && offset_ < bytes_.size())
+        {
+            if (mask_ == 0 && !loadBlock())
             {
-                out.json = out.raw.first(out.raw.size() - 1);
-                if (out.json.empty())
-                {
-                    // A line containing only "\r" is effectively empty.
-                    continue;
-                }
+                // Last line, without a trailing newline.
+                count += makeScannedLine(bytes_, offset_, bytes_.size(), false, out[count]) ? 1 : 0;
+                offset_ = bytes_.size();
+                break;
             }
-            else
+
+            // Pop every newline of the block straight into `out`.
+            while (mask_ != 0 && count < out.size())
             {
-                out.json = out.raw;
+                const std::size_t newline = block_ + static_cast<std::size_t>(std::countr_zero(mask_));
+                mask_ &= mask_ - 1;
+                count += makeScannedLine(bytes_, offset_, newline, true, out[count]) ? 1 : 0;
+                offset_ = newline + 1;
             }
-
-            return true;
         }
-
-        return false;
+        return count;
     }
 
 } // namespace jlq
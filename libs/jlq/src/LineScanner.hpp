@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <span>
 
 namespace jlq
@@ -32,9 +33,62 @@ namespace jlq
         // Returns false when there are no more lines.
         [[nodiscard]] bool next(ScannedLine &out) noexcept;
 
+        // Fills `out` with up to `out.size()` consecutive non-empty lines.
+        // Returns the number of lines written; 0 means there are no more lines.
+        [[nodiscard]] std::size_t nextBatch(std::span<ScannedLine> out) noexcept;
+
     private:
+        // Newlines are located 64 bytes at a time: each block is turned into a
+        // bitmask (bit i set <=> byte i is '\n') by a SIMD kernel, and line ends are
+        // then popped from the mask with count-trailing-zeros.
+        static constexpr std::size_t block_size = 64;
+        static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+        // Loads the next block's newline mask; false once the input is exhausted.
+        [[nodiscard]] bool loadBlock() noexcept;
+        [[nodiscard]] std::size_t findNewline() noexcept;
+
         std::span<const std::byte> bytes_{};
         std::size_t offset_{0};
+        // Start of the block `mask_` describes, and of the next block to load.
+        std::size_t block_{0};
+        std::size_t next_block_{0};
+        // Newlines in the current block not yet consumed.
+        std::uint64_t mask_{0};
+        // Set when the CPU has AVX2 but the build does not target it.
+        bool avx2_{false};
     };
 
+    // Fills `out` for the line occupying [begin, raw_end) of `bytes`, where
+    // `raw_end` is the position of its '\n' (or bytes.size() for an unterminated
+    // last line). Returns false for lines that are skipped: empty or a lone '\r'.
+    // Shared by every line source so they agree on what a line is.
+    [[nodiscard]] inline bool makeScannedLine(std::span<const std::byte> bytes, std::size_t begin, std::size_t raw_end,
+                                              bool had_newline, ScannedLine &out) noexcept
+    {
+        const std::size_t raw_len = raw_end - begin;
+
+        // Ignore empty lines.
+        if (raw_len == 0)
+        {
+            return false;
+        }
+
+        out = {};
+        out.had_newline = had_newline;
+        out.oversized = (raw_len > LineScanner::max_line_length);
+        out.raw = bytes.subspan(begin, raw_len);
+
+        // CRLF tolerance: trim a single trailing '\r' for parsing.
+        if (out.raw.back() == static_cast<std::byte>('\r'))
+        {
+            out.json = out.raw.first(out.raw.size() - 1);
+            // A line containing only "\r" is effectively empty.
+            return !out.json.empty();
+        }
+
+        out.json = out.raw;
+        return true;
+    }
+
 } // namespace jlq
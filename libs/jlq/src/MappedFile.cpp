@@ -1,5 +1,6 @@
 #include "MappedFile.hpp"
 
+#include <algorithm>
 #include <cerrno>
 #include <cstring>
 #include <stdexcept>
@@ -22,10 +23,16 @@ namespace jlq
             throw std::system_error(std::error_code(err, std::generic_category()), what);
         }
 
+        [[nodiscard]] std::size_t roundUpToPage(std::size_t n)
+        {
+            const auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+            return (n + page - 1) / page * page;
+        }
+
     } // namespace
 
-    MappedFile::MappedFile(int fd, void *mapping, std::size_t size) noexcept
-        : fd_{fd}, mapping_{mapping}, size_{size} {}
+    MappedFile::MappedFile(int fd, void *mapping, std::size_t size, std::size_t mapping_length) noexcept
+        : fd_{fd}, mapping_{mapping}, size_{size}, mapping_length_{mapping_length} {}
 
     MappedFile::MappedFile(MappedFile &&other) noexcept
     {
@@ -42,9 +49,11 @@ namespace jlq
         fd_ = other.fd_;
         mapping_ = other.mapping_;
         size_ = other.size_;
+        mapping_length_ = other.mapping_length_;
         other.fd_ = -1;
         other.mapping_ = nullptr;
         other.size_ = 0;
+        other.mapping_length_ = 0;
         return *this;
     }
 
@@ -54,7 +63,7 @@ namespace jlq
     {
         if (mapping_ != nullptr)
         {
-            ::munmap(mapping_, size_);
+            ::munmap(mapping_, mapping_length_);
             mapping_ = nullptr;
         }
         if (fd_ != -1)
@@ -63,9 +72,10 @@ namespace jlq
             fd_ = -1;
         }
         size_ = 0;
+        mapping_length_ = 0;
     }
 
-    MappedFile MappedFile::openReadonly(const std::string &path)
+    MappedFile MappedFile::openReadonly(const std::string &path, std::size_t padding)
     {
         const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
         if (fd == -1)
@@ -92,18 +102,43 @@ namespace jlq
         const std::size_t size = static_cast<std::size_t>(st.st_size);
         if (size == 0)
         {
-            return MappedFile{fd, nullptr, 0};
+            return MappedFile{fd, nullptr, 0, 0};
+        }
+
+        const std::size_t file_pages = roundUpToPage(size);
+        const std::size_t mapping_length = roundUpToPage(size + padding);
+        if (mapping_length == file_pages)
+        {
+            void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED)
+            {
+                const int err = errno;
+                ::close(fd);
+                throwErrno("mmap", err);
+            }
+            return MappedFile{fd, mapping, size, file_pages};
+        }
+
+        // Reserve file pages + padding pages as anonymous zero memory, then map the
+        // file over the front of the reservation.
+        void *reservation = ::mmap(nullptr, mapping_length, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (reservation == MAP_FAILED)
+        {
+            const int err = errno;
+            ::close(fd);
+            throwErrno("mmap", err);
         }
 
-        void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        void *mapping = ::mmap(reservation, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
         if (mapping == MAP_FAILED)
         {
             const int err = errno;
+            ::munmap(reservation, mapping_length);
             ::close(fd);
             throwErrno("mmap", err);
         }
 
-        return MappedFile{fd, mapping, size};
+        return MappedFile{fd, mapping, size, mapping_length};
     }
 
     std::span<const std::byte> MappedFile::bytes() const noexcept
@@ -119,4 +154,48 @@ namespace jlq
 
     bool MappedFile::empty() const noexcept { return size_ == 0; }
 
+    std::size_t MappedFile::padding() const noexcept { return mapping_length_ - size_; }
+
+    int MappedFile::fd() const noexcept { return fd_; }
+
+    void MappedFile::adviseSequential() const noexcept
+    {
+        if (mapping_ == nullptr)
+        {
+            return;
+        }
+        (void)::madvise(mapping_, size_, MADV_SEQUENTIAL);
+        (void)::madvise(mapping_, size_, MADV_HUGEPAGE);
+    }
+
+    void MappedFile::prefetch(std::size_t offset, std::size_t length) const noexcept
+    {
+        if (mapping_ == nullptr || offset >= size_)
+        {
+            return;
+        }
+        const auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        const std::size_t begin = offset / page * page;
+        const std::size_t end = std::min(offset + length, size_);
+        (void)::madvise(static_cast<std::byte *>(mapping_) + begin, end - begin, MADV_WILLNEED);
+    }
+
+    void MappedFile::release(std::size_t offset, std::size_t length) const noexcept
+    {
+        if (mapping_ == nullptr)
+        {
+            return;
+        }
+        // Only pages wholly inside the range: the rest may still be in use.
+        const auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        const std::size_t begin = roundUpToPage(offset);
+        const std::size_t end = std::min(offset + length, size_) / page * page;
+        if (begin >= end)
+        {
+            return;
+        }
+        (void)::madvise(static_cast<std::byte *>(mapping_) + begin, end - begin, MADV_DONTNEED);
+        (void)::posix_fadvise(fd_, static_cast<off_t>(begin), static_cast<off_t>(end - begin), POSIX_FADV_DONTNEED);
+    }
+
 } // namespace jlq
@@ -20,20 +20,47 @@ namespace jlq
 
         ~MappedFile();
 
-        static MappedFile openReadonly(const std::string &path);
+        // Maps `path` read-only. At least `padding` zero bytes are guaranteed to be
+        // readable past the end of bytes(): the kernel zero-fills the last file page,
+        // and if that slack is too small an anonymous zero page is mapped right after
+        // the file.
+        static MappedFile openReadonly(const std::string &path, std::size_t padding = 0);
 
         [[nodiscard]] std::span<const std::byte> bytes() const noexcept;
         [[nodiscard]] std::size_t size() const noexcept;
         [[nodiscard]] bool empty() const noexcept;
 
+        // Readable zero bytes following bytes() (0 for an empty file).
+        [[nodiscard]] std::size_t padding() const noexcept;
+
+        // Descriptor the file was mapped from; stays open while mapped.
+        [[nodiscard]] int fd() const noexcept;
+
+        // Hints that the mapping will be read front to back: larger kernel
+        // read-ahead (MADV_SEQUENTIAL) and huge pages where the kernel maps
+        // files with them (MADV_HUGEPAGE). Best effort.
+        void adviseSequential() const noexcept;
+
+        // Starts reading the pages of bytes()[offset, offset + length) in the
+        // background (MADV_WILLNEED). Best effort.
+        void prefetch(std::size_t offset, std::size_t length) const noexcept;
+
+        // Drops the whole pages of bytes()[offset, offset + length) from this
+        // process (MADV_DONTNEED) and from the page cache (POSIX_FADV_DONTNEED),
+        // so a scan that is done with them stops holding memory. Reading them
+        // again faults them back in from the file. Best effort.
+        void release(std::size_t offset, std::size_t length) const noexcept;
+
     private:
-        explicit MappedFile(int fd, void *mapping, std::size_t size) noexcept;
+        explicit MappedFile(int fd, void *mapping, std::size_t size, std::size_t mapping_length) noexcept;
 
         void reset() noexcept;
 
         int fd_{-1};
         void *mapping_{nullptr};
         std::size_t size_{0};
+        // Length of the whole mapping, padding pages included.
+        std::size_t mapping_length_{0};
     };
 
 } // namespace jlq
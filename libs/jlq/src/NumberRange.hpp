@@ -0,0 +1,157 @@
+#pragma once
+
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <compare>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+
+namespace jlq
+{
+
+    // An integer number query (--value with --type number), exactly: as int64
+    // or, above INT64_MAX, as uint64.
+    struct IntegerValue
+    {
+        std::int64_t int64{0};
+        std::uint64_t uint64{0};
+        bool is_unsigned{false};
+
+        // Whether `d` is exactly this integer: it must be the integer's
+        // nearest double and convert back to it.
+        [[nodiscard]] bool equals(double d) const noexcept
+        {
+            if (is_unsigned)
+            {
+                return d == static_cast<double>(uint64) && d < 18446744073709551616.0 &&
+                       static_cast<std::uint64_t>(d) == uint64;
+            }
+            return d == static_cast<double>(int64) && d < 9223372036854775808.0 && static_cast<std::int64_t>(d) == int64;
+        }
+
+        // The integer in canonical form (no sign on 0, no leading zeros).
+        [[nodiscard]] std::string text() const
+        {
+            std::array<char, 24> buf{};
+            const auto end = is_unsigned ? std::to_chars(buf.data(), buf.data() + buf.size(), uint64).ptr
+                                         : std::to_chars(buf.data(), buf.data() + buf.size(), int64).ptr;
+            return std::string(buf.data(), end);
+        }
+
+        // Orders by value: an unsigned integer is above every int64.
+        [[nodiscard]] friend std::strong_ordering operator<=>(const IntegerValue &a, const IntegerValue &b) noexcept
+        {
+            if (a.is_unsigned != b.is_unsigned)
+            {
+                return a.is_unsigned ? std::strong_ordering::greater : std::strong_ordering::less;
+            }
+            return a.is_unsigned ? a.uint64 <=> b.uint64 : a.int64 <=> b.int64;
+        }
+
+        [[nodiscard]] friend bool operator==(const IntegerValue &a, const IntegerValue &b) noexcept
+        {
+            return (a <=> b) == 0;
+        }
+    };
+
+    // A JSON number as read for comparisons: integer literals that fit 64 bits
+    // are kept exactly next to their double value.
+    struct NumberValue
+    {
+        double real{0.0};
+        IntegerValue integer{};
+        bool is_integer{false};
+    };
+
+    // Interval of numbers (--gt, --ge, --lt, --le, --between).
+    struct NumberRange
+    {
+        struct Bound
+        {
+            double value;
+            bool inclusive;
+            // The end itself when it was written as an integer that fits 64
+            // bits; `value` is then only its nearest double.
+            std::optional<IntegerValue> integer{};
+        };
+
+        struct IntegerBound
+        {
+            IntegerValue value;
+            bool inclusive;
+        };
+
+        // Unset ends are unbounded.
+        std::optional<Bound> low;
+        std::optional<Bound> high;
+        // Ends for integer values, set when both ends are exact: written as
+        // integers, or other numbers within +-2^62 (rounded to the integers
+        // they admit), or unbounded. Integer values are then compared without
+        // a conversion to double.
+        std::optional<IntegerBound> integer_low;
+        std::optional<IntegerBound> integer_high;
+        bool integer_bounds{false};
+
+        [[nodiscard]] static NumberRange make(std::optional<Bound> low, std::optional<Bound> high) noexcept
+        {
+            constexpr double exact_limit = 4611686018427387904.0; // 2^62
+            auto exact = [](const Bound &bound, bool lower) -> std::optional<IntegerBound>
+            {
+                if (bound.integer.has_value())
+                {
+                    return IntegerBound{*bound.integer, bound.inclusive};
+                }
+                if (std::abs(bound.value) >= exact_limit)
+                {
+                    return std::nullopt;
+                }
+                // x > 2.5 and x >= 3 select the same integers; so do x > 2.0 and x >= 3.
+                const auto floor = static_cast<std::int64_t>(std::floor(bound.value));
+                const auto ceil = static_cast<std::int64_t>(std::ceil(bound.value));
+                const std::int64_t end = lower ? (bound.inclusive ? ceil : floor + 1) : (bound.inclusive ? floor : ceil - 1);
+                return IntegerBound{IntegerValue{end}, true};
+            };
+
+            NumberRange range{low, high, std::nullopt, std::nullopt, true};
+            if (low.has_value())
+            {
+                range.integer_low = exact(*low, true);
+                range.integer_bounds = range.integer_low.has_value();
+            }
+            if (high.has_value())
+            {
+                range.integer_high = exact(*high, false);
+                range.integer_bounds = range.integer_bounds && range.integer_high.has_value();
+            }
+            return range;
+        }
+
+        [[nodiscard]] bool contains(double d) const noexcept
+        {
+            return (!low.has_value() || d > low->value || (low->inclusive && d == low->value)) &&
+                   (!high.has_value() || d < high->value || (high->inclusive && d == high->value));
+        }
+
+        [[nodiscard]] bool contains(const NumberValue &n) const noexcept
+        {
+            if (n.is_integer && integer_bounds)
+            {
+                return (!integer_low.has_value() || n.integer > integer_low->value ||
+                        (integer_low->inclusive && n.integer == integer_low->value)) &&
+                       (!integer_high.has_value() || n.integer < integer_high->value ||
+                        (integer_high->inclusive && n.integer == integer_high->value));
+            }
+            return contains(n.real);
+        }
+
+        // Whether some number in [min, max] may lie in the range.
+        [[nodiscard]] bool overlaps(double min, double max) const noexcept
+        {
+            return (!low.has_value() || max >= low->value) && (!high.has_value() || min <= high->value);
+        }
+    };
+
+} // namespace jlq
@@ -0,0 +1,219 @@
+#include "OutputSink.hpp"
+
+#include <array>
+#include <cerrno>
+#include <string_view>
+#include <system_error>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace jlq
+{
+
+    namespace
+    {
+
+        // Linux caps writev() at IOV_MAX == 1024 entries.
+        constexpr std::size_t iov_batch = 1024;
+
+        // Below this a copy through writev() is cheaper than an extra system call.
+        constexpr std::size_t zero_copy_min_bytes = 64 * 1024;
+
+        [[noreturn]] void throwErrno(const char *what, int err)
+        {
+            throw std::system_error(std::error_code(err, std::generic_category()), what);
+        }
+
+        // For descriptors the caller left in non-blocking mode.
+        void waitWritable(int fd)
+        {
+            pollfd pfd{fd, POLLOUT, 0};
+            while (::poll(&pfd, 1, -1) < 0 && errno == EINTR)
+            {
+            }
+        }
+
+        void writeAll(int fd, std::span<iovec> iov)
+        {
+            while (!iov.empty())
+            {
+                const ssize_t n = ::writev(fd, iov.data(), static_cast<int>(iov.size()));
+                if (n < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    {
+                        waitWritable(fd);
+                        continue;
+                    }
+                    throwErrno("write", errno);
+                }
+
+                auto written = static_cast<std::size_t>(n);
+                while (!iov.empty() && written >= iov.front().iov_len)
+                {
+                    written -= iov.front().iov_len;
+                    iov = iov.subspan(1);
+                }
+                if (!iov.empty())
+                {
+                    iov.front().iov_base = static_cast<char *>(iov.front().iov_base) + written;
+                    iov.front().iov_len -= written;
+                }
+            }
+        }
+
+    } // namespace
+
+    OutputSink::OutputSink()
+    {
+        pending_.reserve(max_pending_ranges);
+    }
+
+    void OutputSink::flush()
+    {
+        if (pending_.empty())
+        {
+            return;
+        }
+        writeRanges(pending_);
+        pending_.clear();
+        pending_bytes_ = 0;
+    }
+
+    void OutputSink::write(std::span<const std::byte> bytes)
+    {
+        flush();
+        const std::span<const std::byte> ranges[] = {bytes};
+        writeRanges(ranges);
+    }
+
+    void StreamSink::writeRanges(std::span<const std::span<const std::byte>> ranges)
+    {
+        for (const auto range : ranges)
+        {
+            out_.write(reinterpret_cast<const char *>(range.data()), static_cast<std::streamsize>(range.size()));
+        }
+    }
+
+    void BufferSink::writeRanges(std::span<const std::span<const std::byte>> ranges)
+    {
+        for (const auto range : ranges)
+        {
+            std::string_view rest(reinterpret_cast<const char *>(range.data()), range.size());
+            if (prefix_.empty())
+            {
+                buffer_.append(rest);
+                continue;
+            }
+            while (!rest.empty())
+            {
+                if (at_line_start_)
+                {
+                    buffer_.append(prefix_);
+                }
+                const std::size_t newline = rest.find('\n');
+                const std::size_t take = (newline == std::string_view::npos) ? rest.size() : newline + 1;
+                buffer_.append(rest.substr(0, take));
+                at_line_start_ = (newline != std::string_view::npos);
+                rest.remove_prefix(take);
+            }
+        }
+    }
+
+    FdSink::FdSink(int fd, ZeroCopySource source) : fd_{fd}, source_{source}
+    {
+#if defined(__linux__)
+        struct stat st
+        {
+        };
+        if (source_.fd == -1 || source_.bytes.empty() || ::fstat(fd_, &st) != 0)
+        {
+            return;
+        }
+        if (S_ISFIFO(st.st_mode))
+        {
+            zero_copy_ = ZeroCopy::Splice;
+        }
+        else if (S_ISREG(st.st_mode) && (::fcntl(fd_, F_GETFL) & O_APPEND) == 0)
+        {
+            // copy_file_range() rejects O_APPEND destinations.
+            zero_copy_ = ZeroCopy::CopyFileRange;
+        }
+#endif
+    }
+
+    void FdSink::writeRanges(std::span<const std::span<const std::byte>> ranges)
+    {
+        std::array<iovec, iov_batch> iov{};
+        std::size_t count = 0;
+
+        for (auto range : ranges)
+        {
+            if (zero_copy_ != ZeroCopy::None && range.size() >= zero_copy_min_bytes &&
+                range.data() >= source_.bytes.data() &&
+                range.data() + range.size() <= source_.bytes.data() + source_.bytes.size())
+            {
+                writeAll(fd_, std::span(iov).first(count));
+                count = 0;
+                range = range.subspan(transferFromSource(range));
+                if (range.empty())
+                {
+                    continue;
+                }
+            }
+
+            iov[count++] = iovec{const_cast<std::byte *>(range.data()), range.size()};
+            if (count == iov.size())
+            {
+                writeAll(fd_, iov);
+                count = 0;
+            }
+        }
+        writeAll(fd_, std::span(iov).first(count));
+    }
+
+    std::size_t FdSink::transferFromSource(std::span<const std::byte> range)
+    {
+        std::size_t done = 0;
+#if defined(__linux__)
+        auto offset = static_cast<loff_t>(range.data() - source_.bytes.data());
+        while (done < range.size())
+        {
+            const ssize_t n = (zero_copy_ == ZeroCopy::Splice)
+                                  ? ::splice(source_.fd, &offset, fd_, nullptr, range.size() - done, SPLICE_F_MORE)
+                                  : ::copy_file_range(source_.fd, &offset, fd_, nullptr, range.size() - done, 0);
+            if (n > 0)
+            {
+                done += static_cast<std::size_t>(n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                waitWritable(fd_);
+                continue;
+            }
+
+            // Unsupported file system, file shrunk under the mapping, or a real
+            // write error: writev() takes the rest and reports genuine failures.
+            zero_copy_ = ZeroCopy::None;
+            break;
+        }
+#else
+        (void)range;
+#endif
+        return done;
+    }
+
+} // namespace jlq
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace jlq
+{
+
+    // Destination for matched lines.
+    //
+    // append() only records a byte range; the bytes must stay valid until the
+    // next flush(). Adjacent ranges are merged and ranges are handed to the
+    // backend in batches, so writing a match costs no copy and no virtual call.
+    class OutputSink
+    {
+    public:
+        OutputSink(const OutputSink &) = delete;
+        OutputSink &operator=(const OutputSink &) = delete;
+
+        virtual ~OutputSink() = default;
+
+        void append(std::span<const std::byte> bytes)
+        {
+            if (bytes.empty())
+            {
+                return;
+            }
+            pending_bytes_ += bytes.size();
+            if (!pending_.empty() && pending_.back().data() + pending_.back().size() == bytes.data())
+            {
+                pending_.back() = {pending_.back().data(), pending_.back().size() + bytes.size()};
+            }
+            else
+            {
+                pending_.push_back(bytes);
+            }
+            if (pending_.size() == max_pending_ranges || pending_bytes_ >= max_pending_bytes)
+            {
+                flush();
+            }
+        }
+
+        // Writes all pending ranges. Throws std::system_error on write failure.
+        void flush();
+
+        // Writes `bytes` after the pending ranges, before returning; for output
+        // that does not outlive the call (e.g. a formatted count).
+        void write(std::span<const std::byte> bytes);
+
+    protected:
+        OutputSink();
+
+        // Writes `ranges` in order, completely.
+        virtual void writeRanges(std::span<const std::span<const std::byte>> ranges) = 0;
+
+    private:
+        // One writev() worth of ranges; the byte cap bounds output latency for
+        // consumers such as `head`.
+        static constexpr std::size_t max_pending_ranges = 1024;
+        static constexpr std::size_t max_pending_bytes = 1ULL << 20;
+
+        std::vector<std::span<const std::byte>> pending_;
+        std::size_t pending_bytes_{0};
+    };
+
+    // Writes through a std::ostream (tests, embedding).
+    class StreamSink final : public OutputSink
+    {
+    public:
+        explicit StreamSink(std::ostream &out) noexcept : out_{out} {}
+
+    private:
+        void writeRanges(std::span<const std::span<const std::byte>> ranges) override;
+
+        std::ostream &out_;
+    };
+
+    // Copies the output into memory, to be written elsewhere later (e.g. in input
+    // order after parallel work). With a `line_prefix`, it is inserted before
+    // every line.
+    class BufferSink final : public OutputSink
+    {
+    public:
+        explicit BufferSink(std::string line_prefix = {}) : prefix_{std::move(line_prefix)} {}
+
+        // The output so far (flush() first).
+        [[nodiscard]] std::string &buffer() noexcept { return buffer_; }
+
+    private:
+        void writeRanges(std::span<const std::span<const std::byte>> ranges) override;
+
+        std::string prefix_;
+        std::string buffer_;
+        bool at_line_start_{true};
+    };
+
+    // File the appended ranges may point into. Ranges inside `bytes` can then be
+    // copied by the kernel from `fd` at the matching offset.
+    struct ZeroCopySource
+    {
+        int fd{-1};
+        std::span<const std::byte> bytes{};
+    };
+
+    // Writes to a file descriptor with writev(). Large ranges that lie inside the
+    // zero-copy source are moved by the kernel instead: splice() when `fd` is a
+    // pipe, copy_file_range() when it is a regular file. If the kernel refuses,
+    // the sink falls back to writev() for good. `fd` is not owned.
+    class FdSink final : public OutputSink
+    {
+    public:
+        explicit FdSink(int fd, ZeroCopySource source = {});
+
+    private:
+        enum class ZeroCopy
+        {
+            None,
+            Splice,
+            CopyFileRange,
+        };
+
+        void writeRanges(std::span<const std::span<const std::byte>> ranges) override;
+
+        // Moves a prefix of `range` from the source file; returns its length.
+        [[nodiscard]] std::size_t transferFromSource(std::span<const std::byte> range);
+
+        int fd_;
+        ZeroCopySource source_;
+        ZeroCopy zero_copy_{ZeroCopy::None};
+    };
+
+} // namespace jlq
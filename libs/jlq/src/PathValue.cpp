@@ -0,0 +1,206 @@
+#include "PathValue.hpp"
+
+#include "JsonPath.hpp"
+
+#include <bit>
+#include <cstring>
+#include <type_traits>
+#include <variant>
+
+namespace jlq
+{
+
+    namespace
+    {
+
+        // FNV-1a followed by a murmur3 finalizer to spread the low bits used for
+        // bucketing. Unlike std::hash it is the same in every build.
+        class KeyHasher
+        {
+        public:
+            void add(std::span<const std::byte> bytes) noexcept
+            {
+                for (const std::byte b : bytes)
+                {
+                    h_ = (h_ ^ static_cast<std::uint8_t>(b)) * 0x100000001b3ULL;
+                }
+            }
+
+            void add(std::uint8_t tag) noexcept { add(std::as_bytes(std::span(&tag, 1))); }
+
+            [[nodiscard]] std::uint64_t finish() const noexcept { return mix64(h_); }
+
+        private:
+            std::uint64_t h_{0xcbf29ce484222325ULL};
+        };
+
+        enum KeyTag : std::uint8_t
+        {
+            tag_string = 's',
+            tag_number = 'n',
+            tag_bool = 'b',
+            tag_null = 'z',
+        };
+
+        [[nodiscard]] std::uint64_t hashString(std::string_view s) noexcept
+        {
+            KeyHasher h;
+            h.add(tag_string);
+            h.add(std::as_bytes(std::span(s)));
+            return h.finish();
+        }
+
+        [[nodiscard]] std::uint64_t hashNumber(double d) noexcept
+        {
+            // -0.0 == 0.0 for the query, so they must share a key.
+            const auto bits = std::bit_cast<std::uint64_t>(d == 0.0 ? 0.0 : d);
+            KeyHasher h;
+            h.add(tag_number);
+            h.add(std::as_bytes(std::span(&bits, 1)));
+            return h.finish();
+        }
+
+        [[nodiscard]] std::uint64_t hashBool(bool b) noexcept
+        {
+            KeyHasher h;
+            h.add(tag_bool);
+            h.add(static_cast<std::uint8_t>(b));
+            return h.finish();
+        }
+
+        [[nodiscard]] std::uint64_t hashNull() noexcept
+        {
+            KeyHasher h;
+            h.add(tag_null);
+            return h.finish();
+        }
+
+        [[nodiscard]] PathValue fromError(simdjson::error_code ec) noexcept
+        {
+            return PathValue{isNonMatchError(ec) ? PathValueKind::None : PathValueKind::Irregular};
+        }
+
+        // Reads `value` with the getter a query of the value's own type would use.
+        [[nodiscard]] PathValue classify(simdjson::ondemand::value value)
+        {
+            simdjson::ondemand::json_type type{};
+            if (const auto ec = value.type().get(type))
+            {
+                return fromError(ec);
+            }
+
+            PathValue out;
+            switch (type)
+            {
+            case simdjson::ondemand::json_type::string:
+                if (const auto ec = value.get_string().get(out.string))
+                {
+                    return fromError(ec);
+                }
+                out.kind = PathValueKind::String;
+                return out;
+            case simdjson::ondemand::json_type::number:
+                if (const auto ec = value.get_double().get(out.number))
+                {
+                    return fromError(ec);
+                }
+                out.kind = PathValueKind::Number;
+                return out;
+            case simdjson::ondemand::json_type::boolean:
+                if (const auto ec = value.get_bool().get(out.boolean))
+                {
+                    return fromError(ec);
+                }
+                out.kind = PathValueKind::Bool;
+                return out;
+            case simdjson::ondemand::json_type::null:
+            {
+                bool is_null = false;
+                if (const auto ec = value.is_null().get(is_null))
+                {
+                    return fromError(ec);
+                }
+                out.kind = is_null ? PathValueKind::Null : PathValueKind::None;
+                return out;
+            }
+            default:
+                return out;
+            }
+        }
+
+    } // namespace
+
+    PathValue PathValueReader::read(const ScannedLine &line)
+    {
+        if (line.oversized)
+        {
+            return PathValue{PathValueKind::Irregular};
+        }
+
+        const std::size_t len = line.json.size();
+        scratch_.resize(len + simdjson::SIMDJSON_PADDING);
+        std::memcpy(scratch_.data(), line.json.data(), len);
+        std::memset(scratch_.data() + len, 0, simdjson::SIMDJSON_PADDING);
+
+        try
+        {
+            simdjson::ondemand::document doc;
+            if (parser_.iterate(scratch_.data(), len, scratch_.size()).get(doc))
+            {
+                return PathValue{PathValueKind::Irregular};
+            }
+            simdjson::ondemand::value value;
+            if (const auto ec = findPath(doc, path_, value))
+            {
+                return fromError(ec);
+            }
+            return classify(value);
+        }
+        catch (const simdjson::simdjson_error &)
+        {
+            return PathValue{PathValueKind::Irregular};
+        }
+    }
+
+    std::uint64_t valueHash(const PathValue &value) noexcept
+    {
+        switch (value.kind)
+        {
+        case PathValueKind::String:
+            return hashString(value.string);
+        case PathValueKind::Number:
+            return hashNumber(value.number);
+        case PathValueKind::Bool:
+            return hashBool(value.boolean);
+        default:
+            return hashNull();
+        }
+    }
+
+    std::uint64_t valueHash(const QueryValue &value) noexcept
+    {
+        return std::visit(
+            [](const auto &v) -> std::uint64_t
+            {
+                using T = std::decay_t<decltype(v)>;
+                if constexpr (std::is_same_v<T, std::string_view>)
+                {
+                    return hashString(v);
+                }
+                else if constexpr (std::is_same_v<T, double>)
+                {
+                    return hashNumber(v);
+                }
+                else if constexpr (std::is_same_v<T, bool>)
+                {
+                    return hashBool(v);
+                }
+                else
+                {
+                    return hashNull();
+                }
+            },
+            value);
+    }
+
+} // namespace jlq
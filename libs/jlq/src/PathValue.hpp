@@ -0,0 +1,71 @@
+#pragma once
+
+#include "LineScanner.hpp"
+#include "QueryConfig.hpp"
+
+#include <simdjson.h>
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace jlq
+{
+
+    enum class PathValueKind
+    {
+        String,
+        Number,
+        Bool,
+        Null,
+        // Nothing a query could match: path missing, object, array, ...
+        None,
+        // A query could report the line as malformed: unparsable, oversized, or
+        // an invalid value at the path.
+        Irregular,
+    };
+
+    // The value at a path, read the way a query of the value's own type reads it:
+    // strings unescaped, numbers as doubles.
+    struct PathValue
+    {
+        PathValueKind kind{PathValueKind::None};
+        // Valid until the next PathValueReader::read().
+        std::string_view string{};
+        double number{0.0};
+        bool boolean{false};
+    };
+
+    // Extracts the value at one path from lines, for building sidecar indexes.
+    class PathValueReader
+    {
+    public:
+        explicit PathValueReader(std::span<const PathSegment> path) noexcept : path_{path} {}
+
+        [[nodiscard]] PathValue read(const ScannedLine &line);
+
+    private:
+        std::span<const PathSegment> path_;
+        simdjson::ondemand::parser parser_;
+        std::vector<char> scratch_;
+    };
+
+    // Stable 64-bit hashes (identical across builds, safe to store on disk) under
+    // which values a query considers equal collide: -0 and 0 included. `value`
+    // must be a String, Number, Bool or Null.
+    [[nodiscard]] std::uint64_t valueHash(const PathValue &value) noexcept;
+    [[nodiscard]] std::uint64_t valueHash(const QueryValue &value) noexcept;
+
+    // The murmur3 64-bit finalizer: spreads every input bit over the result.
+    [[nodiscard]] inline std::uint64_t mix64(std::uint64_t h) noexcept
+    {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+} // namespace jlq
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "JsonPath.hpp"
+#include "QueryConfig.hpp"
+
+#include <simdjson.h>
+
+#include <string>
+#include <string_view>
+
+namespace jlq
+{
+
+    // Appends `text` as a JSON string literal, with the short escapes where
+    // there are any.
+    inline void appendJsonString(std::string &out, std::string_view text)
+    {
+        static constexpr char hex[] = "0123456789abcdef";
+        out.push_back('"');
+        for (const char c : text)
+        {
+            switch (c)
+            {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\b':
+                out += "\\b";
+                break;
+            case '\f':
+                out += "\\f";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    out += "\\u00";
+                    out.push_back(hex[static_cast<unsigned char>(c) >> 4]);
+                    out.push_back(hex[static_cast<unsigned char>(c) & 0xf]);
+                }
+                else
+                {
+                    out.push_back(c);
+                }
+            }
+        }
+        out.push_back('"');
+    }
+
+    // Replaces `out` with the line `projection` prints for `doc` (an
+    // ondemand::document or a document_reference), built from the raw bytes of
+    // the selected values: nothing is unescaped or re-serialized. The document
+    // is rewound for each path, so the line's structural index is reused rather
+    // than rebuilt. A path that is missing (or not comparable, as for a query)
+    // prints null in JSON and nothing in TSV; any other error makes the line
+    // malformed.
+    template <typename Document>
+    [[nodiscard]] MatchResult projectValues(Document &doc, const Projection &projection, std::string &out)
+    {
+        const bool json = (projection.format == ProjectionFormat::Json);
+        out.clear();
+        for (std::size_t i = 0; i < projection.paths.size(); ++i)
+        {
+            if (json)
+            {
+                out.push_back(i == 0 ? '{' : ',');
+                appendJsonString(out, projection.names[i]);
+                out.push_back(':');
+            }
+            else if (i != 0)
+            {
+                out.push_back('\t');
+            }
+
+            doc.rewind();
+            simdjson::ondemand::value value;
+            std::string_view raw;
+            simdjson::error_code ec = findPath(doc, projection.paths[i], value);
+            if (!ec)
+            {
+                ec = value.raw_json().get(raw);
+            }
+            if (ec)
+            {
+                if (!isNonMatchError(ec))
+                {
+                    return MatchResult::Malformed;
+                }
+                if (json)
+                {
+                    out += "null";
+                }
+                continue;
+            }
+
+            raw = trimJsonToken(raw);
+            if (json)
+            {
+                out += raw;
+            }
+            else if (raw.size() >= 2 && raw.front() == '"')
+            {
+                // Escapes stay escaped, so a string never holds a tab or newline.
+                out += raw.substr(1, raw.size() - 2);
+            }
+            else
+            {
+                // Whitespace inside an object or array may include tabs.
+                for (const char c : raw)
+                {
+                    out.push_back((c == '\t' || c == '\r') ? ' ' : c);
+                }
+            }
+        }
+        if (json)
+        {
+            out += projection.paths.empty() ? "{}" : "}";
+        }
+        out.push_back('\n');
+        return MatchResult::Match;
+    }
+
+} // namespace jlq
@@ -1,9 +1,30 @@
 #include "Query.hpp"
+#include "BoundedQueue.hpp"
+#include "FilterPlan.hpp"
+#include "JsonPath.hpp"
+#include "LineIndex.hpp"
 #include "LineScanner.hpp"
+#include "Projection.hpp"
+#include "ValueSet.hpp"
+#include "ZoneMap.hpp"
 
 #include <simdjson.h>
 
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstring>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace jlq
@@ -12,209 +33,1447 @@ namespace jlq
     namespace
     {
 
-        enum class MatchResult
+        MatchResult rangeMatches(simdjson::ondemand::value value, const NumberRange &range)
+        {
+            NumberValue number;
+            if (const auto ec = readNumber(value, range.integer_bounds, number))
+            {
+                return classifyError(ec);
+            }
+            return range.contains(number) ? MatchResult::Match : MatchResult::NoMatch;
+        }
+
+        MatchResult setMatches(simdjson::ondemand::value value, const ValueSet &values)
         {
-            Match,
-            NoMatch,
-            Malformed,
+            // Read with the getter of the value's own type, as a single value
+            // of that type would be compared.
+            simdjson::ondemand::json_type type{};
+            if (const auto ec = value.type().get(type))
+            {
+                return classifyError(ec);
+            }
+            QueryValue actual;
+            simdjson::error_code ec = simdjson::SUCCESS;
+            switch (type)
+            {
+            case simdjson::ondemand::json_type::string:
+            {
+                std::string_view s;
+                ec = readString(value, s);
+                actual = s;
+                break;
+            }
+            case simdjson::ondemand::json_type::number:
+            {
+                NumberValue number;
+                if (const auto number_ec = readNumber(value, values.hasIntegers(), number))
+                {
+                    return classifyError(number_ec);
+                }
+                return values.contains(number) ? MatchResult::Match : MatchResult::NoMatch;
+            }
+            case simdjson::ondemand::json_type::boolean:
+            {
+                bool b = false;
+                ec = value.get_bool().get(b);
+                actual = b;
+                break;
+            }
+            case simdjson::ondemand::json_type::null:
+            {
+                bool is_null = false;
+                ec = value.is_null().get(is_null);
+                if (!ec && !is_null)
+                {
+                    ec = simdjson::INCORRECT_TYPE;
+                }
+                break;
+            }
+            default:
+                return MatchResult::NoMatch;
+            }
+            if (ec)
+            {
+                return classifyError(ec);
+            }
+            return values.contains(actual) ? MatchResult::Match : MatchResult::NoMatch;
+        }
+
+        // How a compiled matcher compares the value at the query path.
+        enum class Comparison
+        {
+            String,
+            Number,
+            Integer,
+            Bool,
+            Null,
+            Range,
+            Set,
         };
 
-        [[nodiscard]] MatchResult classifyError(simdjson::error_code ec) noexcept
+        // The query value in the forms the compiled matcher compares, derived
+        // once per worker.
+        struct Operand
         {
-            if (ec == simdjson::SUCCESS)
+            explicit Operand(const QueryConfig &config)
             {
-                return MatchResult::Match;
+                if (const auto *s = std::get_if<std::string_view>(&config.value))
+                {
+                    appendJsonString(quoted, *s);
+                }
+                if (config.integer_value.has_value())
+                {
+                    integer_text = config.integer_value->text();
+                }
             }
 
-            // Non-fatal for query semantics: treat as non-match.
-            if (ec == simdjson::NO_SUCH_FIELD || ec == simdjson::INCORRECT_TYPE ||
-                ec == simdjson::NUMBER_OUT_OF_RANGE || ec == simdjson::BIGINT_ERROR ||
-                ec == simdjson::INDEX_OUT_OF_BOUNDS)
+            // A string value as the JSON literal encoders usually write for it.
+            std::string quoted;
+            // An integer value in canonical form (no sign on 0, no leading zeros).
+            std::string integer_text;
+        };
+
+        template <Comparison C>
+        MatchResult compareValue(simdjson::ondemand::value value, const QueryConfig &config, const Operand &operand)
+        {
+            if constexpr (C == Comparison::String)
             {
-                return MatchResult::NoMatch;
+                // Most tokens are compared as written. A token without a
+                // backslash holds the string's own bytes, so the literal
+                // decides; only an escaped one can spell the value differently
+                // and is unescaped. Tokens of other types fail get_string()
+                // with INCORRECT_TYPE, a non-match either way.
+                const std::string_view raw = value.raw_json_token();
+                if (raw.starts_with(operand.quoted))
+                {
+                    return MatchResult::Match;
+                }
+                if (raw.find('\\') == std::string_view::npos)
+                {
+                    return MatchResult::NoMatch;
+                }
+                std::string_view s;
+                if (const auto ec = value.get_string().get(s))
+                {
+                    return classifyError(ec);
+                }
+                return (s == *std::get_if<std::string_view>(&config.value)) ? MatchResult::Match : MatchResult::NoMatch;
+            }
+            else if constexpr (C == Comparison::Number)
+            {
+                double d = 0.0;
+                if (const auto ec = value.get_double().get(d))
+                {
+                    return classifyError(ec);
+                }
+                return (d == *std::get_if<double>(&config.value)) ? MatchResult::Match : MatchResult::NoMatch;
+            }
+            else if constexpr (C == Comparison::Integer)
+            {
+                return integerMatches(value, *config.integer_value, operand.integer_text);
+            }
+            else if constexpr (C == Comparison::Bool)
+            {
+                bool b = false;
+                if (const auto ec = value.get_bool().get(b))
+                {
+                    return classifyError(ec);
+                }
+                return (b == *std::get_if<bool>(&config.value)) ? MatchResult::Match : MatchResult::NoMatch;
+            }
+            else if constexpr (C == Comparison::Null)
+            {
+                bool is_null = false;
+                if (const auto ec = value.is_null().get(is_null))
+                {
+                    return classifyError(ec);
+                }
+                return is_null ? MatchResult::Match : MatchResult::NoMatch;
+            }
+            else if constexpr (C == Comparison::Range)
+            {
+                return rangeMatches(value, *config.range);
+            }
+            else
+            {
+                return setMatches(value, *config.values);
+            }
+        }
+
+        // findPath() for a path of `Depth` keys: with the segment kinds known,
+        // the walk unrolls into one object lookup per segment.
+        template <std::size_t Depth, typename Document>
+        simdjson::error_code findKeyPath(Document &doc, std::span<const PathSegment> path,
+                                         simdjson::ondemand::value &out)
+        {
+            simdjson::ondemand::value current = doc;
+            for (std::size_t i = 0; i < Depth; ++i)
+            {
+                simdjson::ondemand::object obj;
+                if (const auto ec = current.get_object().get(obj))
+                {
+                    return ec;
+                }
+                if (const auto ec = obj.find_field_unordered(path[i].key).get(current))
+                {
+                    return ec;
+                }
+            }
+            out = current;
+            return simdjson::SUCCESS;
+        }
+
+        // The query (without a filter) on one document: `Depth` keys, or any
+        // path with 0, then the comparison.
+        template <std::size_t Depth, Comparison C, typename Document>
+        MatchResult matchCompiled(Document &doc, const QueryConfig &config, const Operand &operand)
+        {
+            simdjson::ondemand::value current;
+            simdjson::error_code ec;
+            if constexpr (Depth == 0)
+            {
+                ec = findPath(doc, config.path_segments, current);
+            }
+            else
+            {
+                ec = findKeyPath<Depth>(doc, config.path_segments, current);
+            }
+            if (ec)
+            {
+                return classifyError(ec);
+            }
+            return compareValue<C>(current, config, operand);
+        }
+
+        template <typename Document>
+        using MatchFn = MatchResult (*)(Document &, const QueryConfig &, const Operand &);
+
+        template <Comparison C, typename Document>
+        [[nodiscard]] MatchFn<Document> compileForPath(std::span<const PathSegment> path) noexcept
+        {
+            const bool keys = std::ranges::all_of(path, [](const PathSegment &seg)
+                                                  { return seg.kind == PathSegmentKind::Key; });
+            switch (keys ? path.size() : 0)
+            {
+            case 1:
+                return &matchCompiled<1, C, Document>;
+            case 2:
+                return &matchCompiled<2, C, Document>;
+            case 3:
+                return &matchCompiled<3, C, Document>;
+            case 4:
+                return &matchCompiled<4, C, Document>;
+            default:
+                return &matchCompiled<0, C, Document>;
+            }
+        }
+
+        // Picks the matcher for the query's comparison and path shape, so a
+        // line costs one indirect call instead of a visit over the value type
+        // and a branch per path segment.
+        template <typename Document>
+        [[nodiscard]] MatchFn<Document> compileMatcher(const QueryConfig &config) noexcept
+        {
+            const std::span<const PathSegment> path = config.path_segments;
+            if (config.values != nullptr)
+            {
+                return compileForPath<Comparison::Set, Document>(path);
+            }
+            if (config.range.has_value())
+            {
+                return compileForPath<Comparison::Range, Document>(path);
+            }
+            if (std::holds_alternative<std::string_view>(config.value))
+            {
+                return compileForPath<Comparison::String, Document>(path);
+            }
+            if (config.integer_value.has_value())
+            {
+                return compileForPath<Comparison::Integer, Document>(path);
+            }
+            if (std::holds_alternative<double>(config.value))
+            {
+                return compileForPath<Comparison::Number, Document>(path);
+            }
+            if (std::holds_alternative<bool>(config.value))
+            {
+                return compileForPath<Comparison::Bool, Document>(path);
+            }
+            return compileForPath<Comparison::Null, Document>(path);
+        }
+
+        // Per-thread parsing state. simdjson parsers are not thread-safe, so every
+        // worker owns one together with the scratch buffer it falls back to.
+        struct LineWorker
+        {
+            LineWorker(const QueryInput &input, const QueryConfig &config)
+                : readable_end{input.bytes.data() + input.bytes.size() + input.padding},
+                  operand{config},
+                  match_line{compileMatcher<simdjson::ondemand::document>(config)},
+                  match_stream{compileMatcher<simdjson::ondemand::document_reference>(config)}
+            {
+                if (config.filter.has_value())
+                {
+                    filter.emplace(config);
+                }
+            }
+
+            simdjson::ondemand::parser parser;
+            // Drives document_stream windows (ParseEngine::Stream). Kept apart from
+            // `parser` so per-line fallbacks can run while a stream is open.
+            simdjson::ondemand::parser stream_parser;
+            // Only used for lines too close to the end of the readable input; grows
+            // to the longest such line.
+            std::vector<char> scratch;
+            // One past the last byte that may be read, padding included.
+            const std::byte *readable_end;
+            // Compiled per worker, so evaluation state stays thread-local.
+            std::optional<FilterPlan> filter;
+            FilterPlan::Scratch filter_scratch;
+            // The query without a filter, for each document type.
+            Operand operand;
+            MatchFn<simdjson::ondemand::document> match_line;
+            MatchFn<simdjson::ondemand::document_reference> match_stream;
+            // What the last matching line prints, with a projection.
+            std::string projected;
+            // The --group-by and --distinct values of the last matching line,
+            // views into it, added below once the line is committed.
+            std::string_view group_value;
+            std::string_view distinct_value;
+            // This worker's matches per --group-by value.
+            GroupCounts groups;
+            // This worker's --distinct values.
+            HyperLogLog distinct;
+        };
+
+        // Whether matches print projected values rather than the lines.
+        [[nodiscard]] bool projecting(const QueryConfig &config) noexcept
+        {
+            return config.projection.has_value() && config.output == OutputMode::Lines;
+        }
+
+        // `Document` is an ondemand::document or, for streamed input, a document_reference.
+        template <typename Document>
+        MatchResult matchDocument(LineWorker &worker, Document &doc, const QueryConfig &config)
+        {
+            if (worker.filter.has_value())
+            {
+                return worker.filter->evaluate(doc, worker.filter_scratch);
+            }
+            if constexpr (std::is_same_v<Document, simdjson::ondemand::document>)
+            {
+                return worker.match_line(doc, config, worker.operand);
+            }
+            else
+            {
+                return worker.match_stream(doc, config, worker.operand);
+            }
+        }
+
+        // Sets `raw` to the bytes of `doc`'s value at `path`, or to an empty
+        // view if there is none. Errors other than a missing value make the
+        // line malformed.
+        template <typename Document>
+        MatchResult rawValueAt(Document &doc, std::span<const PathSegment> path, std::string_view &raw)
+        {
+            doc.rewind();
+            simdjson::ondemand::value value;
+            simdjson::error_code ec = findPath(doc, path, value);
+            if (!ec)
+            {
+                ec = value.raw_json().get(raw);
+            }
+            if (ec)
+            {
+                raw = {};
+                return isNonMatchError(ec) ? MatchResult::Match : MatchResult::Malformed;
+            }
+            raw = trimJsonToken(raw);
+            return MatchResult::Match;
+        }
+
+        // Whether matches are counted per value rather than printed.
+        [[nodiscard]] bool aggregating(const QueryConfig &config) noexcept
+        {
+            return (config.group_by.has_value() || config.distinct.has_value()) && config.output == OutputMode::Count;
+        }
+
+        // Reads the --group-by value (a missing one counts as null) and the
+        // --distinct value of a matching `doc` into the worker.
+        template <typename Document>
+        MatchResult collectAggregates(LineWorker &worker, Document &doc, const QueryConfig &config)
+        {
+            if (config.group_by.has_value())
+            {
+                if (rawValueAt(doc, *config.group_by, worker.group_value) == MatchResult::Malformed)
+                {
+                    return MatchResult::Malformed;
+                }
+                if (worker.group_value.empty())
+                {
+                    worker.group_value = "null";
+                }
+            }
+            if (config.distinct.has_value() &&
+                rawValueAt(doc, *config.distinct, worker.distinct_value) == MatchResult::Malformed)
+            {
+                return MatchResult::Malformed;
+            }
+            return MatchResult::Match;
+        }
+
+        // Adds the values collected for a line to the worker's aggregates once
+        // its result is final. The stream engine may evaluate a line and then
+        // re-parse it on its own, so collecting alone must not count it.
+        void commitAggregates(LineWorker &worker, const QueryConfig &config, MatchResult result)
+        {
+            if (result != MatchResult::Match || !aggregating(config))
+            {
+                return;
+            }
+            if (config.group_by.has_value())
+            {
+                worker.groups.add(worker.group_value);
+            }
+            if (config.distinct.has_value() && !worker.distinct_value.empty())
+            {
+                worker.distinct.add(worker.distinct_value);
+            }
+        }
+
+        // Evaluates the query on `doc`; with a projection, a match also leaves
+        // its output in `worker.projected`, and with --group-by or --distinct
+        // its values for commitAggregates(), all read from the same parse.
+        template <typename Document>
+        MatchResult traverseAndMatch(LineWorker &worker, Document &doc, const QueryConfig &config)
+        {
+            const MatchResult result = matchDocument(worker, doc, config);
+            if (result != MatchResult::Match)
+            {
+                return result;
+            }
+            if (projecting(config))
+            {
+                return projectValues(doc, *config.projection, worker.projected);
+            }
+            if (aggregating(config))
+            {
+                return collectAggregates(worker, doc, config);
+            }
+            return result;
+        }
+
+        // Parses a single scanned line and evaluates the query against it.
+        // Oversized lines and JSON errors are reported as MatchResult::Malformed.
+        //
+        // simdjson may read up to SIMDJSON_PADDING bytes past the end of the JSON.
+        // Lines followed by that many readable bytes (all but the last few of a
+        // mapping) are parsed in place; the rest are copied into the zero-padded
+        // scratch buffer.
+        MatchResult matchLine(LineWorker &worker, const ScannedLine &line, const QueryConfig &config)
+        {
+            if (line.oversized)
+            {
+                return MatchResult::Malformed;
+            }
+
+            const std::size_t json_len = line.json.size();
+            const char *json = reinterpret_cast<const char *>(line.json.data());
+            const auto readable_after = static_cast<std::size_t>(worker.readable_end - (line.json.data() + json_len));
+            if (readable_after < simdjson::SIMDJSON_PADDING)
+            {
+                worker.scratch.resize(json_len + simdjson::SIMDJSON_PADDING);
+                std::memcpy(worker.scratch.data(), json, json_len);
+                std::memset(worker.scratch.data() + json_len, 0, simdjson::SIMDJSON_PADDING);
+                json = worker.scratch.data();
             }
 
-            // Everything else is treated as malformed JSON (especially in strict mode).
-            return MatchResult::Malformed;
+            try
+            {
+                simdjson::ondemand::document doc;
+                const simdjson::error_code err =
+                    worker.parser.iterate(json, json_len, json_len + simdjson::SIMDJSON_PADDING).get(doc);
+                if (err)
+                {
+                    return MatchResult::Malformed;
+                }
+                const MatchResult result = traverseAndMatch(worker, doc, config);
+                commitAggregates(worker, config, result);
+                return result;
+            }
+            catch (const simdjson::simdjson_error &)
+            {
+                return MatchResult::Malformed;
+            }
         }
 
-        void writeBytes(std::ostream &out, std::span<const std::byte> bytes)
+        // The bytes to emit for a matching line: `raw` plus its '\n' delimiter, if any.
+        // The delimiter directly follows `raw` in the input, so this stays a view.
+        [[nodiscard]] std::span<const std::byte> outputBytes(const ScannedLine &line) noexcept
         {
-            const auto *ptr = reinterpret_cast<const char *>(bytes.data());
-            out.write(ptr, static_cast<std::streamsize>(bytes.size()));
+            return {line.raw.data(), line.raw.size() + (line.had_newline ? 1U : 0U)};
         }
 
-        MatchResult valueMatches(simdjson::ondemand::value value, const QueryValue &qv)
+        // Scanner batches: big enough to amortize queue traffic and per-window stream
+        // setup, small enough that several are in flight per worker.
+        constexpr std::size_t batch_max_lines = 1024;
+        constexpr std::size_t batch_max_bytes = 1ULL << 20;
+        // Lines requested from the scanner per call while filling a batch.
+        constexpr std::size_t scan_step_lines = 64;
+
+        // Fills `lines` (cleared first) with the next batch of lines from `scanner`
+        // (a LineScanner or LineIndex::Cursor).
+        // Returns false when the scanner is exhausted and `lines` is empty.
+        template <typename LineSource>
+        bool fillBatch(LineSource &scanner, std::vector<ScannedLine> &lines)
         {
-            return std::visit(
-                [&](auto &&arg) -> MatchResult
+            lines.clear();
+            std::size_t bytes = 0;
+            std::array<ScannedLine, scan_step_lines> step{};
+            while (lines.size() + scan_step_lines <= batch_max_lines && bytes < batch_max_bytes)
+            {
+                const std::size_t n = scanner.nextBatch(step);
+                if (n == 0)
+                {
+                    break;
+                }
+                for (std::size_t i = 0; i < n; ++i)
                 {
-                    using T = std::decay_t<decltype(arg)>;
-                    if constexpr (std::is_same_v<T, std::string_view>)
+                    bytes += step[i].raw.size();
+                }
+                lines.insert(lines.end(), step.begin(), step.begin() + static_cast<std::ptrdiff_t>(n));
+            }
+            return !lines.empty();
+        }
+
+        // Upper bound on the bytes handed to one document_stream; also the stream
+        // parser's capacity. Longer single lines are parsed individually.
+        constexpr std::size_t stream_window_max_bytes = 4ULL << 20;
+
+        [[nodiscard]] constexpr bool isJsonWhitespace(std::byte b) noexcept
+        {
+            return b == std::byte{' '} || b == std::byte{'\t'} || b == std::byte{'\n'} || b == std::byte{'\r'};
+        }
+
+        // Offset from `base` of the first non-whitespace byte of `line.json`, or
+        // npos for a blank line (which a stream skips but a per-line parse rejects).
+        [[nodiscard]] std::size_t documentStart(const ScannedLine &line, const std::byte *base) noexcept
+        {
+            for (std::size_t i = 0; i < line.json.size(); ++i)
+            {
+                if (!isJsonWhitespace(line.json[i]))
+                {
+                    return static_cast<std::size_t>(line.json.data() + i - base);
+                }
+            }
+            return static_cast<std::size_t>(-1);
+        }
+
+        template <typename Emit>
+        bool evaluatePerLine(LineWorker &worker, std::span<const ScannedLine> lines, const QueryConfig &config, Emit &emit)
+        {
+            for (const ScannedLine &line : lines)
+            {
+                if (!emit(line, matchLine(worker, line, config)))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Runs one document_stream over `lines` (consecutive, not oversized) and emits
+        // results for the leading lines whose document provably coincides with the
+        // line. Returns the number of lines emitted; sets `stopped` if `emit` asked
+        // to stop.
+        //
+        // A document is attributed to line i only once the next document starts
+        // exactly at line i+1's first non-whitespace byte (or, for the last line, the
+        // stream ends with nothing truncated). Malformed lines, lines holding several
+        // values and values spanning lines all break that alignment, so they are
+        // left for the per-line parser: results are identical to the Line engine.
+        template <typename Emit>
+        std::size_t streamAlignedLines(LineWorker &worker, std::span<const ScannedLine> lines, const QueryConfig &config,
+                                       Emit &emit, bool &stopped)
+        {
+            const std::byte *begin = lines.front().json.data();
+            const std::byte *end = lines.back().json.data() + lines.back().json.size();
+            const auto len = static_cast<std::size_t>(end - begin);
+
+            const char *buf = reinterpret_cast<const char *>(begin);
+            if (static_cast<std::size_t>(worker.readable_end - end) < simdjson::SIMDJSON_PADDING)
+            {
+                worker.scratch.resize(len + simdjson::SIMDJSON_PADDING);
+                std::memcpy(worker.scratch.data(), buf, len);
+                std::memset(worker.scratch.data() + len, 0, simdjson::SIMDJSON_PADDING);
+                buf = worker.scratch.data();
+            }
+
+            simdjson::ondemand::document_stream stream;
+            if (worker.stream_parser.iterate_many(buf, len, stream_window_max_bytes).get(stream))
+            {
+                return 0;
+            }
+
+            std::size_t committed = 0;
+            std::optional<MatchResult> pending;
+            try
+            {
+                for (auto it = stream.begin(); it != stream.end(); ++it)
+                {
+                    const std::size_t start = it.current_index();
+                    if (pending.has_value())
                     {
-                        auto s = value.get_string();
-                        if (s.error())
+                        if (committed + 1 == lines.size() || start != documentStart(lines[committed + 1], begin))
                         {
-                            return classifyError(s.error());
+                            return committed;
                         }
-                        return (s.value() == arg) ? MatchResult::Match : MatchResult::NoMatch;
-                    }
-                    else if constexpr (std::is_same_v<T, double>)
-                    {
-                        auto d = value.get_double();
-                        if (d.error())
+                        ++committed;
+                        commitAggregates(worker, config, *pending);
+                        if (!emit(lines[committed - 1], *pending))
                         {
-                            return classifyError(d.error());
+                            stopped = true;
+                            return committed;
                         }
-                        return (d.value() == arg) ? MatchResult::Match : MatchResult::NoMatch;
+                        pending.reset();
                     }
-                    else if constexpr (std::is_same_v<T, bool>)
+
+                    if (start != documentStart(lines[committed], begin))
                     {
-                        auto b = value.get_bool();
-                        if (b.error())
-                        {
-                            return classifyError(b.error());
-                        }
-                        return (b.value() == arg) ? MatchResult::Match : MatchResult::NoMatch;
+                        return committed;
                     }
-                    else if constexpr (std::is_same_v<T, std::monostate>)
+
+                    auto doc = *it;
+                    if (doc.error())
                     {
-                        auto is_null = value.is_null();
-                        if (is_null.error())
-                        {
-                            return classifyError(is_null.error());
-                        }
-                        return is_null.value() ? MatchResult::Match : MatchResult::NoMatch;
+                        return committed;
                     }
-                    return MatchResult::NoMatch;
-                },
-                qv);
+                    simdjson::ondemand::document_reference ref = doc.value_unsafe();
+                    pending = traverseAndMatch(worker, ref, config);
+                }
+
+                if (stream.truncated_bytes() != 0 || !pending.has_value() || committed + 1 != lines.size())
+                {
+                    return committed;
+                }
+            }
+            catch (const simdjson::simdjson_error &)
+            {
+                return committed;
+            }
+
+            ++committed;
+            commitAggregates(worker, config, *pending);
+            if (!emit(lines[committed - 1], *pending))
+            {
+                stopped = true;
+            }
+            return committed;
         }
 
-        MatchResult traverseAndMatch(simdjson::ondemand::document &doc, const QueryConfig &config)
+        template <typename Emit>
+        bool evaluateStreamWindow(LineWorker &worker, std::span<const ScannedLine> lines, const QueryConfig &config,
+                                  Emit &emit)
         {
-            simdjson::ondemand::value current = doc;
-            for (const PathSegment &seg : config.path_segments)
+            std::size_t pos = 0;
+            bool restarted = false;
+            while (lines.size() - pos > 1)
             {
-                if (seg.kind == PathSegmentKind::Key)
+                bool stopped = false;
+                const std::size_t committed = streamAlignedLines(worker, lines.subspan(pos), config, emit, stopped);
+                pos += committed;
+                if (stopped)
+                {
+                    return false;
+                }
+                if (pos == lines.size())
                 {
-                    auto obj_res = current.get_object();
-                    if (obj_res.error())
+                    return true;
+                }
+                if (committed == 0 && restarted)
+                {
+                    // The input keeps defeating the stream (e.g. invalid UTF-8 fails
+                    // stage 1 for the whole window); stop paying for restarts.
+                    break;
+                }
+
+                // The stream could not vouch for line `pos`: parse it on its own and
+                // resume streaming after it.
+                if (!emit(lines[pos], matchLine(worker, lines[pos], config)))
+                {
+                    return false;
+                }
+                ++pos;
+                restarted = true;
+            }
+            return evaluatePerLine(worker, lines.subspan(pos), config, emit);
+        }
+
+        // Evaluates consecutive lines in input order, calling
+        // `emit(const ScannedLine &, MatchResult) -> bool` for each; `emit` returns
+        // false to stop early. Returns false if stopped.
+        template <typename Emit>
+        bool evaluateLines(LineWorker &worker, std::span<const ScannedLine> lines, const QueryConfig &config, Emit &&emit)
+        {
+            if (config.engine == ParseEngine::Line)
+            {
+                return evaluatePerLine(worker, lines, config, emit);
+            }
+
+            // Split into windows of streamable lines; oversized lines and lines too
+            // long to share a window go through the per-line path.
+            std::size_t pos = 0;
+            while (pos < lines.size())
+            {
+                std::size_t end = pos;
+                const std::byte *window_begin = lines[pos].json.data();
+                while (end < lines.size() && !lines[end].oversized &&
+                       static_cast<std::size_t>(lines[end].json.data() + lines[end].json.size() - window_begin) <=
+                           stream_window_max_bytes)
+                {
+                    ++end;
+                }
+
+                if (end - pos < 2)
+                {
+                    end = std::max(end, pos + 1);
+                    if (!evaluatePerLine(worker, lines.subspan(pos, end - pos), config, emit))
                     {
-                        return classifyError(obj_res.error());
+                        return false;
                     }
-                    simdjson::ondemand::object obj = obj_res.value();
+                }
+                else if (!evaluateStreamWindow(worker, lines.subspan(pos, end - pos), config, emit))
+                {
+                    return false;
+                }
+                pos = end;
+            }
+            return true;
+        }
+
+        // How far ahead of a scan the kernel is asked to read (QueryInput::file),
+        // and how far the scan moves before the hints are extended.
+        constexpr std::size_t readahead_bytes = 64ULL << 20;
+        constexpr std::size_t readahead_step = 16ULL << 20;
+
+        // Keeps kernel hints in step with a front-to-back scan of a file
+        // mapping: read-ahead in front of it and, under QueryInput::max_resident,
+        // release of the pages behind it. A quarter of the budget goes ahead of
+        // the scan and a quarter (at least `lag`, the bytes still being parsed
+        // behind the scan) stays behind it. Inactive for other inputs.
+        class ScanAdvice
+        {
+        public:
+            ScanAdvice() = default;
+            explicit ScanAdvice(const QueryInput &input, std::size_t lag = 0) noexcept
+                : file_{input.file},
+                  base_{input.bytes.data()},
+                  size_{input.bytes.size()},
+                  ahead_{input.max_resident == 0 ? readahead_bytes : std::min(readahead_bytes, input.max_resident / 4)},
+                  behind_{input.max_resident == 0 ? 0 : std::max(lag, input.max_resident / 4)},
+                  step_{std::max<std::size_t>(std::min(readahead_step, ahead_ / 4), 1)} {}
+
+            // The scan has reached `position` in the input.
+            void advance(const std::byte *position) noexcept
+            {
+                if (file_ == nullptr)
+                {
+                    return;
+                }
+                const auto offset = static_cast<std::size_t>(position - base_);
+                const std::size_t target = std::min(size_, offset + ahead_);
+                if (target > requested_ && (target >= requested_ + step_ || target == size_))
+                {
+                    file_->prefetch(requested_, target - requested_);
+                    requested_ = target;
+                }
+                if (behind_ != 0 && offset >= released_ + behind_ + step_)
+                {
+                    const std::size_t end = offset - behind_;
+                    file_->release(released_, end - released_);
+                    released_ = end;
+                }
+            }
+
+        private:
+            const MappedFile *file_{nullptr};
+            const std::byte *base_{nullptr};
+            std::size_t size_{0};
+            std::size_t ahead_{0};
+            std::size_t behind_{0};
+            std::size_t step_{1};
+            // Ends of the input already prefetched and released.
+            std::size_t requested_{0};
+            std::size_t released_{0};
+        };
+
+        template <typename LineSource>
+        QueryStatus runSerial(LineSource &scanner, const QueryInput &input, const QueryConfig &config, OutputSink &out,
+                              QueryStats &stats, ScanAdvice advice = {})
+        {
+            const std::size_t limit = matchLimit(config);
+            if (limit == 0)
+            {
+                return QueryStatus::Ok;
+            }
 
-                    auto field_res = obj.find_field_unordered(seg.key);
-                    if (field_res.error())
+            LineWorker worker(input, config);
+            std::vector<ScannedLine> lines;
+            lines.reserve(batch_max_lines);
+            // Projected output of the current batch.
+            std::string text;
+
+            advice.advance(input.bytes.data());
+            while (fillBatch(scanner, lines))
+            {
+                advice.advance(lines.back().raw.data());
+                const bool completed = evaluateLines(worker, lines, config, [&](const ScannedLine &line, MatchResult result)
+                                                     {
+                    if (result == MatchResult::Match)
                     {
-                        return classifyError(field_res.error());
+                        if (projecting(config))
+                        {
+                            text += worker.projected;
+                        }
+                        else if (config.output == OutputMode::Lines)
+                        {
+                            out.append(outputBytes(line));
+                        }
+                        return ++stats.matches < limit;
                     }
-                    current = field_res.value();
+                    return result != MatchResult::Malformed || !config.strict; });
+                if (!text.empty())
+                {
+                    out.write(std::as_bytes(std::span(text)));
+                    text.clear();
                 }
-                else
+                if (!completed)
                 {
-                    auto arr_res = current.get_array();
-                    if (arr_res.error())
+                    stats.groups = std::move(worker.groups);
+                    stats.distinct = std::move(worker.distinct);
+                    return (stats.matches == limit) ? QueryStatus::Ok : QueryStatus::ParseError;
+                }
+            }
+
+            stats.groups = std::move(worker.groups);
+            stats.distinct = std::move(worker.distinct);
+            return QueryStatus::Ok;
+        }
+
+        // Line source over the candidate offsets of a value index lookup.
+        class CandidateLines
+        {
+        public:
+            CandidateLines(std::span<const std::byte> bytes, std::vector<std::uint64_t> offsets) noexcept
+                : bytes_{bytes}, offsets_{std::move(offsets)} {}
+
+            [[nodiscard]] std::size_t nextBatch(std::span<ScannedLine> out) noexcept
+            {
+                std::size_t count = 0;
+                while (count < out.size() && next_ < offsets_.size())
+                {
+                    const auto begin = static_cast<std::size_t>(offsets_[next_++]);
+                    const void *nl = std::memchr(bytes_.data() + begin, '\n', bytes_.size() - begin);
+                    const std::size_t raw_end = (nl == nullptr)
+                                                    ? bytes_.size()
+                                                    : static_cast<std::size_t>(static_cast<const std::byte *>(nl) - bytes_.data());
+                    if (makeScannedLine(bytes_, begin, raw_end, nl != nullptr, out[count]))
                     {
-                        return classifyError(arr_res.error());
+                        ++count;
                     }
-                    simdjson::ondemand::array arr = arr_res.value();
+                }
+                return count;
+            }
+
+        private:
+            std::span<const std::byte> bytes_;
+            std::vector<std::uint64_t> offsets_;
+            std::size_t next_{0};
+        };
 
-                    auto elem_res = arr.at(seg.index);
-                    if (elem_res.error())
+        // Answers the query from a value index: only candidate lines are read, and
+        // each is re-checked by the parser so the result is exactly the scan's.
+        QueryStatus runLookup(const QueryInput &input, const QueryConfig &config, OutputSink &out, QueryStats &stats)
+        {
+            std::vector<std::uint64_t> offsets;
+            if (config.values != nullptr)
+            {
+                for (const QueryValue &value : config.values->values())
+                {
+                    const auto found = input.value_index->candidates(value);
+                    offsets.insert(offsets.end(), found.begin(), found.end());
+                }
+                std::sort(offsets.begin(), offsets.end());
+                offsets.erase(std::unique(offsets.begin(), offsets.end()), offsets.end());
+            }
+            else
+            {
+                offsets = input.value_index->candidates(config.value);
+            }
+            CandidateLines lines(input.bytes, std::move(offsets));
+            // Candidates are not consecutive, so they cannot share a document stream.
+            QueryConfig lookup = config;
+            lookup.engine = ParseEngine::Line;
+            return runSerial(lines, input, lookup, out, stats);
+        }
+
+        // Line source over the lines of zone map blocks, in order. Blocks start
+        // at line starts, so each is scanned on its own.
+        class BlockLines
+        {
+        public:
+            explicit BlockLines(std::span<const std::span<const std::byte>> blocks) noexcept
+                : blocks_{blocks}, scanner_{{}} {}
+
+            [[nodiscard]] std::size_t nextBatch(std::span<ScannedLine> out) noexcept
+            {
+                for (;;)
+                {
+                    if (const std::size_t n = scanner_.nextBatch(out))
+                    {
+                        return n;
+                    }
+                    if (next_ == blocks_.size())
                     {
-                        return classifyError(elem_res.error());
+                        return 0;
                     }
-                    current = elem_res.value();
+                    scanner_ = LineScanner(blocks_[next_++]);
                 }
             }
 
-            return valueMatches(current, config.value);
+        private:
+            std::span<const std::span<const std::byte>> blocks_;
+            LineScanner scanner_;
+            std::size_t next_{0};
+        };
+
+        // Candidate blocks from the zone map, or nullopt to read all of the input.
+        using BlockList = std::optional<std::vector<std::span<const std::byte>>>;
+
+        QueryStatus runSerial(const QueryInput &input, const BlockList &blocks, const QueryConfig &config,
+                              OutputSink &out, QueryStats &stats)
+        {
+            if (blocks.has_value())
+            {
+                BlockLines lines(*blocks);
+                return runSerial(lines, input, config, out, stats);
+            }
+            if (input.line_index != nullptr)
+            {
+                LineIndex::Cursor cursor = input.line_index->cursor(input.bytes);
+                return runSerial(cursor, input, config, out, stats, ScanAdvice(input));
+            }
+            LineScanner scanner(input.bytes);
+            return runSerial(scanner, input, config, out, stats, ScanAdvice(input));
         }
 
-    } // namespace
+        // Batches that may be scanned ahead of the oldest unwritten one, per worker.
+        // Bounds both queues and the reorder buffer, and so the memory in flight.
+        constexpr std::size_t in_flight_batches_per_thread = 4;
 
-    QueryStatus runQuery(std::span<const std::byte> mapped, const QueryConfig &config, std::ostream &out)
-    {
-        simdjson::ondemand::parser parser;
-        std::vector<char> scratch;
-        scratch.reserve(LineScanner::max_line_length + simdjson::SIMDJSON_PADDING);
+        struct LineBatch
+        {
+            std::size_t seq{0};
+            std::vector<ScannedLine> lines;
+            // With a line index the scanner only hands out line ranges and the
+            // parser decodes them itself; `lines` is then empty.
+            std::size_t first_line{0};
+            std::size_t end_line{0};
+            // With a zone map it hands out candidate blocks for the parser to scan.
+            std::span<const std::byte> block{};
+        };
 
-        LineScanner scanner(mapped);
-        ScannedLine line;
+        struct BatchResult
+        {
+            std::size_t seq{0};
+            // Output bytes of matching lines, in input order. Views into `mapped`.
+            // Only filled for OutputMode::Lines.
+            std::vector<std::span<const std::byte>> matches;
+            // With a projection, the text `matches` views instead.
+            std::vector<std::byte> text;
+            std::size_t match_count{0};
+            // Strict mode only: the batch stopped at a malformed/oversized line.
+            bool malformed{false};
+        };
 
-        while (scanner.next(line))
+        // State shared by the pipeline stages.
+        struct Pipeline
         {
-            if (line.oversized)
+            explicit Pipeline(std::size_t max_in_flight)
+                : max_in_flight{max_in_flight}, batches{max_in_flight}, results{max_in_flight} {}
+
+            const std::size_t max_in_flight;
+            BoundedQueue<LineBatch> batches;
+            BoundedQueue<BatchResult> results;
+
+            std::atomic<bool> stop{false};
+            std::atomic<bool> scan_done{false};
+            // Total number of batches; valid once `scan_done` is set.
+            std::atomic<std::size_t> batch_count{0};
+            // Number of batches the writer has consumed.
+            std::atomic<std::size_t> flushed{0};
+
+            // Merged from the workers' aggregates as they finish.
+            std::mutex aggregates_mutex;
+            GroupCounts groups;
+            HyperLogLog distinct;
+
+            std::atomic<bool> failed{false};
+            std::mutex failure_mutex;
+            std::exception_ptr failure;
+
+            void fail(std::exception_ptr e)
             {
-                if (config.strict)
                 {
-                    return QueryStatus::ParseError;
+                    std::lock_guard lock(failure_mutex);
+                    if (!failure)
+                    {
+                        failure = std::move(e);
+                    }
                 }
-                continue;
+                failed.store(true, std::memory_order_release);
+                stop.store(true, std::memory_order_release);
             }
 
-            const std::size_t json_len = line.json.size();
-            scratch.resize(json_len + simdjson::SIMDJSON_PADDING);
-
-            std::memcpy(scratch.data(), reinterpret_cast<const char *>(line.json.data()), json_len);
-            std::memset(scratch.data() + json_len, 0, simdjson::SIMDJSON_PADDING);
+            [[nodiscard]] bool stopped() const noexcept { return stop.load(std::memory_order_acquire); }
+        };
 
-            simdjson::ondemand::document doc;
-            simdjson::error_code err = simdjson::SUCCESS;
-            try
+        // Pushes `value`, waiting while the queue is full. Returns false if the
+        // pipeline was stopped before the push succeeded.
+        template <typename T>
+        [[nodiscard]] bool pushWhileRunning(Pipeline &p, BoundedQueue<T> &queue, T &value)
+        {
+            Backoff backoff;
+            while (!queue.tryPush(value))
             {
-                err = parser.iterate(scratch.data(), json_len, scratch.size()).get(doc);
+                if (p.stopped())
+                {
+                    return false;
+                }
+                backoff.pause();
             }
-            catch (const simdjson::simdjson_error &)
+            return true;
+        }
+
+        // Waits until batch `seq` may be published without running further ahead
+        // of the writer than the in-flight budget. Returns false if stopped.
+        [[nodiscard]] bool waitForBudget(Pipeline &p, std::size_t seq)
+        {
+            Backoff backoff;
+            while (seq >= p.flushed.load(std::memory_order_acquire) + p.max_in_flight)
             {
-                if (config.strict)
+                if (p.stopped())
                 {
-                    return QueryStatus::ParseError;
+                    return false;
                 }
-                continue;
+                backoff.pause();
             }
+            return true;
+        }
+
+        // Stage 1: splits the mapping into lines and publishes them in batches.
+        // Zone map blocks and line index ranges are published as they are, which
+        // takes no scan.
+        void scanStage(Pipeline &p, const QueryInput &input, const BlockList &blocks)
+        {
+            LineBatch batch;
+            std::size_t seq = 0;
 
-            if (err)
+            if (blocks.has_value())
             {
-                if (config.strict)
+                for (const std::span<const std::byte> block : *blocks)
                 {
-                    return QueryStatus::ParseError;
+                    batch.seq = seq;
+                    batch.block = block;
+                    if (!waitForBudget(p, seq) || !pushWhileRunning(p, p.batches, batch))
+                    {
+                        return;
+                    }
+                    ++seq;
+                }
+            }
+            else if (input.line_index != nullptr)
+            {
+                ScanAdvice advice(input, p.max_in_flight * batch_max_bytes);
+                const std::size_t line_count = input.line_index->lineCount();
+                for (std::size_t first = 0; first < line_count; first += LineIndex::checkpoint_interval, ++seq)
+                {
+                    advice.advance(input.bytes.data() + input.line_index->lineStart(first));
+                    batch.seq = seq;
+                    batch.first_line = first;
+                    batch.end_line = std::min(first + LineIndex::checkpoint_interval, line_count);
+                    if (!waitForBudget(p, seq) || !pushWhileRunning(p, p.batches, batch))
+                    {
+                        return;
+                    }
+                }
+            }
+            else
+            {
+                ScanAdvice advice(input, p.max_in_flight * batch_max_bytes);
+                advice.advance(input.bytes.data());
+                LineScanner scanner(input.bytes);
+                batch.lines.reserve(batch_max_lines);
+                while (fillBatch(scanner, batch.lines))
+                {
+                    advice.advance(batch.lines.back().raw.data());
+                    batch.seq = seq;
+                    if (!waitForBudget(p, seq) || !pushWhileRunning(p, p.batches, batch))
+                    {
+                        return;
+                    }
+                    ++seq;
+                    batch.lines.reserve(batch_max_lines);
                 }
-                continue;
             }
 
-            MatchResult result = MatchResult::Malformed;
-            try
+            p.batch_count.store(seq, std::memory_order_relaxed);
+            p.scan_done.store(true, std::memory_order_release);
+        }
+
+        // Stage 2: parses batches and evaluates the query. Runs on every worker.
+        void parseStage(Pipeline &p, const QueryInput &input, const QueryConfig &config)
+        {
+            const std::size_t limit = matchLimit(config);
+            LineWorker worker(input, config);
+            LineBatch batch;
+            Backoff backoff;
+            // Lengths of the projected matches in the current batch's text.
+            std::vector<std::size_t> projected_sizes;
+
+            while (!p.stopped())
             {
-                result = traverseAndMatch(doc, config);
+                // Read `scan_done` before popping: once it is set, an empty queue
+                // means every batch has been taken.
+                const bool scan_done = p.scan_done.load(std::memory_order_acquire);
+                if (!p.batches.tryPop(batch))
+                {
+                    if (scan_done)
+                    {
+                        break;
+                    }
+                    backoff.pause();
+                    continue;
+                }
+                backoff.reset();
+
+                BatchResult result;
+                result.seq = batch.seq;
+                auto evaluate = [&](std::span<const ScannedLine> lines)
+                {
+                    return evaluateLines(worker, lines, config, [&](const ScannedLine &line, MatchResult r)
+                                         {
+                        if (r == MatchResult::Match)
+                        {
+                            if (projecting(config))
+                            {
+                                const auto bytes = std::as_bytes(std::span(worker.projected));
+                                result.text.insert(result.text.end(), bytes.begin(), bytes.end());
+                                projected_sizes.push_back(bytes.size());
+                            }
+                            else if (config.output == OutputMode::Lines)
+                            {
+                                result.matches.push_back(outputBytes(line));
+                            }
+                            // Later matches in this batch cannot be used.
+                            return ++result.match_count < limit;
+                        }
+                        return r != MatchResult::Malformed || !config.strict; });
+                };
+
+                bool completed = true;
+                if (!batch.block.empty())
+                {
+                    LineScanner scanner(batch.block);
+                    while (completed && fillBatch(scanner, batch.lines))
+                    {
+                        completed = evaluate(batch.lines);
+                    }
+                }
+                else if (input.line_index != nullptr)
+                {
+                    LineIndex::Cursor cursor = input.line_index->cursor(input.bytes, batch.first_line, batch.end_line);
+                    while (completed && fillBatch(cursor, batch.lines))
+                    {
+                        completed = evaluate(batch.lines);
+                    }
+                }
+                else
+                {
+                    completed = evaluate(batch.lines);
+                }
+                result.malformed = !completed && result.match_count < limit;
+
+                // The text no longer grows, so views into it stay valid.
+                const std::byte *at = result.text.data();
+                for (const std::size_t size : projected_sizes)
+                {
+                    result.matches.emplace_back(at, size);
+                    at += size;
+                }
+                projected_sizes.clear();
+
+                if (!pushWhileRunning(p, p.results, result))
+                {
+                    break;
+                }
             }
-            catch (const simdjson::simdjson_error &)
+
+            if (!worker.groups.empty() || !worker.distinct.empty())
             {
-                result = MatchResult::Malformed;
+                std::lock_guard lock(p.aggregates_mutex);
+                p.groups.merge(worker.groups);
+                p.distinct.merge(worker.distinct);
             }
+        }
+
+        // Stage 3: writes batch results, restoring input order if requested, and
+        // ends the run once the match limit is reached. Runs on the calling thread,
+        // which owns `out`.
+        QueryStatus writeStage(Pipeline &p, const QueryConfig &config, OutputSink &out, QueryStats &stats)
+        {
+            const std::size_t limit = matchLimit(config);
+            // Without printed lines the order only matters to decide whether a
+            // strict-mode error comes before the limit.
+            const bool reorder = config.ordered && (config.output == OutputMode::Lines || config.strict);
+
+            // Slot `seq % max_in_flight` holds an early result in ordered mode; the
+            // scanner never runs more than `max_in_flight` batches ahead, so slots
+            // cannot collide.
+            std::vector<std::optional<BatchResult>> pending(reorder ? p.max_in_flight : 0);
+            std::size_t written = 0;
+            BatchResult result;
+            Backoff backoff;
 
-            if (result == MatchResult::Malformed)
+            // Returns the final status once the run is decided.
+            auto emit = [&](const BatchResult &r) -> std::optional<QueryStatus>
             {
-                if (config.strict)
+                const std::size_t take = std::min(r.match_count, limit - stats.matches);
+                for (std::size_t i = 0; i < take && i < r.matches.size(); ++i)
+                {
+                    out.append(r.matches[i]);
+                }
+                if (!r.text.empty())
+                {
+                    // Projected text goes away with `r`.
+                    out.flush();
+                }
+                stats.matches += take;
+                ++written;
+                p.flushed.store(written, std::memory_order_release);
+
+                if (stats.matches == limit)
+                {
+                    return QueryStatus::Ok;
+                }
+                if (r.malformed)
                 {
                     return QueryStatus::ParseError;
                 }
-                continue;
+                return std::nullopt;
+            };
+
+            for (;;)
+            {
+                if (p.failed.load(std::memory_order_acquire))
+                {
+                    return QueryStatus::Ok;
+                }
+                if (p.scan_done.load(std::memory_order_acquire) &&
+                    written == p.batch_count.load(std::memory_order_relaxed))
+                {
+                    return QueryStatus::Ok;
+                }
+
+                if (!p.results.tryPop(result))
+                {
+                    backoff.pause();
+                    continue;
+                }
+                backoff.reset();
+
+                if (!reorder)
+                {
+                    if (const auto status = emit(result))
+                    {
+                        return *status;
+                    }
+                    continue;
+                }
+
+                pending[result.seq % p.max_in_flight] = std::move(result);
+                for (auto *slot = &pending[written % p.max_in_flight];
+                     slot->has_value() && (*slot)->seq == written;
+                     slot = &pending[written % p.max_in_flight])
+                {
+                    const BatchResult ready = std::move(**slot);
+                    slot->reset();
+                    if (const auto status = emit(ready))
+                    {
+                        return *status;
+                    }
+                }
+            }
+        }
+
+        // Staged pipeline used when `config.threads > 1`:
+        //   scanner thread -> [batch queue] -> `threads` parser workers
+        //                  -> [result queue] -> writer (calling thread).
+        // Queues are bounded lock-free MPMC rings and the scanner may only run a
+        // fixed number of batches ahead of the writer, so memory stays capped.
+        // Page faults on the mapping (scanner) and blocking writes (writer) are
+        // overlapped with parsing.
+        //
+        // In ordered mode the output (including strict-mode early exit) is identical
+        // to the serial scan.
+        QueryStatus runPipelined(const QueryInput &input, const BlockList &blocks, const QueryConfig &config,
+                                 OutputSink &out, QueryStats &stats)
+        {
+            if (matchLimit(config) == 0)
+            {
+                return QueryStatus::Ok;
             }
 
-            if (result == MatchResult::Match)
+            Pipeline p(config.threads * in_flight_batches_per_thread);
+
+            auto guarded = [&p](auto &&stage)
             {
-                writeBytes(out, line.raw);
-                if (line.had_newline)
+                try
                 {
-                    out.put('\n');
+                    stage();
                 }
+                catch (...)
+                {
+                    p.fail(std::current_exception());
+                }
+            };
+
+            QueryStatus status = QueryStatus::Ok;
+            {
+                std::vector<std::jthread> threads;
+                threads.reserve(config.threads + 1);
+                threads.emplace_back([&]
+                                     { guarded([&]
+                                               { scanStage(p, input, blocks); }); });
+                for (std::size_t i = 0; i < config.threads; ++i)
+                {
+                    threads.emplace_back([&]
+                                         { guarded([&]
+                                                   { parseStage(p, input, config); }); });
+                }
+
+                try
+                {
+                    status = writeStage(p, config, out, stats);
+                }
+                catch (...)
+                {
+                    p.fail(std::current_exception());
+                }
+                p.stop.store(true, std::memory_order_release);
+            }
+
+            if (p.failure)
+            {
+                std::rethrow_exception(p.failure);
             }
+            stats.groups = std::move(p.groups);
+            stats.distinct = std::move(p.distinct);
+            return status;
         }
 
+    } // namespace
+
+    std::size_t requiredInputPadding() noexcept
+    {
+        return simdjson::SIMDJSON_PADDING;
+    }
+
+    std::size_t matchLimit(const QueryConfig &config) noexcept
+    {
+        if (config.output == OutputMode::Quiet)
+        {
+            return std::min<std::size_t>(1, config.max_count.value_or(1));
+        }
+        return config.max_count.value_or(std::numeric_limits<std::size_t>::max());
+    }
+
+    QueryStatus runQuery(const QueryInput &input, const QueryConfig &config, OutputSink &out, QueryStats &stats)
+    {
+        stats = {};
+        // Indexes cover `path_segments` only. A filter is ANDed with it, so the
+        // index still bounds the matches, but not the lines that are malformed at
+        // the filter's other paths: strict filtered queries scan.
+        const bool indexable = !config.path_segments.empty() && (!config.filter.has_value() || !config.strict);
+        // Irregular lines would be strict-mode errors the index cannot order
+        // against the matches, so strict queries then scan.
+        const bool lookup = indexable && !config.range.has_value() && input.value_index != nullptr &&
+                            (!config.strict || input.value_index->irregularLines() == 0);
+        BlockList blocks;
+        if (indexable && !lookup && input.zone_map != nullptr)
+        {
+            if (const auto slot = input.zone_map->slotOf(config.path_segments))
+            {
+                if (config.range.has_value())
+                {
+                    blocks = input.zone_map->candidateBlocks(input.bytes, *slot, *config.range, config.strict);
+                }
+                else
+                {
+                    const std::span<const QueryValue> values =
+                        (config.values != nullptr) ? config.values->values() : std::span(&config.value, 1);
+                    blocks = input.zone_map->candidateBlocks(input.bytes, *slot, values, config.strict);
+                }
+            }
+        }
+        const QueryStatus status = lookup                 ? runLookup(input, config, out, stats)
+                                   : (config.threads > 1) ? runPipelined(input, blocks, config, out, stats)
+                                                          : runSerial(input, blocks, config, out, stats);
+        out.flush();
+        return status;
+    }
+
+    QueryStatus runQuery(const QueryInput &input, const QueryConfig &config, OutputSink &out)
+    {
+        QueryStats stats;
+        return runQuery(input, config, out, stats);
+    }
+
+    QueryStatus runQuery(WindowReader &reader, const QueryConfig &config, OutputSink &out, QueryStats &stats)
+    {
+        const std::size_t limit = matchLimit(config);
+        QueryConfig window_config = config;
+        while (stats.matches < limit)
+        {
+            const auto window = reader.next();
+            if (!window.has_value())
+            {
+                break;
+            }
+            window_config.max_count = limit - stats.matches;
+            QueryStats window_stats;
+            const QueryStatus status =
+                runQuery(QueryInput{window->bytes, window->padding}, window_config, out, window_stats);
+            stats.matches += window_stats.matches;
+            stats.groups.merge(window_stats.groups);
+            stats.distinct.merge(window_stats.distinct);
+            if (status == QueryStatus::ParseError)
+            {
+                return status;
+            }
+        }
         return QueryStatus::Ok;
     }
 
+    QueryStatus runQuery(const QueryInput &input, const QueryConfig &config, std::ostream &out)
+    {
+        StreamSink sink(out);
+        return runQuery(input, config, sink);
+    }
+
+    QueryStatus runQuery(std::span<const std::byte> mapped, const QueryConfig &config, std::ostream &out)
+    {
+        return runQuery(QueryInput{mapped, 0}, config, out);
+    }
+
 } // namespace jlq
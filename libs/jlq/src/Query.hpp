@@ -1,6 +1,14 @@
 #pragma once
 
+#include "GroupCounts.hpp"
+#include "HyperLogLog.hpp"
+#include "LineIndex.hpp"
+#include "MappedFile.hpp"
+#include "OutputSink.hpp"
 #include "QueryConfig.hpp"
+#include "ValueIndex.hpp"
+#include "WindowReader.hpp"
+#include "ZoneMap.hpp"
 
 #include <cstddef>
 #include <span>
@@ -15,10 +23,81 @@ namespace jlq
         ParseError,
     };
 
+    struct QueryInput
+    {
+        std::span<const std::byte> bytes{};
+        // Number of readable bytes guaranteed to follow `bytes` (e.g. the zero-filled
+        // tail of a padded MappedFile). Lines with at least requiredInputPadding()
+        // readable bytes after them are parsed in place instead of being copied.
+        std::size_t padding{0};
+        // Valid line index of `bytes`, if one exists. Lines are then located from
+        // the index instead of by scanning, and split between workers by range.
+        const LineIndex *line_index{nullptr};
+        // Valid value index of `bytes` for the query's path, if one exists. The
+        // query then reads only the lines the index points at.
+        const ValueIndex *value_index{nullptr};
+        // Valid zone map of `bytes`, if one exists. When it summarizes the query's
+        // path, only blocks that may hold a match are read.
+        const ZoneMap *zone_map{nullptr};
+        // The mapping `bytes` is, if it is all of one. A front-to-back scan then
+        // asks the kernel to read ahead of it, so cold pages are already on
+        // their way when the scan faults on them.
+        const MappedFile *file{nullptr};
+        // With `file`, a budget (0: none) for the mapping's resident pages: the
+        // scan reads ahead less and releases the pages it has left behind.
+        std::size_t max_resident{0};
+    };
+
+    struct QueryStats
+    {
+        // Matches found, capped by `QueryConfig::max_count` (and at 1 for Quiet).
+        std::size_t matches{0};
+        // With `QueryConfig::group_by`, the matches per value at that path.
+        GroupCounts groups;
+        // With `QueryConfig::distinct`, a sketch of the values at that path.
+        HyperLogLog distinct;
+    };
+
+    // Matches after which a run can stop: `QueryConfig::max_count`, at most 1 for Quiet.
+    [[nodiscard]] std::size_t matchLimit(const QueryConfig &config) noexcept;
+
+    // Readable bytes the parser needs after a line to parse it without a copy.
+    [[nodiscard]] std::size_t requiredInputPadding() noexcept;
+
     // Runs the query over a memory-mapped JSONL file.
     // - In default mode: malformed/oversized lines are skipped.
     // - In strict mode: first malformed/oversized line returns QueryStatus::ParseError.
-    // Writes matching lines to `out` exactly as they appear in the input.
+    // Appends matching lines to `out` exactly as they appear in the input (the
+    // ranges point into `input.bytes`) and flushes it before returning.
+    // - With `config.threads > 1` lines are scanned, parsed and written by separate
+    //   pipeline stages with `config.threads` parser workers. Output order follows
+    //   the input only if `config.ordered` is set.
+    // - Only OutputMode::Lines writes to `out`. Once `config.max_count` matches
+    //   (one for Quiet) are found the scan stops and all workers are cancelled.
+    [[nodiscard]] QueryStatus runQuery(const QueryInput &input,
+                                       const QueryConfig &config,
+                                       OutputSink &out,
+                                       QueryStats &stats);
+
+    [[nodiscard]] QueryStatus runQuery(const QueryInput &input,
+                                       const QueryConfig &config,
+                                       OutputSink &out);
+
+    // Writes matching lines through a StreamSink.
+    [[nodiscard]] QueryStatus runQuery(const QueryInput &input,
+                                       const QueryConfig &config,
+                                       std::ostream &out);
+
+    // Runs the query over input that arrives in windows of whole lines (e.g.
+    // decompressed on the fly), one window at a time; while one is queried the
+    // reader produces the next. Results, --max-count and strict-mode errors are
+    // the same as for the concatenated input. Indexes do not apply.
+    [[nodiscard]] QueryStatus runQuery(WindowReader &reader,
+                                       const QueryConfig &config,
+                                       OutputSink &out,
+                                       QueryStats &stats);
+
+    // Convenience overload for input without trailing padding.
     [[nodiscard]] QueryStatus runQuery(std::span<const std::byte> mapped,
                                        const QueryConfig &config,
                                        std::ostream &out);
@@ -6,6 +6,7 @@
 #include <variant>
 #include <vector>
 
+#include "NumberRange.hpp"
 #include "path.hpp"
 
 namespace jlq
@@ -13,12 +14,116 @@ namespace jlq
 
     using QueryValue = std::variant<std::monostate, std::string_view, double, bool>;
 
+    class ValueSet;
+
+    // One `--where` condition: the value at the path equals `value` or, with
+    // `range`, is a number inside it, or with `values`, is one of them.
+    struct Predicate
+    {
+        std::vector<PathSegment> path_segments;
+        QueryValue value{std::monostate{}};
+        std::optional<NumberRange> range{};
+        const ValueSet *values{nullptr};
+        // A number `value` written as an integer that fits 64 bits, compared
+        // exactly (see QueryConfig::integer_value).
+        std::optional<IntegerValue> integer_value{};
+    };
+
+    // One step of a Filter program.
+    struct FilterOp
+    {
+        enum class Kind
+        {
+            // Pushes the result of `predicates[predicate]`.
+            Predicate,
+            // Pop two results and push their conjunction / disjunction.
+            And,
+            Or,
+            // Negates the top result.
+            Not,
+        };
+
+        Kind kind{Kind::Predicate};
+        std::size_t predicate{0};
+    };
+
+    // Boolean combination of predicates (--where, --and, --or, --not), as a
+    // postfix program that leaves exactly one result.
+    struct Filter
+    {
+        std::vector<Predicate> predicates;
+        std::vector<FilterOp> program;
+    };
+
+    enum class ParseEngine
+    {
+        // One simdjson iterate() per line.
+        Line,
+        // Windows of lines through simdjson document streams (iterate_many), so
+        // stage 1 runs once per window. Same results as Line.
+        Stream,
+    };
+
+    enum class OutputMode
+    {
+        // Print matching lines.
+        Lines,
+        // Only count matches (--count).
+        Count,
+        // Only decide whether anything matches (--quiet); stops at the first match.
+        Quiet,
+    };
+
+    enum class ProjectionFormat
+    {
+        // One compact JSON object per line, keyed by the path texts.
+        Json,
+        // The values separated by tabs, strings without their quotes.
+        Tsv,
+    };
+
+    // What a matching line prints instead of itself (--select): the raw JSON
+    // of the value at each path, in order.
+    struct Projection
+    {
+        // The path texts, as given.
+        std::vector<std::string_view> names;
+        std::vector<std::vector<PathSegment>> paths;
+        ProjectionFormat format{ProjectionFormat::Json};
+    };
+
     struct QueryConfig
     {
         std::vector<PathSegment> path_segments;
         QueryValue value{std::monostate{}};
+        // A number `value` written as an integer that fits 64 bits: compared
+        // exactly, while `value` holds its nearest double, which is ambiguous
+        // beyond 2^53.
+        std::optional<IntegerValue> integer_value{};
+        // When set, replaces `value`: the number at the path must lie inside.
+        std::optional<NumberRange> range{};
+        // When set, replaces `value`: the value at the path must be one of
+        // these (--values-from). Not owned.
+        const ValueSet *values{nullptr};
         bool strict{false};
         std::size_t threads{1};
+        // Multi-threaded runs only: emit matches in input order.
+        bool ordered{false};
+        ParseEngine engine{ParseEngine::Line};
+        OutputMode output{OutputMode::Lines};
+        // Stop after this many matches (--max-count).
+        std::optional<std::size_t> max_count;
+        // Further conditions a line must satisfy. With empty `path_segments`
+        // only these apply. Index lookups use `path_segments`/`value` only.
+        std::optional<Filter> filter;
+        // OutputMode::Lines only: print these values of each match instead.
+        std::optional<Projection> projection;
+        // OutputMode::Count only: also count matches per value at this path
+        // (--group-by). A match without the value counts as null.
+        std::optional<std::vector<PathSegment>> group_by;
+        // OutputMode::Count only: also sketch the distinct values at this
+        // path (--distinct). Matches without the value are not counted.
+        std::optional<std::vector<PathSegment>> distinct;
     };
 
 } // namespace jlq
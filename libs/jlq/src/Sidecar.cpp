@@ -0,0 +1,95 @@
+#include "Sidecar.hpp"
+
+#include <cerrno>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace jlq
+{
+
+    namespace
+    {
+
+        [[noreturn]] void throwErrno(const char *what, int err)
+        {
+            throw std::system_error(std::error_code(err, std::generic_category()), what);
+        }
+
+        void writeAll(int fd, std::span<const std::byte> bytes)
+        {
+            while (!bytes.empty())
+            {
+                const ssize_t n = ::write(fd, bytes.data(), bytes.size());
+                if (n < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    throwErrno("write", errno);
+                }
+                bytes = bytes.subspan(static_cast<std::size_t>(n));
+            }
+        }
+
+    } // namespace
+
+    FileStamp stampOf(int fd)
+    {
+        struct stat st
+        {
+        };
+        if (::fstat(fd, &st) != 0)
+        {
+            throwErrno("fstat", errno);
+        }
+        return FileStamp{static_cast<std::uint64_t>(st.st_size),
+                         static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1'000'000'000 + st.st_mtim.tv_nsec};
+    }
+
+    bool isSidecarPath(std::string_view path) noexcept
+    {
+        return path.ends_with(".jlqidx") || path.ends_with(".jlqval") || path.ends_with(".jlqzone");
+    }
+
+    void writeFileAtomically(const std::string &path, std::span<const std::span<const std::byte>> parts)
+    {
+        const std::string tmp = path + ".tmp." + std::to_string(::getpid());
+        const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd == -1)
+        {
+            throwErrno("open", errno);
+        }
+
+        try
+        {
+            for (const auto part : parts)
+            {
+                writeAll(fd, part);
+            }
+        }
+        catch (...)
+        {
+            ::close(fd);
+            ::unlink(tmp.c_str());
+            throw;
+        }
+
+        if (::close(fd) != 0)
+        {
+            const int err = errno;
+            ::unlink(tmp.c_str());
+            throwErrno("close", err);
+        }
+        if (::rename(tmp.c_str(), path.c_str()) != 0)
+        {
+            const int err = errno;
+            ::unlink(tmp.c_str());
+            throwErrno("rename", err);
+        }
+    }
+
+} // namespace jlq
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace jlq
+{
+
+    // Identity of a data file as recorded in its sidecar files. A sidecar whose
+    // stamp differs from the file's current one is stale and must be ignored.
+    struct FileStamp
+    {
+        std::uint64_t size{0};
+        std::int64_t mtime_ns{0};
+
+        [[nodiscard]] bool operator==(const FileStamp &) const noexcept = default;
+    };
+
+    // Throws std::system_error if fstat fails.
+    [[nodiscard]] FileStamp stampOf(int fd);
+
+    // Whether `path` names a sidecar file (index, value index or zone map), which
+    // directory inputs skip.
+    [[nodiscard]] bool isSidecarPath(std::string_view path) noexcept;
+
+    // Replaces `path` with the concatenation of `parts`: the data is written to a
+    // temporary file next to it and renamed over `path`, so readers never see a
+    // partial sidecar. Throws std::system_error on failure.
+    void writeFileAtomically(const std::string &path, std::span<const std::span<const std::byte>> parts);
+
+    // LEB128 encoding used for delta-encoded offsets.
+    inline void appendVarint(std::vector<std::byte> &out, std::uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<std::byte>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<std::byte>(value));
+    }
+
+    // Decodes one varint at `pos`, advancing it. Returns false if the encoding
+    // runs past `in` or exceeds 64 bits.
+    [[nodiscard]] inline bool readVarint(std::span<const std::byte> in, std::size_t &pos, std::uint64_t &value) noexcept
+    {
+        value = 0;
+        for (unsigned shift = 0; shift < 64 && pos < in.size(); shift += 7)
+        {
+            const auto byte = static_cast<std::uint8_t>(in[pos++]);
+            value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+} // namespace jlq
@@ -0,0 +1,225 @@
+#include "ValueIndex.hpp"
+
+#include "LineScanner.hpp"
+#include "PathValue.hpp"
+
+#include <bit>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <unordered_map>
+
+namespace jlq
+{
+
+    namespace
+    {
+
+        constexpr char index_magic[8] = {'J', 'L', 'Q', 'V', 'I', 'D', 'X', '\0'};
+        constexpr std::uint32_t index_version = 1;
+        constexpr std::uint64_t empty_bucket = std::numeric_limits<std::uint64_t>::max();
+
+        struct Header
+        {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t path_bytes;
+            std::uint64_t file_size;
+            std::int64_t file_mtime_ns;
+            std::uint64_t irregular_lines;
+            std::uint64_t bucket_count;
+            std::uint64_t postings_bytes;
+        };
+
+        struct Bucket
+        {
+            std::uint64_t hash;
+            std::uint64_t postings;
+        };
+
+        [[nodiscard]] constexpr std::size_t padTo8(std::size_t n) noexcept
+        {
+            return (n + 7) & ~std::size_t{7};
+        }
+
+        void appendPathChar(std::string &out, char c)
+        {
+            static constexpr char hex[] = "0123456789ABCDEF";
+            const auto u = static_cast<unsigned char>(c);
+            if (c == '/' || c == '%' || u < 0x20 || u == 0x7f)
+            {
+                out += '%';
+                out += hex[u >> 4];
+                out += hex[u & 0xf];
+            }
+            else
+            {
+                out += c;
+            }
+        }
+
+    } // namespace
+
+    std::string valueIndexPath(std::string_view data_path, std::string_view path_text)
+    {
+        std::string out(data_path);
+        out += '.';
+        for (const char c : path_text)
+        {
+            appendPathChar(out, c);
+        }
+        out += ".jlqval";
+        return out;
+    }
+
+    void ValueIndex::write(const std::string &index_path, std::span<const std::byte> bytes, FileStamp stamp,
+                           std::string_view path_text, std::span<const PathSegment> path)
+    {
+        // Line offsets per key hash, in file order.
+        std::unordered_map<std::uint64_t, std::vector<std::uint64_t>> lines_by_key;
+        std::uint64_t irregular = 0;
+
+        PathValueReader reader(path);
+        LineScanner scanner(bytes);
+        ScannedLine line;
+        while (scanner.next(line))
+        {
+            const PathValue value = reader.read(line);
+            if (value.kind == PathValueKind::Irregular)
+            {
+                ++irregular;
+            }
+            else if (value.kind != PathValueKind::None)
+            {
+                lines_by_key[valueHash(value)].push_back(static_cast<std::uint64_t>(line.raw.data() - bytes.data()));
+            }
+        }
+
+        // Load factor <= 0.8: linear probes stay within one or two cache lines
+        // while the table for unique IDs stays close to 16 bytes per line.
+        const std::size_t keys = lines_by_key.size();
+        const std::size_t bucket_count = std::bit_ceil(std::max<std::size_t>(keys + keys / 4 + 1, 2));
+        std::vector<Bucket> buckets(bucket_count, Bucket{0, empty_bucket});
+        std::vector<std::byte> postings;
+        for (const auto &[hash, offsets] : lines_by_key)
+        {
+            std::size_t slot = hash & (bucket_count - 1);
+            while (buckets[slot].postings != empty_bucket)
+            {
+                slot = (slot + 1) & (bucket_count - 1);
+            }
+            buckets[slot] = Bucket{hash, postings.size()};
+
+            appendVarint(postings, offsets.size());
+            std::uint64_t previous = 0;
+            for (const std::uint64_t offset : offsets)
+            {
+                appendVarint(postings, offset - previous);
+                previous = offset;
+            }
+        }
+
+        Header header{};
+        std::memcpy(header.magic, index_magic, sizeof(index_magic));
+        header.version = index_version;
+        header.path_bytes = static_cast<std::uint32_t>(path_text.size());
+        header.file_size = stamp.size;
+        header.file_mtime_ns = stamp.mtime_ns;
+        header.irregular_lines = irregular;
+        header.bucket_count = bucket_count;
+        header.postings_bytes = postings.size();
+
+        std::string path_block(path_text);
+        path_block.resize(padTo8(path_block.size()), '\0');
+
+        const std::span<const std::byte> parts[] = {std::as_bytes(std::span(&header, 1)),
+                                                    std::as_bytes(std::span(path_block)),
+                                                    std::as_bytes(std::span(buckets)),
+                                                    std::as_bytes(std::span(postings))};
+        writeFileAtomically(index_path, parts);
+    }
+
+    std::optional<ValueIndex> ValueIndex::open(const std::string &index_path, FileStamp expected,
+                                               std::string_view path_text)
+    {
+        ValueIndex index;
+        try
+        {
+            index.file_ = MappedFile::openReadonly(index_path);
+        }
+        catch (const std::exception &)
+        {
+            return std::nullopt;
+        }
+
+        const auto bytes = index.file_.bytes();
+        Header header{};
+        if (bytes.size() < sizeof(header))
+        {
+            return std::nullopt;
+        }
+        std::memcpy(&header, bytes.data(), sizeof(header));
+
+        const std::size_t path_block = padTo8(header.path_bytes);
+        if (std::memcmp(header.magic, index_magic, sizeof(index_magic)) != 0 || header.version != index_version ||
+            FileStamp{header.file_size, header.file_mtime_ns} != expected || header.path_bytes != path_text.size() ||
+            !std::has_single_bit(header.bucket_count) ||
+            header.bucket_count > (bytes.size() - sizeof(header)) / sizeof(Bucket) ||
+            bytes.size() - sizeof(header) != path_block + header.bucket_count * sizeof(Bucket) + header.postings_bytes ||
+            std::memcmp(bytes.data() + sizeof(header), path_text.data(), path_text.size()) != 0)
+        {
+            return std::nullopt;
+        }
+
+        index.stamp_ = expected;
+        index.irregular_lines_ = header.irregular_lines;
+        index.bucket_count_ = header.bucket_count;
+        index.buckets_ = bytes.subspan(sizeof(header) + path_block, header.bucket_count * sizeof(Bucket));
+        index.postings_ = bytes.subspan(sizeof(header) + path_block + index.buckets_.size());
+        return index;
+    }
+
+    std::vector<std::uint64_t> ValueIndex::candidates(const QueryValue &value) const
+    {
+        std::vector<std::uint64_t> offsets;
+        const std::uint64_t hash = valueHash(value);
+
+        // Bounded by bucket_count_ in case the table has no empty slot.
+        for (std::uint64_t i = 0, slot = hash & (bucket_count_ - 1); i < bucket_count_;
+             ++i, slot = (slot + 1) & (bucket_count_ - 1))
+        {
+            Bucket bucket{};
+            std::memcpy(&bucket, buckets_.data() + slot * sizeof(Bucket), sizeof(bucket));
+            if (bucket.postings == empty_bucket)
+            {
+                break;
+            }
+            if (bucket.hash != hash)
+            {
+                continue;
+            }
+
+            auto pos = static_cast<std::size_t>(bucket.postings);
+            std::uint64_t count = 0;
+            if (pos >= postings_.size() || !readVarint(postings_, pos, count))
+            {
+                break;
+            }
+            std::uint64_t offset = 0;
+            for (std::uint64_t n = 0; n < count; ++n)
+            {
+                std::uint64_t delta = 0;
+                // Offsets past the data file can only come from a damaged index.
+                if (!readVarint(postings_, pos, delta) || offset + delta >= stamp_.size)
+                {
+                    break;
+                }
+                offset += delta;
+                offsets.push_back(offset);
+            }
+            break;
+        }
+        return offsets;
+    }
+
+} // namespace jlq
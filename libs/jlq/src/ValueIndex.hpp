@@ -0,0 +1,67 @@
+#pragma once
+
+#include "MappedFile.hpp"
+#include "QueryConfig.hpp"
+#include "Sidecar.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace jlq
+{
+
+    // Sidecar mapping the value found at one path to the lines holding it
+    // (`jlq index <file> --path <path>` writes it to valueIndexPath()).
+    //
+    // Values are normalized with the comparison rules of a query: strings by
+    // their unescaped bytes, numbers as doubles (so 1, 1.0 and 1e0 collide),
+    // booleans and null by kind. The table stores only a 64-bit hash of each
+    // normalized value, so lookups return candidates that must be re-checked.
+    //
+    // Layout (native endianness):
+    //   Header, path text padded to 8 bytes
+    //   buckets   open-addressing table of u64 hash + u64 postings offset
+    //   postings  per bucket: LEB128 count, then LEB128 deltas of line offsets
+    class ValueIndex
+    {
+    public:
+        // Indexes the value at `path` (spelled `path_text`) on every line of
+        // `bytes`, the contents of the file stamped `stamp`.
+        static void write(const std::string &index_path, std::span<const std::byte> bytes, FileStamp stamp,
+                          std::string_view path_text, std::span<const PathSegment> path);
+
+        // Maps the index at `index_path`. Returns nullopt if it is missing,
+        // malformed, built for another path or for a different version of the file.
+        [[nodiscard]] static std::optional<ValueIndex> open(const std::string &index_path, FileStamp expected,
+                                                            std::string_view path_text);
+
+        // Lines a query could report as malformed for this path (unparsable,
+        // oversized, or with an invalid value at the path). A strict query can
+        // only be answered from the index when this is zero.
+        [[nodiscard]] std::uint64_t irregularLines() const noexcept { return irregular_lines_; }
+
+        // Ascending byte offsets of the lines that may hold `value` at the path:
+        // every line that matches is included.
+        [[nodiscard]] std::vector<std::uint64_t> candidates(const QueryValue &value) const;
+
+    private:
+        ValueIndex() = default;
+
+        MappedFile file_;
+        FileStamp stamp_;
+        std::uint64_t irregular_lines_{0};
+        std::uint64_t bucket_count_{0};
+        std::span<const std::byte> buckets_;
+        std::span<const std::byte> postings_;
+    };
+
+    // Sidecar path for the value index of `path_text` on `data_path`. Characters
+    // that cannot appear in a file name are percent-encoded.
+    [[nodiscard]] std::string valueIndexPath(std::string_view data_path, std::string_view path_text);
+
+} // namespace jlq
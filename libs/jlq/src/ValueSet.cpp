@@ -0,0 +1,141 @@
+#include "ValueSet.hpp"
+
+#include "PathValue.hpp"
+
+#include <bit>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <variant>
+
+namespace jlq
+{
+
+    namespace
+    {
+
+        // The hash only lives in memory, so unlike valueHash() it need not be
+        // stable across builds: numbers skip the byte-wise string hash.
+        [[nodiscard]] std::uint64_t hashOf(const QueryValue &value) noexcept
+        {
+            if (const auto *s = std::get_if<std::string_view>(&value))
+            {
+                return std::hash<std::string_view>{}(*s);
+            }
+            if (const auto *d = std::get_if<double>(&value))
+            {
+                // -0.0 == 0.0 for the query, so they must share a hash.
+                return mix64(std::bit_cast<std::uint64_t>(*d == 0.0 ? 0.0 : *d));
+            }
+            return mix64(value.index() * 2 + (std::holds_alternative<bool>(value) && std::get<bool>(value)));
+        }
+
+    } // namespace
+
+    template <typename Equal>
+    std::size_t ValueSet::find(std::uint64_t hash, Equal &&equal) const noexcept
+    {
+        // The table is never full, so probing ends at an empty slot.
+        const std::size_t mask = slots_.size() - 1;
+        for (std::size_t slot = hash & mask;; slot = (slot + 1) & mask)
+        {
+            const Slot &s = slots_[slot];
+            if (s.entry == 0 || (s.hash == hash && equal(s.entry - 1)))
+            {
+                return slot;
+            }
+        }
+    }
+
+    void ValueSet::insert(const QueryValue &value, std::optional<IntegerValue> integer)
+    {
+        // Below 2^53 an integer is exactly its double and no other integer
+        // rounds to it; from 2^53 on, 2^53 + 1 already shares its double.
+        constexpr std::int64_t exact_limit = std::int64_t{1} << 53;
+        if (integer.has_value() && !integer->is_unsigned && integer->int64 > -exact_limit &&
+            integer->int64 < exact_limit)
+        {
+            integer.reset();
+        }
+
+        if ((values_.size() + 1) * 2 > slots_.size())
+        {
+            grow();
+        }
+        const std::uint64_t hash = hashOf(value);
+        const std::size_t slot = find(hash, [&](std::size_t entry)
+                                      { return values_[entry] == value && integers_[entry] == integer; });
+        if (slots_[slot].entry != 0)
+        {
+            return;
+        }
+        if (values_.size() >= std::numeric_limits<std::uint32_t>::max())
+        {
+            throw std::length_error("too many values");
+        }
+
+        QueryValue stored = value;
+        if (const auto *s = std::get_if<std::string_view>(&value))
+        {
+            stored = std::string_view(strings_.emplace_back(*s));
+        }
+        values_.push_back(stored);
+        integers_.push_back(integer);
+        has_integers_ = has_integers_ || integer.has_value();
+        slots_[slot] = Slot{hash, static_cast<std::uint32_t>(values_.size())};
+    }
+
+    bool ValueSet::contains(const QueryValue &value) const noexcept
+    {
+        if (const auto *d = std::get_if<double>(&value))
+        {
+            return contains(NumberValue{*d});
+        }
+        if (slots_.empty())
+        {
+            return false;
+        }
+        const std::size_t slot = find(hashOf(value), [&](std::size_t entry)
+                                      { return values_[entry] == value; });
+        return slots_[slot].entry != 0;
+    }
+
+    bool ValueSet::contains(const NumberValue &number) const noexcept
+    {
+        // Integers sharing a double share its hash, so every candidate is in
+        // the chain of `number.real`.
+        auto equal = [&](std::size_t entry)
+        {
+            const auto *d = std::get_if<double>(&values_[entry]);
+            if (d == nullptr || *d != number.real)
+            {
+                return false;
+            }
+            const std::optional<IntegerValue> &integer = integers_[entry];
+            return !integer.has_value() || (number.is_integer ? number.integer == *integer : integer->equals(number.real));
+        };
+        return !slots_.empty() && slots_[find(hashOf(QueryValue{number.real}), equal)].entry != 0;
+    }
+
+    void ValueSet::grow()
+    {
+        std::vector<Slot> old = std::move(slots_);
+        slots_.assign(old.empty() ? 16 : old.size() * 2, Slot{});
+        const std::size_t mask = slots_.size() - 1;
+        for (const Slot &s : old)
+        {
+            if (s.entry == 0)
+            {
+                continue;
+            }
+            std::size_t slot = s.hash & mask;
+            while (slots_[slot].entry != 0)
+            {
+                slot = (slot + 1) & mask;
+            }
+            slots_[slot] = s;
+        }
+    }
+
+} // namespace jlq
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "QueryConfig.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace jlq
+{
+
+    // Values a query accepts at its path (`--values-from`), in an
+    // open-addressing hash table (linear probing, at most half full) built
+    // once, so a line costs one hash and usually one probe however many values
+    // there are. Values compare like a single `--value`: strings by their
+    // unescaped bytes, numbers as doubles (-0 equals 0), except integers
+    // at or beyond 2^53, which compare exactly.
+    class ValueSet
+    {
+    public:
+        // Adds `value`; strings are copied. Duplicates are ignored. A number
+        // written as an integer that fits 64 bits is passed as `integer` too.
+        void insert(const QueryValue &value, std::optional<IntegerValue> integer = std::nullopt);
+
+        [[nodiscard]] bool contains(const QueryValue &value) const noexcept;
+        // Reads `number.integer` for an integer number; see readNumber().
+        [[nodiscard]] bool contains(const NumberValue &number) const noexcept;
+
+        // Whether numbers must be read as integers to be looked up exactly.
+        [[nodiscard]] bool hasIntegers() const noexcept { return has_integers_; }
+
+        [[nodiscard]] std::size_t size() const noexcept { return values_.size(); }
+        [[nodiscard]] bool empty() const noexcept { return values_.empty(); }
+
+        // The distinct values, in insertion order.
+        [[nodiscard]] std::span<const QueryValue> values() const noexcept { return values_; }
+
+    private:
+        struct Slot
+        {
+            std::uint64_t hash{0};
+            // Index into values_ plus one; 0 marks an empty slot.
+            std::uint32_t entry{0};
+        };
+
+        // The slot of the first value in `hash`'s chain that `equal(entry)`
+        // accepts, or of the empty slot ending the chain.
+        template <typename Equal>
+        [[nodiscard]] std::size_t find(std::uint64_t hash, Equal &&equal) const noexcept;
+        void grow();
+
+        std::vector<Slot> slots_;
+        std::vector<QueryValue> values_;
+        // Per value, the exact integer of a number at or beyond 2^53.
+        std::vector<std::optional<IntegerValue>> integers_;
+        bool has_integers_{false};
+        // Owns the strings values_ view into.
+        std::deque<std::string> strings_;
+    };
+
+} // namespace jlq
@@ -0,0 +1,267 @@
+#include "WindowReader.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <utility>
+
+namespace jlq
+{
+
+    namespace
+    {
+
+        // Larger pipe buffers let a fast writer run ahead of the reader. The
+        // default unprivileged limit (/proc/sys/fs/pipe-max-size).
+        constexpr int pipe_bytes = 1 << 20;
+        // How often a read waiting on an idle descriptor checks for cancel().
+        constexpr int cancel_poll_ms = 100;
+
+    } // namespace
+
+    FdSource::FdSource(int fd) : fd_{fd}
+    {
+        struct stat st{};
+        if (::fstat(fd_, &st) == 0 && S_ISFIFO(st.st_mode))
+        {
+            // Best effort: a smaller pipe only means smaller reads.
+            (void)::fcntl(fd_, F_SETPIPE_SZ, pipe_bytes);
+        }
+    }
+
+    std::size_t FdSource::read(std::span<std::byte> out)
+    {
+        while (!cancelled_.load(std::memory_order_relaxed))
+        {
+            pollfd pfd{fd_, POLLIN, 0};
+            const int polled = ::poll(&pfd, 1, cancel_poll_ms);
+            if (polled == 0 || (polled < 0 && errno == EINTR))
+            {
+                continue;
+            }
+            if (polled < 0)
+            {
+                throw std::system_error(errno, std::generic_category(), "poll");
+            }
+            const ssize_t n = ::read(fd_, out.data(), out.size());
+            if (n >= 0)
+            {
+                return static_cast<std::size_t>(n);
+            }
+            if (errno != EINTR && errno != EAGAIN)
+            {
+                throw std::system_error(errno, std::generic_category(), "read");
+            }
+        }
+        return 0;
+    }
+
+    bool FdSource::ready()
+    {
+        pollfd pfd{fd_, POLLIN, 0};
+        return ::poll(&pfd, 1, 0) != 0;
+    }
+
+    WindowReader::WindowReader(ByteSource &source, std::size_t padding, std::size_t buffer_bytes,
+                               std::size_t buffers, std::size_t max_line_bytes)
+        : source_{source},
+          padding_{padding},
+          max_line_bytes_{max_line_bytes},
+          buffers_(std::max<std::size_t>(buffers, 2)),
+          lengths_(buffers_.size(), 0),
+          free_{buffers_.size()},
+          full_{buffers_.size() + 1}
+    {
+        for (std::size_t i = 0; i < buffers_.size(); ++i)
+        {
+            buffers_[i].resize(std::max<std::size_t>(buffer_bytes, 1) + padding_);
+            push(free_, i);
+        }
+        thread_ = std::jthread([this]
+                               { produce(); });
+    }
+
+    WindowReader::~WindowReader()
+    {
+        stop_.store(true, std::memory_order_relaxed);
+        // The reader thread may be waiting on the source rather than on us.
+        source_.cancel();
+    }
+
+    std::optional<InputWindow> WindowReader::next()
+    {
+        if (current_ != end_marker)
+        {
+            push(free_, std::exchange(current_, end_marker));
+        }
+        const auto index = pop(full_);
+        if (!index.has_value() || *index == end_marker)
+        {
+            if (thread_.joinable())
+            {
+                thread_.join();
+            }
+            if (error_)
+            {
+                std::rethrow_exception(error_);
+            }
+            // Later calls keep reporting the end.
+            push(full_, end_marker);
+            return std::nullopt;
+        }
+        current_ = *index;
+        const std::vector<std::byte> &buffer = buffers_[current_];
+        return InputWindow{std::span(buffer.data(), lengths_[current_]), buffer.size() - lengths_[current_]};
+    }
+
+    void WindowReader::produce()
+    {
+        try
+        {
+            // A buffer holding one unfinished line grows up to this capacity:
+            // the longest line kept, plus room to read and drop what follows.
+            const std::size_t line_capacity = max_line_bytes_ + 1 + skip_bytes;
+            std::vector<std::byte> carry;
+            bool at_end = false;
+            while (!at_end)
+            {
+                const auto index = pop(free_);
+                if (!index.has_value())
+                {
+                    return;
+                }
+                std::vector<std::byte> &buffer = buffers_[*index];
+                if (carry.size() + padding_ >= buffer.size())
+                {
+                    buffer.resize(std::max(std::min(2 * carry.size(), line_capacity), carry.size() + 1) + padding_);
+                }
+                std::memcpy(buffer.data(), carry.data(), carry.size());
+                std::size_t used = carry.size();
+                std::size_t cut = 0;
+
+                // Fill the buffer (or read what the source has ready), then cut
+                // after its last newline. A buffer holding no newline is doubled
+                // until the line fits or is cut short.
+                for (;;)
+                {
+                    used = fill(buffer, used, at_end);
+                    if (stop_.load(std::memory_order_relaxed))
+                    {
+                        return;
+                    }
+                    if (at_end)
+                    {
+                        cut = used;
+                        break;
+                    }
+                    const auto *last = static_cast<const std::byte *>(::memrchr(buffer.data(), '\n', used));
+                    if (last != nullptr)
+                    {
+                        cut = static_cast<std::size_t>(last - buffer.data()) + 1;
+                        break;
+                    }
+                    const std::size_t capacity = buffer.size() - padding_;
+                    if (used < capacity)
+                    {
+                        // Drained mid-line: wait for the rest of it.
+                        continue;
+                    }
+                    if (used > max_line_bytes_ && capacity > max_line_bytes_ + 1)
+                    {
+                        used = skipLineRest(buffer, max_line_bytes_ + 1, at_end);
+                        continue;
+                    }
+                    buffer.resize(std::min(2 * capacity, line_capacity) + padding_);
+                }
+
+                carry.assign(buffer.begin() + static_cast<std::ptrdiff_t>(cut),
+                             buffer.begin() + static_cast<std::ptrdiff_t>(used));
+                lengths_[*index] = cut;
+                if (cut == 0)
+                {
+                    push(free_, *index);
+                    continue;
+                }
+                push(full_, *index);
+            }
+        }
+        catch (...)
+        {
+            error_ = std::current_exception();
+        }
+        push(full_, end_marker);
+    }
+
+    std::size_t WindowReader::fill(std::vector<std::byte> &buffer, std::size_t used, bool &at_end)
+    {
+        const std::size_t capacity = buffer.size() - padding_;
+        while (used < capacity && !stop_.load(std::memory_order_relaxed))
+        {
+            const std::size_t n = source_.read(std::span(buffer.data() + used, capacity - used));
+            used += n;
+            if (n == 0)
+            {
+                at_end = true;
+                break;
+            }
+            if (used < capacity && !source_.ready())
+            {
+                break;
+            }
+        }
+        return used;
+    }
+
+    std::size_t WindowReader::skipLineRest(std::vector<std::byte> &buffer, std::size_t used, bool &at_end)
+    {
+        const std::size_t capacity = buffer.size() - padding_;
+        while (!stop_.load(std::memory_order_relaxed))
+        {
+            std::byte *const start = buffer.data() + used;
+            const std::size_t n = source_.read(std::span(start, capacity - used));
+            if (n == 0)
+            {
+                at_end = true;
+                break;
+            }
+            const auto *newline = static_cast<const std::byte *>(std::memchr(start, '\n', n));
+            if (newline != nullptr)
+            {
+                // Keep the newline so the cut line still ends where it should.
+                const auto rest = static_cast<std::size_t>(start + n - newline);
+                std::memmove(start, newline, rest);
+                return used + rest;
+            }
+        }
+        return used;
+    }
+
+    std::optional<std::size_t> WindowReader::pop(BoundedQueue<std::size_t> &queue)
+    {
+        Backoff backoff;
+        std::size_t index = 0;
+        while (!queue.tryPop(index))
+        {
+            if (stop_.load(std::memory_order_relaxed))
+            {
+                return std::nullopt;
+            }
+            backoff.pause();
+        }
+        return index;
+    }
+
+    void WindowReader::push(BoundedQueue<std::size_t> &queue, std::size_t index)
+    {
+        // Each queue holds every buffer index at most once (plus the end
+        // marker), so it never fills up.
+        [[maybe_unused]] const bool pushed = queue.tryPush(index);
+    }
+
+} // namespace jlq
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "BoundedQueue.hpp"
+#include "LineScanner.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace jlq
+{
+
+    // Sequential input that cannot be mapped (decompressed data, pipes).
+    class ByteSource
+    {
+    public:
+        virtual ~ByteSource() = default;
+
+        // Fills a prefix of `out` and returns its length; 0 only at the end of
+        // the input (or after cancel()). Throws on errors.
+        virtual std::size_t read(std::span<std::byte> out) = 0;
+
+        // Whether read() can return more bytes without waiting. Sources that
+        // never wait for data keep the default.
+        [[nodiscard]] virtual bool ready() { return true; }
+
+        // Makes a read() that waits for data, now or later, return 0. Called
+        // from another thread.
+        virtual void cancel() noexcept {}
+    };
+
+    // Reads a file descriptor (stdin, a pipe or a file) with large read()s. A
+    // pipe's buffer is enlarged where the kernel allows, so a fast writer fills
+    // more per call. `fd` is not owned.
+    class FdSource final : public ByteSource
+    {
+    public:
+        explicit FdSource(int fd);
+
+        // Throws std::system_error on read errors.
+        std::size_t read(std::span<std::byte> out) override;
+        [[nodiscard]] bool ready() override;
+        void cancel() noexcept override { cancelled_.store(true, std::memory_order_relaxed); }
+
+    private:
+        int fd_;
+        std::atomic<bool> cancelled_{false};
+    };
+
+    // Whole lines of a ByteSource, ending in '\n' except possibly the last line
+    // of the input.
+    struct InputWindow
+    {
+        std::span<const std::byte> bytes{};
+        // Readable bytes following `bytes` (see QueryInput::padding).
+        std::size_t padding{0};
+    };
+
+    // Reads a ByteSource on a background thread into a ring of large buffers, so
+    // producing the bytes (e.g. decompressing) overlaps with querying them.
+    //
+    // Each buffer is handed out as one window cut after its last newline; the
+    // partial line behind the cut is carried to the front of the next buffer. A
+    // buffer grows only to fit a line longer than itself, and a line longer
+    // than `max_line_bytes` is cut short (one byte over the limit, so it still
+    // reads as oversized), so memory stays bounded however long the input or
+    // its lines are. When the source has nothing more ready, the complete lines
+    // read so far are handed out at once rather than after the buffer fills.
+    class WindowReader
+    {
+    public:
+        static constexpr std::size_t default_buffer_bytes = 4ULL << 20;
+        static constexpr std::size_t default_buffers = 4;
+
+        // Starts reading `source`, which must outlive the reader. At least
+        // `padding` readable bytes follow every window.
+        WindowReader(ByteSource &source, std::size_t padding, std::size_t buffer_bytes = default_buffer_bytes,
+                     std::size_t buffers = default_buffers,
+                     std::size_t max_line_bytes = LineScanner::max_line_length);
+
+        WindowReader(const WindowReader &) = delete;
+        WindowReader &operator=(const WindowReader &) = delete;
+
+        // Stops the reader thread, abandoning unread input.
+        ~WindowReader();
+
+        // The next window, valid until the following call; nullopt at the end of
+        // the input. Rethrows an exception thrown by the source.
+        [[nodiscard]] std::optional<InputWindow> next();
+
+    private:
+        // Pushed to full_ after the last window.
+        static constexpr std::size_t end_marker = static_cast<std::size_t>(-1);
+        // Room kept after a cut-short line to read and drop its remainder.
+        static constexpr std::size_t skip_bytes = 64ULL << 10;
+
+        void produce();
+        // Reads into `buffer` past `used` until it holds a complete line after
+        // `used` or the source is drained or ends; returns the new fill.
+        [[nodiscard]] std::size_t fill(std::vector<std::byte> &buffer, std::size_t used, bool &at_end);
+        // Drops the rest of an overlong line; the next line follows at `used`.
+        [[nodiscard]] std::size_t skipLineRest(std::vector<std::byte> &buffer, std::size_t used, bool &at_end);
+        // Waits for a buffer index from `queue`; nullopt once the reader is stopped.
+        [[nodiscard]] std::optional<std::size_t> pop(BoundedQueue<std::size_t> &queue);
+        void push(BoundedQueue<std::size_t> &queue, std::size_t index);
+
+        ByteSource &source_;
+        std::size_t padding_;
+        std::size_t max_line_bytes_;
+        std::vector<std::vector<std::byte>> buffers_;
+        // Window length per buffer, written before the buffer is queued as full.
+        std::vector<std::size_t> lengths_;
+        BoundedQueue<std::size_t> free_;
+        BoundedQueue<std::size_t> full_;
+        // Buffer of the window last returned by next(), or end_marker.
+        std::size_t current_{end_marker};
+        std::exception_ptr error_;
+        std::atomic<bool> stop_{false};
+        std::jthread thread_;
+    };
+
+} // namespace jlq
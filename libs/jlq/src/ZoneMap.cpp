@@ -0,0 +1,401 @@
+#include "ZoneMap.hpp"
+
+#include "LineScanner.hpp"
+#include "PathValue.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <type_traits>
+#include <variant>
+
+namespace jlq
+{
+
+    namespace
+    {
+
+        constexpr char index_magic[8] = {'J', 'L', 'Q', 'Z', 'O', 'N', 'E', '\0'};
+        constexpr std::uint32_t index_version = 1;
+
+        struct Header
+        {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t path_count;
+            std::uint64_t file_size;
+            std::int64_t file_mtime_ns;
+            std::uint64_t block_count;
+            std::uint64_t paths_bytes;
+            std::uint64_t bloom_words;
+        };
+
+        enum ZoneFlags : std::uint32_t
+        {
+            has_string = 1U << 0,
+            has_number = 1U << 1,
+            has_true = 1U << 2,
+            has_false = 1U << 3,
+            has_null = 1U << 4,
+            has_irregular = 1U << 5,
+        };
+
+        struct Zone
+        {
+            double min;
+            double max;
+            std::uint32_t flags;
+            std::uint32_t bloom_words;
+            std::uint64_t bloom_offset;
+        };
+
+        // ~10 bits per distinct value and 5 probes: about 1% false positives
+        // until the filter hits its cap (32 KiB per block and path).
+        constexpr std::size_t bloom_bits_per_value = 10;
+        constexpr std::size_t bloom_max_words = 4096;
+        constexpr unsigned bloom_probes = 5;
+
+        [[nodiscard]] constexpr std::size_t padTo8(std::size_t n) noexcept
+        {
+            return (n + 7) & ~std::size_t{7};
+        }
+
+        // Double hashing: probe i sets bit h1 + i * h2.
+        template <typename Fn>
+        void forEachProbe(std::uint64_t hash, std::uint64_t bits, Fn &&fn)
+        {
+            const std::uint64_t h2 = std::rotl(hash, 32) | 1;
+            for (unsigned i = 0; i < bloom_probes; ++i)
+            {
+                fn((hash + i * h2) & (bits - 1));
+            }
+        }
+
+        // Accumulates one block's summary for one path.
+        struct ZoneBuilder
+        {
+            Zone zone{std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(), 0, 0, 0};
+            std::vector<std::uint64_t> hashes;
+
+            void add(const PathValue &value)
+            {
+                switch (value.kind)
+                {
+                case PathValueKind::String:
+                    zone.flags |= has_string;
+                    break;
+                case PathValueKind::Number:
+                    zone.flags |= has_number;
+                    zone.min = std::min(zone.min, value.number);
+                    zone.max = std::max(zone.max, value.number);
+                    break;
+                case PathValueKind::Bool:
+                    zone.flags |= value.boolean ? has_true : has_false;
+                    return;
+                case PathValueKind::Null:
+                    zone.flags |= has_null;
+                    return;
+                case PathValueKind::None:
+                    return;
+                case PathValueKind::Irregular:
+                    zone.flags |= has_irregular;
+                    return;
+                }
+                hashes.push_back(valueHash(value));
+            }
+
+            // Appends the Bloom filter to `bloom` and returns the finished zone.
+            Zone finish(std::vector<std::uint64_t> &bloom)
+            {
+                std::sort(hashes.begin(), hashes.end());
+                hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+                if (!hashes.empty())
+                {
+                    const std::size_t wanted = (hashes.size() * bloom_bits_per_value + 63) / 64;
+                    const std::size_t words = std::min(std::bit_ceil(wanted), bloom_max_words);
+                    zone.bloom_offset = bloom.size();
+                    zone.bloom_words = static_cast<std::uint32_t>(words);
+                    bloom.resize(bloom.size() + words, 0);
+                    std::uint64_t *filter = bloom.data() + zone.bloom_offset;
+                    for (const std::uint64_t hash : hashes)
+                    {
+                        forEachProbe(hash, words * 64, [&](std::uint64_t bit)
+                                     { filter[bit / 64] |= std::uint64_t{1} << (bit % 64); });
+                    }
+                }
+
+                const Zone done = zone;
+                *this = ZoneBuilder{};
+                return done;
+            }
+        };
+
+        template <typename T>
+        [[nodiscard]] T load(std::span<const std::byte> bytes, std::size_t index) noexcept
+        {
+            T value{};
+            std::memcpy(&value, bytes.data() + index * sizeof(T), sizeof(T));
+            return value;
+        }
+
+        // Whether a block whose zone is `zone` may hold `value` (hashed to `hash`).
+        [[nodiscard]] bool mayContain(const Zone &zone, std::span<const std::byte> bloom, const QueryValue &value,
+                                      std::uint64_t hash) noexcept
+        {
+            const bool kind_present = std::visit(
+                [&](const auto &v)
+                {
+                    using T = std::decay_t<decltype(v)>;
+                    if constexpr (std::is_same_v<T, std::string_view>)
+                    {
+                        return (zone.flags & has_string) != 0;
+                    }
+                    else if constexpr (std::is_same_v<T, double>)
+                    {
+                        return (zone.flags & has_number) != 0 && zone.min <= v && v <= zone.max;
+                    }
+                    else if constexpr (std::is_same_v<T, bool>)
+                    {
+                        return (zone.flags & (v ? has_true : has_false)) != 0;
+                    }
+                    else
+                    {
+                        return (zone.flags & has_null) != 0;
+                    }
+                },
+                value);
+            if (!kind_present || !(std::holds_alternative<std::string_view>(value) || std::holds_alternative<double>(value)))
+            {
+                return kind_present;
+            }
+
+            // A filter outside the table can only come from a damaged file: keep
+            // the block rather than risk dropping matches.
+            if (zone.bloom_words == 0 || !std::has_single_bit(zone.bloom_words) ||
+                zone.bloom_offset + zone.bloom_words > bloom.size() / sizeof(std::uint64_t))
+            {
+                return true;
+            }
+            bool all_set = true;
+            forEachProbe(hash, std::uint64_t{zone.bloom_words} * 64, [&](std::uint64_t bit)
+                         {
+                const auto word = load<std::uint64_t>(bloom, zone.bloom_offset + bit / 64);
+                all_set = all_set && (word & (std::uint64_t{1} << (bit % 64))) != 0; });
+            return all_set;
+        }
+
+    } // namespace
+
+    std::string zoneMapPath(std::string_view data_path)
+    {
+        return std::string(data_path) + ".jlqzone";
+    }
+
+    void ZoneMap::write(const std::string &index_path, std::span<const std::byte> bytes, FileStamp stamp,
+                        std::span<const std::string_view> path_texts, std::size_t block_bytes)
+    {
+        std::vector<std::vector<PathSegment>> paths;
+        std::vector<PathValueReader> readers;
+        std::vector<std::byte> path_block;
+        paths.reserve(path_texts.size());
+        readers.reserve(path_texts.size());
+        for (const std::string_view text : path_texts)
+        {
+            paths.push_back(parseDotPath(text));
+            readers.emplace_back(paths.back());
+
+            const auto length = static_cast<std::uint32_t>(text.size());
+            const auto length_bytes = std::as_bytes(std::span(&length, 1));
+            path_block.insert(path_block.end(), length_bytes.begin(), length_bytes.end());
+            const auto text_bytes = std::as_bytes(std::span(text));
+            path_block.insert(path_block.end(), text_bytes.begin(), text_bytes.end());
+        }
+        path_block.resize(padTo8(path_block.size()));
+
+        std::vector<std::uint64_t> ends;
+        std::vector<Zone> zones;
+        std::vector<std::uint64_t> bloom;
+        std::vector<ZoneBuilder> builders(paths.size());
+        auto closeBlock = [&](std::uint64_t end)
+        {
+            ends.push_back(end);
+            for (ZoneBuilder &builder : builders)
+            {
+                zones.push_back(builder.finish(bloom));
+            }
+        };
+
+        std::uint64_t block_begin = 0;
+        LineScanner scanner(bytes);
+        ScannedLine line;
+        while (scanner.next(line))
+        {
+            const auto offset = static_cast<std::uint64_t>(line.raw.data() - bytes.data());
+            if (offset - block_begin >= block_bytes)
+            {
+                closeBlock(offset);
+                block_begin = offset;
+            }
+            for (std::size_t i = 0; i < readers.size(); ++i)
+            {
+                builders[i].add(readers[i].read(line));
+            }
+        }
+        if (!bytes.empty())
+        {
+            closeBlock(bytes.size());
+        }
+
+        Header header{};
+        std::memcpy(header.magic, index_magic, sizeof(index_magic));
+        header.version = index_version;
+        header.path_count = static_cast<std::uint32_t>(paths.size());
+        header.file_size = stamp.size;
+        header.file_mtime_ns = stamp.mtime_ns;
+        header.block_count = ends.size();
+        header.paths_bytes = path_block.size();
+        header.bloom_words = bloom.size();
+
+        const std::span<const std::byte> parts[] = {
+            std::as_bytes(std::span(&header, 1)), path_block, std::as_bytes(std::span(ends)),
+            std::as_bytes(std::span(zones)), std::as_bytes(std::span(bloom))};
+        writeFileAtomically(index_path, parts);
+    }
+
+    std::optional<ZoneMap> ZoneMap::open(const std::string &index_path, FileStamp expected)
+    {
+        ZoneMap map;
+        try
+        {
+            map.file_ = MappedFile::openReadonly(index_path);
+        }
+        catch (const std::exception &)
+        {
+            return std::nullopt;
+        }
+
+        const auto bytes = map.file_.bytes();
+        Header header{};
+        if (bytes.size() < sizeof(header))
+        {
+            return std::nullopt;
+        }
+        std::memcpy(&header, bytes.data(), sizeof(header));
+
+        const std::uint64_t body = bytes.size() - sizeof(header);
+        const std::uint64_t max_blocks = body / sizeof(std::uint64_t);
+        if (std::memcmp(header.magic, index_magic, sizeof(index_magic)) != 0 || header.version != index_version ||
+            FileStamp{header.file_size, header.file_mtime_ns} != expected || header.path_count == 0 ||
+            header.block_count > max_blocks || header.paths_bytes > body || header.bloom_words > max_blocks ||
+            body != header.paths_bytes + header.block_count * sizeof(std::uint64_t) +
+                        header.block_count * header.path_count * sizeof(Zone) +
+                        header.bloom_words * sizeof(std::uint64_t))
+        {
+            return std::nullopt;
+        }
+
+        const auto path_block = bytes.subspan(sizeof(header), header.paths_bytes);
+        std::size_t pos = 0;
+        for (std::uint32_t i = 0; i < header.path_count; ++i)
+        {
+            std::uint32_t length = 0;
+            if (path_block.size() - pos < sizeof(length))
+            {
+                return std::nullopt;
+            }
+            std::memcpy(&length, path_block.data() + pos, sizeof(length));
+            pos += sizeof(length);
+            if (path_block.size() - pos < length)
+            {
+                return std::nullopt;
+            }
+            try
+            {
+                map.paths_.push_back(
+                    parseDotPath(std::string_view(reinterpret_cast<const char *>(path_block.data() + pos), length)));
+            }
+            catch (const std::exception &)
+            {
+                return std::nullopt;
+            }
+            pos += length;
+        }
+
+        map.stamp_ = expected;
+        map.block_count_ = static_cast<std::size_t>(header.block_count);
+        std::size_t offset = sizeof(header) + header.paths_bytes;
+        map.ends_ = bytes.subspan(offset, header.block_count * sizeof(std::uint64_t));
+        offset += map.ends_.size();
+        map.zones_ = bytes.subspan(offset, header.block_count * header.path_count * sizeof(Zone));
+        offset += map.zones_.size();
+        map.bloom_ = bytes.subspan(offset);
+        return map;
+    }
+
+    std::optional<std::size_t> ZoneMap::slotOf(std::span<const PathSegment> path) const noexcept
+    {
+        for (std::size_t slot = 0; slot < paths_.size(); ++slot)
+        {
+            if (std::equal(path.begin(), path.end(), paths_[slot].begin(), paths_[slot].end(),
+                           [](const PathSegment &a, const PathSegment &b)
+                           { return a.kind == b.kind && a.key == b.key && a.index == b.index; }))
+            {
+                return slot;
+            }
+        }
+        return std::nullopt;
+    }
+
+    template <typename MayContain>
+    std::vector<std::span<const std::byte>> ZoneMap::selectBlocks(std::span<const std::byte> bytes, std::size_t slot,
+                                                                  bool strict, MayContain &&may_contain) const
+    {
+        std::vector<std::span<const std::byte>> blocks;
+        std::uint64_t begin = 0;
+        for (std::size_t block = 0; block < block_count_; ++block)
+        {
+            const auto end = std::min<std::uint64_t>(load<std::uint64_t>(ends_, block), bytes.size());
+            const auto zone = load<Zone>(zones_, block * paths_.size() + slot);
+            if (end > begin && ((strict && (zone.flags & has_irregular) != 0) || may_contain(zone)))
+            {
+                blocks.push_back(bytes.subspan(begin, end - begin));
+            }
+            begin = std::max(begin, end);
+        }
+        return blocks;
+    }
+
+    std::vector<std::span<const std::byte>> ZoneMap::candidateBlocks(std::span<const std::byte> bytes,
+                                                                     std::size_t slot,
+                                                                     std::span<const QueryValue> values,
+                                                                     bool strict) const
+    {
+        std::vector<std::uint64_t> hashes;
+        hashes.reserve(values.size());
+        for (const QueryValue &value : values)
+        {
+            hashes.push_back(valueHash(value));
+        }
+        return selectBlocks(bytes, slot, strict, [&](const Zone &zone)
+                            {
+            for (std::size_t i = 0; i < values.size(); ++i)
+            {
+                if (mayContain(zone, bloom_, values[i], hashes[i]))
+                {
+                    return true;
+                }
+            }
+            return false; });
+    }
+
+    std::vector<std::span<const std::byte>> ZoneMap::candidateBlocks(std::span<const std::byte> bytes,
+                                                                     std::size_t slot, const NumberRange &range,
+                                                                     bool strict) const
+    {
+        return selectBlocks(bytes, slot, strict, [&](const Zone &zone)
+                            { return (zone.flags & has_number) != 0 && range.overlaps(zone.min, zone.max); });
+    }
+
+} // namespace jlq
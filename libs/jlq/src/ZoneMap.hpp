@@ -0,0 +1,92 @@
+#pragma once
+
+#include "MappedFile.hpp"
+#include "QueryConfig.hpp"
+#include "Sidecar.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace jlq
+{
+
+    // Sidecar summarizing fixed-size blocks of a data file for a few paths
+    // (`jlq index <file> --zones <path>` writes it to `<file>.jlqzone`).
+    //
+    // Blocks hold whole lines, about `block_bytes` each. Per block and path it
+    // records which kinds of values occur, the numeric min/max, and a Bloom
+    // filter of the values' hashes, so a query can skip every block that cannot
+    // hold a match. Block boundaries double as parallel split points.
+    //
+    // Layout (native endianness):
+    //   Header
+    //   paths    u32 length + text per path, padded to 8 bytes
+    //   ends     u64 end offset per block (a block starts where the previous ends)
+    //   zones    one Zone per block and path, block-major
+    //   bloom    u64 words referenced by the zones
+    class ZoneMap
+    {
+    public:
+        static constexpr std::size_t default_block_bytes = 1ULL << 20;
+
+        // Summarizes `bytes` (the contents of the file stamped `stamp`) for each
+        // of `path_texts`. Throws std::invalid_argument for an invalid path.
+        static void write(const std::string &index_path, std::span<const std::byte> bytes, FileStamp stamp,
+                          std::span<const std::string_view> path_texts, std::size_t block_bytes = default_block_bytes);
+
+        // Maps the zone map at `index_path`. Returns nullopt if it is missing,
+        // malformed, or was built for a different version of the file.
+        [[nodiscard]] static std::optional<ZoneMap> open(const std::string &index_path, FileStamp expected);
+
+        // Slot of the summarized path equal to `path`, if any.
+        [[nodiscard]] std::optional<std::size_t> slotOf(std::span<const PathSegment> path) const noexcept;
+
+        [[nodiscard]] std::size_t blockCount() const noexcept { return block_count_; }
+
+        // Blocks of `bytes` (in file order) that may hold a line whose value at
+        // path `slot` equals one of `values`. With `strict`, blocks holding lines
+        // a query could report as malformed are kept too, so strict errors still
+        // surface.
+        [[nodiscard]] std::vector<std::span<const std::byte>> candidateBlocks(std::span<const std::byte> bytes,
+                                                                            std::size_t slot,
+                                                                            std::span<const QueryValue> values,
+                                                                            bool strict) const;
+        [[nodiscard]] std::vector<std::span<const std::byte>> candidateBlocks(std::span<const std::byte> bytes,
+                                                                            std::size_t slot, const QueryValue &value,
+                                                                            bool strict) const
+        {
+            return candidateBlocks(bytes, slot, std::span(&value, 1), strict);
+        }
+
+        // Blocks that may hold a line whose number at path `slot` lies in `range`.
+        [[nodiscard]] std::vector<std::span<const std::byte>> candidateBlocks(std::span<const std::byte> bytes,
+                                                                            std::size_t slot, const NumberRange &range,
+                                                                            bool strict) const;
+
+    private:
+        template <typename MayContain>
+        [[nodiscard]] std::vector<std::span<const std::byte>> selectBlocks(std::span<const std::byte> bytes,
+                                                                         std::size_t slot, bool strict,
+                                                                         MayContain &&may_contain) const;
+
+        ZoneMap() = default;
+
+        MappedFile file_;
+        FileStamp stamp_;
+        std::size_t block_count_{0};
+        // Parsed paths; keys view into the mapping.
+        std::vector<std::vector<PathSegment>> paths_;
+        std::span<const std::byte> ends_;
+        std::span<const std::byte> zones_;
+        std::span<const std::byte> bloom_;
+    };
+
+    // Sidecar path for the zone map of `data_path`.
+    [[nodiscard]] std::string zoneMapPath(std::string_view data_path);
+
+} // namespace jlq
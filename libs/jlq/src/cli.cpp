@@ -1,17 +1,37 @@
 #include "jlq/cli.hpp"
 
+#include "Decompressor.hpp"
 #include "ExitCode.hpp"
+#include "FileSet.hpp"
+#include "FileSource.hpp"
+#include "LineIndex.hpp"
+#include "LineScanner.hpp"
 #include "MappedFile.hpp"
 
+#include "OutputSink.hpp"
 #include "path.hpp"
 #include "Query.hpp"
 #include "QueryConfig.hpp"
+#include "ValueIndex.hpp"
+#include "ValueSet.hpp"
+#include "WindowReader.hpp"
+#include "ZoneMap.hpp"
 
+#include <simdjson.h>
+
+#include <algorithm>
 #include <iostream>
 #include <charconv>
 #include <cmath>
+#include <deque>
 #include <limits>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
 
 namespace jlq
 {
@@ -29,13 +49,40 @@ namespace jlq
 
         void printUsage(std::ostream &os)
         {
-            os << "Usage: jlq <file> --path <path> --value <value> [--type <type>] [--threads <n>] [--strict]\n";
+            os << "Usage: jlq [<file>... | -] [--path <path> (--value <value> [--type <type>] | --gt|--ge|--lt|--le <n> | --between <a> <b> | --values-from <file> [--type <type>])] [--where <path>=<value> ...] [--threads <n>] [--ordered] [--engine <engine>] [--io <backend>] [--max-rss <size>] [--select <path>,... [--format <format>]] [--with-filename] [--group-by <path> | --distinct <path>] [--count | --quiet] [--max-count <n>] [--strict]\n";
+            os << "       jlq index <file> [--path <path> | --zones <path>...]\n";
+            os << "\n";
+            os << "Commands:\n";
+            os << "  index               Write <file>.jlqidx (line offsets); later queries use it while the file is unchanged\n";
+            os << "  index --path <path> Write a value index for <path>; --path/--value queries on it read only matching lines\n";
+            os << "  index --zones <path> Write <file>.jlqzone (per-block summaries of each --zones path); queries on them skip blocks that cannot match\n";
+            os << "\n";
+            os << "Arguments:\n";
+            os << "  <file>...           Files, directories (every file below them) or quoted glob patterns, queried in order\n";
             os << "\n";
             os << "Options:\n";
             os << "  --path <path>       Dot-notation path (keys + array indices, e.g. a.b.0.c)\n";
             os << "  --value <value>     Exact-match value (ignored for --type null)\n";
             os << "  --type <type>       string (default), number, bool, null\n";
-            os << "  --threads <n>       Validate n >= 1 (stored; Phase 3 is single-threaded)\n";
+            os << "  --gt, --ge, --lt, --le <n>  Instead of --value, require a number >, >=, <, <= <n> (bounds combine)\n";
+            os << "  --between <a> <b>   Instead of --value, require a number in [a, b]\n";
+            os << "  --values-from <file>  Instead of --value, match any value listed in <file>, one per line\n";
+            os << "  --where <path>=<value>  Also require <path> to equal <value>, a JSON literal or else a plain string\n";
+            os << "  --where <path><op><n>   Also require the number at <path> to compare with <n> (<, <=, >, >=)\n";
+            os << "  --and, --or, --not  Combine --where conditions (NOT binds tightest, then AND, then OR; default AND)\n";
+            os << "  --threads <n>       Number of worker threads (default: 1)\n";
+            os << "  --ordered           With --threads > 1, print matches in input order\n";
+            os << "  --engine <engine>   line (default): parse each line; stream: batch lines through document streams\n";
+            os << "  --io <backend>      mmap (default): parse the mapped file; pread, io_uring: stream it through read buffers\n";
+            os << "  --max-rss <size>    Keep about <size> bytes (K/M/G suffixes) of the file in memory, releasing what was read\n";
+            os << "  --select <path>,... Print the values at these paths of each match instead of the line\n";
+            os << "  --format <format>   With --select: json (default, one object per line) or tsv\n";
+            os << "  --with-filename     Prefix each printed line (and, with --count, each file's count) with <file>:\n";
+            os << "  --group-by <path>   With --count: count matches per value at <path>, most frequent first\n";
+            os << "  --distinct <path>   Print the approximate number of distinct values at <path> among the matches\n";
+            os << "  --count             Print the number of matching lines instead of the lines\n";
+            os << "  --quiet             Print nothing; exit code 0 if a line matches, 4 otherwise\n";
+            os << "  --max-count <n>     Stop after <n> matching lines\n";
             os << "  --strict            Malformed/oversized line => exit code 3\n";
             os << "  --help              Show this help\n";
         }
@@ -139,7 +186,58 @@ namespace jlq
             return std::nullopt;
         }
 
-        [[nodiscard]] std::optional<std::size_t> parseThreads(std::string_view s) noexcept
+        [[nodiscard]] std::optional<ParseEngine> parseEngine(std::string_view s) noexcept
+        {
+            if (s == "line")
+            {
+                return ParseEngine::Line;
+            }
+            if (s == "stream")
+            {
+                return ParseEngine::Stream;
+            }
+            return std::nullopt;
+        }
+
+        [[nodiscard]] std::optional<ProjectionFormat> parseProjectionFormat(std::string_view s) noexcept
+        {
+            if (s == "json")
+            {
+                return ProjectionFormat::Json;
+            }
+            if (s == "tsv")
+            {
+                return ProjectionFormat::Tsv;
+            }
+            return std::nullopt;
+        }
+
+        // Parses a --select list: comma-separated dot paths, none empty.
+        [[nodiscard]] std::optional<Projection> parseSelect(std::string_view s)
+        {
+            Projection projection;
+            for (;;)
+            {
+                const std::size_t comma = s.find(',');
+                const std::string_view name = s.substr(0, comma);
+                try
+                {
+                    projection.paths.push_back(parseDotPath(name));
+                }
+                catch (const std::exception &)
+                {
+                    return std::nullopt;
+                }
+                projection.names.push_back(name);
+                if (comma == std::string_view::npos)
+                {
+                    return projection;
+                }
+                s.remove_prefix(comma + 1);
+            }
+        }
+
+        [[nodiscard]] std::optional<std::size_t> parseUnsigned(std::string_view s) noexcept
         {
             std::size_t value = 0;
             const auto *begin = s.data();
@@ -149,7 +247,42 @@ namespace jlq
             {
                 return std::nullopt;
             }
-            if (value < 1)
+            return value;
+        }
+
+        // A byte count with an optional binary K, M or G suffix (e.g. 512M).
+        [[nodiscard]] std::optional<std::size_t> parseByteSize(std::string_view s) noexcept
+        {
+            std::size_t shift = 0;
+            if (!s.empty())
+            {
+                switch (s.back())
+                {
+                case 'K':
+                    shift = 10;
+                    break;
+                case 'M':
+                    shift = 20;
+                    break;
+                case 'G':
+                    shift = 30;
+                    break;
+                default:
+                    break;
+                }
+            }
+            const auto value = parseUnsigned(shift == 0 ? s : s.substr(0, s.size() - 1));
+            if (!value.has_value() || *value == 0 || *value > (std::numeric_limits<std::size_t>::max() >> shift))
+            {
+                return std::nullopt;
+            }
+            return *value << shift;
+        }
+
+        [[nodiscard]] std::optional<std::size_t> parseThreads(std::string_view s) noexcept
+        {
+            const auto value = parseUnsigned(s);
+            if (!value.has_value() || *value < 1)
             {
                 return std::nullopt;
             }
@@ -180,9 +313,338 @@ namespace jlq
             return value;
         }
 
+        // Classifies a number literal: an integer that fits int64 or uint64 is
+        // returned exactly; decimals, exponents and larger integers are not.
+        [[nodiscard]] std::optional<IntegerValue> parseInteger(std::string_view s) noexcept
+        {
+            if (!isValidJsonNumber(s) || s.find_first_of(".eE") != std::string_view::npos)
+            {
+                return std::nullopt;
+            }
+            IntegerValue integer;
+            const char *end = s.data() + s.size();
+            if (const auto r = std::from_chars(s.data(), end, integer.int64); r.ec == std::errc{} && r.ptr == end)
+            {
+                return integer;
+            }
+            if (const auto r = std::from_chars(s.data(), end, integer.uint64); r.ec == std::errc{} && r.ptr == end)
+            {
+                integer.is_unsigned = true;
+                return integer;
+            }
+            return std::nullopt;
+        }
+
+        // Parses a range end (--gt and the like, or a --where comparison).
+        // An integer literal that fits 64 bits is kept exactly next to its
+        // nearest double.
+        [[nodiscard]] std::optional<NumberRange::Bound> parseBound(std::string_view s, bool inclusive)
+        {
+            const auto number = parseNumber(s);
+            if (!number.has_value())
+            {
+                return std::nullopt;
+            }
+            return NumberRange::Bound{*number, inclusive, parseInteger(s)};
+        }
+
+        // Parses a value given without --type: a JSON literal when it is one
+        // (number, true, false, null or a quoted string) and a plain string
+        // otherwise. A quoted string is unescaped into `parser`, valid until the
+        // parser's next use; a plain string views `literal`.
+        [[nodiscard]] std::optional<QueryValue> parseLiteral(std::string_view literal, simdjson::ondemand::parser &parser)
+        {
+            if (literal == "null")
+            {
+                return std::monostate{};
+            }
+            if (literal == "true" || literal == "false")
+            {
+                return (literal == "true");
+            }
+            if (isValidJsonNumber(literal))
+            {
+                const auto number = parseNumber(literal);
+                if (!number.has_value())
+                {
+                    return std::nullopt;
+                }
+                return *number;
+            }
+            if (literal.size() >= 2 && literal.front() == '"' && literal.back() == '"')
+            {
+                const simdjson::padded_string json(literal);
+                simdjson::ondemand::document doc;
+                std::string_view unescaped;
+                if (parser.iterate(json).get(doc) || doc.get_string().get(unescaped) || !doc.at_end())
+                {
+                    return std::nullopt;
+                }
+                return unescaped;
+            }
+            return literal;
+        }
+
+        // Parses `text` as a value of type `type`, as --value does.
+        [[nodiscard]] std::optional<QueryValue> parseTypedValue(ValueType type, std::string_view text)
+        {
+            switch (type)
+            {
+            case ValueType::String:
+                return text;
+            case ValueType::Number:
+                if (const auto number = parseNumber(text))
+                {
+                    return *number;
+                }
+                return std::nullopt;
+            case ValueType::Bool:
+                if (text != "true" && text != "false")
+                {
+                    return std::nullopt;
+                }
+                return (text == "true");
+            case ValueType::Null:
+                return std::monostate{};
+            }
+            return std::nullopt;
+        }
+
+        // Adds one value per non-empty line of the file at `path` to `values`,
+        // parsed as `type` or, without one, by parseLiteral(). Throws
+        // std::invalid_argument naming the first line that does not parse.
+        void loadValues(const std::string &path, std::optional<ValueType> type, ValueSet &values)
+        {
+            const MappedFile mf = MappedFile::openReadonly(path);
+            simdjson::ondemand::parser parser;
+            LineScanner scanner(mf.bytes());
+            ScannedLine line;
+            while (scanner.next(line))
+            {
+                const std::string_view text(reinterpret_cast<const char *>(line.json.data()), line.json.size());
+                const auto value = type.has_value() ? parseTypedValue(*type, text) : parseLiteral(text, parser);
+                if (!value.has_value())
+                {
+                    const auto number = 1 + std::count(mf.bytes().data(), line.raw.data(), std::byte{'\n'});
+                    throw std::invalid_argument(path + ":" + std::to_string(number) + ": invalid value");
+                }
+                values.insert(*value, std::holds_alternative<double>(*value) ? parseInteger(text) : std::nullopt);
+            }
+        }
+
+        // Parses a `--where` operand, `path=value` or a comparison `path<n`,
+        // `path<=n`, `path>n`, `path>=n`. An equality value is read by
+        // parseLiteral(), with unescaped strings stored in `strings`.
+        [[nodiscard]] std::optional<Predicate> parseWhere(std::string_view s, std::deque<std::string> &strings)
+        {
+            const std::size_t op = s.find_first_of("=<>");
+            if (op == std::string_view::npos)
+            {
+                return std::nullopt;
+            }
+
+            Predicate predicate;
+            try
+            {
+                predicate.path_segments = parseDotPath(s.substr(0, op));
+            }
+            catch (const std::exception &)
+            {
+                return std::nullopt;
+            }
+
+            if (s[op] != '=')
+            {
+                const bool inclusive = (op + 1 < s.size() && s[op + 1] == '=');
+                const auto bound = parseBound(s.substr(op + (inclusive ? 2 : 1)), inclusive);
+                if (!bound.has_value())
+                {
+                    return std::nullopt;
+                }
+                predicate.range = (s[op] == '>') ? NumberRange::make(bound, std::nullopt)
+                                                 : NumberRange::make(std::nullopt, bound);
+                return predicate;
+            }
+
+            simdjson::ondemand::parser parser;
+            const auto value = parseLiteral(s.substr(op + 1), parser);
+            if (!value.has_value())
+            {
+                return std::nullopt;
+            }
+            predicate.value = *value;
+            if (const auto *unescaped = std::get_if<std::string_view>(&*value))
+            {
+                predicate.value = std::string_view(strings.emplace_back(*unescaped));
+            }
+            else if (std::holds_alternative<double>(*value))
+            {
+                predicate.integer_value = parseInteger(s.substr(op + 1));
+            }
+            return predicate;
+        }
+
+        // Compiles `--where`/`--and`/`--or`/`--not` arguments into a Filter program.
+        // Precedence is NOT > AND > OR; adjacent conditions without an operator
+        // are ANDed.
+        class FilterParser
+        {
+        public:
+            FilterParser(std::span<const std::string_view> args, std::deque<std::string> &strings) noexcept
+                : args_{args}, strings_{strings} {}
+
+            [[nodiscard]] std::optional<Filter> parse()
+            {
+                if (!parseOr() || pos_ != args_.size())
+                {
+                    return std::nullopt;
+                }
+                return std::move(filter_);
+            }
+
+        private:
+            [[nodiscard]] bool parseOr()
+            {
+                if (!parseAnd())
+                {
+                    return false;
+                }
+                while (pos_ < args_.size() && args_[pos_] == "--or")
+                {
+                    ++pos_;
+                    if (!parseAnd())
+                    {
+                        return false;
+                    }
+                    filter_.program.push_back(FilterOp{FilterOp::Kind::Or, 0});
+                }
+                return true;
+            }
+
+            [[nodiscard]] bool parseAnd()
+            {
+                if (!parseNot())
+                {
+                    return false;
+                }
+                while (pos_ < args_.size() && args_[pos_] != "--or")
+                {
+                    if (args_[pos_] == "--and")
+                    {
+                        ++pos_;
+                    }
+                    if (!parseNot())
+                    {
+                        return false;
+                    }
+                    filter_.program.push_back(FilterOp{FilterOp::Kind::And, 0});
+                }
+                return true;
+            }
+
+            [[nodiscard]] bool parseNot()
+            {
+                if (pos_ < args_.size() && args_[pos_] == "--not")
+                {
+                    ++pos_;
+                    if (!parseNot())
+                    {
+                        return false;
+                    }
+                    filter_.program.push_back(FilterOp{FilterOp::Kind::Not, 0});
+                    return true;
+                }
+                if (pos_ + 1 >= args_.size() || args_[pos_] != "--where")
+                {
+                    return false;
+                }
+                auto predicate = parseWhere(args_[pos_ + 1], strings_);
+                if (!predicate.has_value())
+                {
+                    return false;
+                }
+                pos_ += 2;
+                filter_.predicates.push_back(std::move(*predicate));
+                filter_.program.push_back(FilterOp{FilterOp::Kind::Predicate, filter_.predicates.size() - 1});
+                return true;
+            }
+
+            std::span<const std::string_view> args_;
+            std::deque<std::string> &strings_;
+            std::size_t pos_{0};
+            Filter filter_;
+        };
+
+        int runIndex(std::span<const std::string_view> args, std::ostream &err)
+        {
+            // jlq index <file> [--path <path> | --zones <path>...]
+            const bool with_path = (args.size() == 5 && args[3] == "--path");
+            std::vector<std::string_view> zone_paths;
+            for (std::size_t i = 3; !with_path && i + 1 < args.size() && args[i] == "--zones"; i += 2)
+            {
+                zone_paths.push_back(args[i + 1]);
+            }
+            if ((args.size() != 3 && !with_path && args.size() != 3 + 2 * zone_paths.size()) || args[2].empty() ||
+                args[2].starts_with('-'))
+            {
+                printUsage(err);
+                return static_cast<int>(ExitCode::UsageError);
+            }
+
+            std::vector<PathSegment> segments;
+            try
+            {
+                if (with_path)
+                {
+                    segments = parseDotPath(args[4]);
+                }
+                for (const std::string_view zone_path : zone_paths)
+                {
+                    static_cast<void>(parseDotPath(zone_path));
+                }
+            }
+            catch (const std::exception &)
+            {
+                printUsage(err);
+                return static_cast<int>(ExitCode::UsageError);
+            }
+
+            try
+            {
+                const std::string file(args[2]);
+                const MappedFile mf = MappedFile::openReadonly(file);
+                // Sidecars address lines by their offset in the file itself.
+                if (detectCompression(mf.bytes()) != Compression::None)
+                {
+                    err << "jlq: " << file << ": compressed input cannot be indexed\n";
+                    return static_cast<int>(ExitCode::UsageError);
+                }
+                if (with_path)
+                {
+                    ValueIndex::write(valueIndexPath(file, args[4]), mf.bytes(), stampOf(mf.fd()), args[4], segments);
+                }
+                else if (!zone_paths.empty())
+                {
+                    ZoneMap::write(zoneMapPath(file), mf.bytes(), stampOf(mf.fd()), zone_paths);
+                }
+                else
+                {
+                    LineIndex::write(lineIndexPath(file), mf.bytes(), stampOf(mf.fd()));
+                }
+            }
+            catch (const std::exception &e)
+            {
+                err << "jlq: " << e.what() << "\n";
+                return static_cast<int>(ExitCode::OsError);
+            }
+            return static_cast<int>(ExitCode::Success);
+        }
+
     } // namespace
 
-    int run(std::span<const std::string_view> args, std::ostream &out, std::ostream &err)
+    // Matches go to `out_fd` when it is not -1 (the real stdout), otherwise
+    // through `out`. Usage text always goes through the streams.
+    int run(std::span<const std::string_view> args, std::ostream &out, std::ostream &err, int out_fd)
     {
         // args includes argv[0]
         if (args.size() <= 1)
@@ -200,11 +662,30 @@ namespace jlq
             }
         }
 
-        const std::string_view file = args[1];
-        if (file.empty() || file.starts_with('-'))
+        if (args[1] == "index")
         {
-            printUsage(err);
-            return static_cast<int>(ExitCode::UsageError);
+            return runIndex(args, err);
+        }
+
+        // Inputs come before the options. `-`, or options with no file
+        // before them, read stdin; `-` cannot be combined with files.
+        std::size_t first_option = 1;
+        while (first_option < args.size() && !args[first_option].starts_with("--"))
+        {
+            ++first_option;
+        }
+        const std::span<const std::string_view> inputs = (first_option == 1)
+                                                             ? std::span<const std::string_view>{}
+                                                             : args.subspan(1, first_option - 1);
+        const std::string_view file = inputs.empty() ? std::string_view{"-"} : inputs.front();
+        const bool from_stdin = (file == "-");
+        for (const std::string_view input : inputs)
+        {
+            if (input.empty() || (input.starts_with('-') && (input != "-" || inputs.size() > 1)))
+            {
+                printUsage(err);
+                return static_cast<int>(ExitCode::UsageError);
+            }
         }
 
         QueryConfig config;
@@ -213,15 +694,45 @@ namespace jlq
         std::optional<std::string_view> value;
         std::optional<std::string_view> type;
         std::optional<std::string_view> threads;
+        std::optional<std::string_view> engine;
+        std::optional<std::string_view> io;
+        std::optional<std::string_view> max_rss;
+        std::optional<std::string_view> max_count;
+        std::optional<std::string_view> values_from;
+        std::optional<std::string_view> select;
+        std::optional<std::string_view> group_by;
+        std::optional<std::string_view> distinct;
+        std::optional<std::string_view> format;
+        // --gt/--ge/--lt/--le/--between operands.
+        std::optional<std::pair<std::string_view, bool>> low;
+        std::optional<std::pair<std::string_view, bool>> high;
 
         bool strict_seen = false;
+        bool ordered_seen = false;
+        bool with_filename_seen = false;
         bool path_seen = false;
         bool value_seen = false;
         bool type_seen = false;
         bool threads_seen = false;
+        bool engine_seen = false;
+        bool io_seen = false;
+        bool max_rss_seen = false;
+        bool count_seen = false;
+        bool quiet_seen = false;
+        bool max_count_seen = false;
+        bool values_from_seen = false;
+        bool select_seen = false;
+        bool group_by_seen = false;
+        bool distinct_seen = false;
+        bool format_seen = false;
+
+        // --where/--and/--or/--not in command-line order, and the unescaped
+        // strings their values point into.
+        std::vector<std::string_view> filter_args;
+        std::deque<std::string> filter_strings;
 
         // Strict option parsing: only allow documented flags.
-        for (std::size_t i = 2; i < args.size(); ++i)
+        for (std::size_t i = first_option; i < args.size(); ++i)
         {
             const std::string_view a = args[i];
             if (a == "--strict")
@@ -236,7 +747,86 @@ namespace jlq
                 continue;
             }
 
-            if (a == "--path" || a == "--value" || a == "--type" || a == "--threads")
+            if (a == "--ordered")
+            {
+                if (ordered_seen)
+                {
+                    printUsage(err);
+                    return static_cast<int>(ExitCode::UsageError);
+                }
+                ordered_seen = true;
+                config.ordered = true;
+                continue;
+            }
+
+            if (a == "--with-filename")
+            {
+                if (with_filename_seen)
+                {
+                    printUsage(err);
+                    return static_cast<int>(ExitCode::UsageError);
+                }
+                with_filename_seen = true;
+                continue;
+            }
+
+            if (a == "--count" || a == "--quiet")
+            {
+                // Mutually exclusive output modes.
+                if (count_seen || quiet_seen)
+                {
+                    printUsage(err);
+                    return static_cast<int>(ExitCode::UsageError);
+                }
+                (a == "--count" ? count_seen : quiet_seen) = true;
+                config.output = (a == "--count") ? OutputMode::Count : OutputMode::Quiet;
+                continue;
+            }
+
+            if (a == "--and" || a == "--or" || a == "--not")
+            {
+                filter_args.push_back(a);
+                continue;
+            }
+
+            if (a == "--where")
+            {
+                if (i + 1 >= args.size())
+                {
+                    printUsage(err);
+                    return static_cast<int>(ExitCode::UsageError);
+                }
+                filter_args.push_back(a);
+                filter_args.push_back(args[++i]);
+                continue;
+            }
+
+            if (a == "--gt" || a == "--ge" || a == "--lt" || a == "--le" || a == "--between")
+            {
+                // At most one lower and one upper bound.
+                const bool sets_low = (a != "--lt" && a != "--le");
+                const bool sets_high = (a != "--gt" && a != "--ge");
+                const std::size_t operands = (a == "--between") ? 2 : 1;
+                if (i + operands >= args.size() || (sets_low && low.has_value()) || (sets_high && high.has_value()))
+                {
+                    printUsage(err);
+                    return static_cast<int>(ExitCode::UsageError);
+                }
+                if (sets_low)
+                {
+                    low.emplace(args[i + 1], a != "--gt");
+                }
+                if (sets_high)
+                {
+                    high.emplace(args[i + operands], a != "--lt");
+                }
+                i += operands;
+                continue;
+            }
+
+            if (a == "--path" || a == "--value" || a == "--type" || a == "--threads" || a == "--engine" ||
+                a == "--io" || a == "--max-rss" || a == "--max-count" || a == "--values-from" || a == "--select" ||
+                a == "--format" || a == "--group-by" || a == "--distinct")
             {
                 if (i + 1 >= args.size())
                 {
@@ -286,6 +876,96 @@ namespace jlq
                     threads_seen = true;
                     threads = v;
                 }
+                else if (a == "--engine")
+                {
+                    if (engine_seen)
+                    {
+                        printUsage(err);
+                        return static_cast<int>(ExitCode::UsageError);
+                    }
+                    engine_seen = true;
+                    engine = v;
+                }
+                else if (a == "--io")
+                {
+                    if (io_seen)
+                    {
+                        printUsage(err);
+                        return static_cast<int>(ExitCode::UsageError);
+                    }
+                    io_seen = true;
+                    io = v;
+                }
+                else if (a == "--max-rss")
+                {
+                    if (max_rss_seen)
+                    {
+                        printUsage(err);
+                        return static_cast<int>(ExitCode::UsageError);
+                    }
+                    max_rss_seen = true;
+                    max_rss = v;
+                }
+                else if (a == "--max-count")
+                {
+                    if (max_count_seen)
+                    {
+                        printUsage(err);
+                        return static_cast<int>(ExitCode::UsageError);
+                    }
+                    max_count_seen = true;
+                    max_count = v;
+                }
+                else if (a == "--values-from")
+                {
+                    if (values_from_seen)
+                    {
+                        printUsage(err);
+                        return static_cast<int>(ExitCode::UsageError);
+                    }
+                    values_from_seen = true;
+                    values_from = v;
+                }
+                else if (a == "--select")
+                {
+                    if (select_seen)
+                    {
+                        printUsage(err);
+                        return static_cast<int>(ExitCode::UsageError);
+                    }
+                    select_seen = true;
+                    select = v;
+                }
+                else if (a == "--group-by")
+                {
+                    if (group_by_seen)
+                    {
+                        printUsage(err);
+                        return static_cast<int>(ExitCode::UsageError);
+                    }
+                    group_by_seen = true;
+                    group_by = v;
+                }
+                else if (a == "--distinct")
+                {
+                    if (distinct_seen)
+                    {
+                        printUsage(err);
+                        return static_cast<int>(ExitCode::UsageError);
+                    }
+                    distinct_seen = true;
+                    distinct = v;
+                }
+                else if (a == "--format")
+                {
+                    if (format_seen)
+                    {
+                        printUsage(err);
+                        return static_cast<int>(ExitCode::UsageError);
+                    }
+                    format_seen = true;
+                    format = v;
+                }
                 continue;
             }
 
@@ -294,7 +974,18 @@ namespace jlq
             return static_cast<int>(ExitCode::UsageError);
         }
 
-        if (!path.has_value())
+        if (!filter_args.empty())
+        {
+            config.filter = FilterParser(filter_args, filter_strings).parse();
+            if (!config.filter.has_value())
+            {
+                printUsage(err);
+                return static_cast<int>(ExitCode::UsageError);
+            }
+        }
+
+        // --path/--value may be left out only in favour of --where.
+        if (!path.has_value() && (!config.filter.has_value() || value.has_value() || type.has_value()))
         {
             printUsage(err);
             return static_cast<int>(ExitCode::UsageError);
@@ -302,7 +993,10 @@ namespace jlq
 
         try
         {
-            config.path_segments = parseDotPath(*path);
+            if (path.has_value())
+            {
+                config.path_segments = parseDotPath(*path);
+            }
         }
         catch (const std::exception &)
         {
@@ -321,71 +1015,332 @@ namespace jlq
             config.threads = *parsed;
         }
 
-        ValueType vt_choice = ValueType::String;
-        if (type.has_value())
+        if (max_count.has_value())
         {
-            const auto vt = parseValueType(*type);
-            if (!vt.has_value())
+            const auto parsed = parseUnsigned(*max_count);
+            if (!parsed.has_value())
             {
                 printUsage(err);
                 return static_cast<int>(ExitCode::UsageError);
             }
-            vt_choice = *vt;
+            config.max_count = *parsed;
         }
 
-        if (vt_choice != ValueType::Null)
+        if (engine.has_value())
         {
-            if (!value.has_value())
+            const auto parsed = parseEngine(*engine);
+            if (!parsed.has_value())
             {
                 printUsage(err);
                 return static_cast<int>(ExitCode::UsageError);
             }
+            config.engine = *parsed;
         }
 
-        switch (vt_choice)
+        // --format only shapes --select output, and --select only shapes printed
+        // lines (not --count, --quiet or --distinct).
+        if (select.has_value())
         {
-        case ValueType::String:
-            config.value = value.value_or(std::string_view{});
-            break;
-        case ValueType::Bool:
+            config.projection = parseSelect(*select);
+            const auto parsed = format.has_value() ? parseProjectionFormat(*format) : ProjectionFormat::Json;
+            if (!config.projection.has_value() || !parsed.has_value() || config.output != OutputMode::Lines ||
+                distinct.has_value())
+            {
+                printUsage(err);
+                return static_cast<int>(ExitCode::UsageError);
+            }
+            config.projection->format = *parsed;
+        }
+        else if (format.has_value())
         {
-            if (!value.has_value() || (*value != "true" && *value != "false"))
+            printUsage(err);
+            return static_cast<int>(ExitCode::UsageError);
+        }
+
+        // Groups are counted over every match, so they need --count and
+        // cannot be cut short by --max-count or split by file.
+        if (group_by.has_value())
+        {
+            if (config.output != OutputMode::Count || config.max_count.has_value() || with_filename_seen)
+            {
+                printUsage(err);
+                return static_cast<int>(ExitCode::UsageError);
+            }
+            try
+            {
+                config.group_by = parseDotPath(*group_by);
+            }
+            catch (const std::exception &)
             {
                 printUsage(err);
                 return static_cast<int>(ExitCode::UsageError);
             }
-            config.value = (*value == "true");
-            break;
         }
-        case ValueType::Null:
-            config.value = std::monostate{};
-            break;
-        case ValueType::Number:
+
+        // --distinct counts, like --count, but over every match and
+        // never split by file.
+        if (distinct.has_value())
         {
-            if (!value.has_value())
+            if (config.output == OutputMode::Quiet || config.max_count.has_value() || with_filename_seen ||
+                group_by.has_value())
             {
                 printUsage(err);
                 return static_cast<int>(ExitCode::UsageError);
             }
-            const auto parsed = parseNumber(*value);
+            config.output = OutputMode::Count;
+            try
+            {
+                config.distinct = parseDotPath(*distinct);
+            }
+            catch (const std::exception &)
+            {
+                printUsage(err);
+                return static_cast<int>(ExitCode::UsageError);
+            }
+        }
+
+        // stdin is always streamed.
+        IoBackend io_backend = IoBackend::Mmap;
+        if (io.has_value())
+        {
+            const auto parsed = parseIoBackend(*io);
+            if (!parsed.has_value() || from_stdin)
+            {
+                printUsage(err);
+                return static_cast<int>(ExitCode::UsageError);
+            }
+            io_backend = *parsed;
+        }
+
+        // Budget for the input file's resident pages (0: none).
+        std::size_t max_resident = 0;
+        if (max_rss.has_value())
+        {
+            const auto parsed = parseByteSize(*max_rss);
+            if (!parsed.has_value())
+            {
+                printUsage(err);
+                return static_cast<int>(ExitCode::UsageError);
+            }
+            max_resident = *parsed;
+        }
+
+        // A range replaces --value and compares numbers only.
+        const bool ranged = low.has_value() || high.has_value();
+        ValueType vt_choice = ranged ? ValueType::Number : ValueType::String;
+        if (type.has_value())
+        {
+            const auto vt = parseValueType(*type);
+            if (!vt.has_value())
+            {
+                printUsage(err);
+                return static_cast<int>(ExitCode::UsageError);
+            }
+            vt_choice = *vt;
+        }
+
+        if (ranged)
+        {
+            if (!path.has_value() || value.has_value() || values_from.has_value() || vt_choice != ValueType::Number)
+            {
+                printUsage(err);
+                return static_cast<int>(ExitCode::UsageError);
+            }
+            const auto low_bound = low.has_value() ? parseBound(low->first, low->second) : std::nullopt;
+            const auto high_bound = high.has_value() ? parseBound(high->first, high->second) : std::nullopt;
+            if (low_bound.has_value() != low.has_value() || high_bound.has_value() != high.has_value())
+            {
+                printUsage(err);
+                return static_cast<int>(ExitCode::UsageError);
+            }
+            config.range = NumberRange::make(low_bound, high_bound);
+        }
+        else if (values_from.has_value())
+        {
+            // The set replaces --value; --type, if given, applies to every line.
+            if (!path.has_value() || value.has_value())
+            {
+                printUsage(err);
+                return static_cast<int>(ExitCode::UsageError);
+            }
+        }
+        else if (path.has_value())
+        {
+            const auto parsed =
+                (value.has_value() || vt_choice == ValueType::Null) ? parseTypedValue(vt_choice, value.value_or(""))
+                                                                    : std::nullopt;
             if (!parsed.has_value())
             {
                 printUsage(err);
                 return static_cast<int>(ExitCode::UsageError);
             }
             config.value = *parsed;
-            break;
+            if (vt_choice == ValueType::Number)
+            {
+                config.integer_value = parseInteger(*value);
+            }
+        }
+
+        ValueSet values;
+        if (values_from.has_value())
+        {
+            try
+            {
+                loadValues(std::string(*values_from),
+                           type.has_value() ? std::optional{vt_choice} : std::nullopt, values);
+            }
+            catch (const std::invalid_argument &e)
+            {
+                err << "jlq: " << e.what() << "\n";
+                return static_cast<int>(ExitCode::UsageError);
+            }
+            catch (const std::exception &e)
+            {
+                err << "jlq: " << e.what() << "\n";
+                return static_cast<int>(ExitCode::OsError);
+            }
+            config.values = &values;
+        }
+
+        // Directories and patterns expand to the files they name. More than
+        // one file (or --with-filename) goes through the file scheduler,
+        // which always maps its inputs.
+        std::vector<std::string> paths;
+        try
+        {
+            if (!from_stdin)
+            {
+                paths = expandInputPaths(inputs);
+            }
+        }
+        catch (const std::exception &e)
+        {
+            err << "jlq: " << e.what() << "\n";
+            return static_cast<int>(ExitCode::OsError);
         }
+        const bool file_set = !from_stdin && (with_filename_seen || paths.size() != 1 || paths.front() != file);
+        if ((file_set && io_backend != IoBackend::Mmap) || (from_stdin && with_filename_seen))
+        {
+            printUsage(err);
+            return static_cast<int>(ExitCode::UsageError);
         }
 
         try
         {
-            MappedFile mf = MappedFile::openReadonly(std::string(file));
-            const QueryStatus status = runQuery(mf.bytes(), config, out);
+            // stdin is read as a stream, like decompressed input; a file is
+            // mapped so its indexes and zero-copy output apply.
+            std::optional<MappedFile> mf;
+            Compression compression = Compression::None;
+            if (!from_stdin && !file_set)
+            {
+                mf = MappedFile::openReadonly(std::string(file), requiredInputPadding());
+                compression = detectCompression(mf->bytes());
+            }
+            std::unique_ptr<OutputSink> sink;
+            if (out_fd == -1)
+            {
+                sink = std::make_unique<StreamSink>(out);
+            }
+            else
+            {
+                // Streamed matches are not in a file, so cannot be copied
+                // from it by the kernel.
+                out.flush();
+                sink = std::make_unique<FdSink>(out_fd, mf.has_value() && compression == Compression::None
+                                                            ? ZeroCopySource{mf->fd(), mf->bytes()}
+                                                            : ZeroCopySource{});
+            }
+
+            QueryStats stats;
+            QueryStatus status = QueryStatus::Ok;
+            if (file_set)
+            {
+                const FileSetOptions options{with_filename_seen, path.value_or(std::string_view{}), max_resident != 0};
+                status = runFiles(paths, config, options, *sink, stats);
+            }
+            else if (from_stdin)
+            {
+                FdSource source(STDIN_FILENO);
+                WindowReader reader(source, requiredInputPadding());
+                status = runQuery(reader, config, *sink, stats);
+            }
+            else if (compression != Compression::None)
+            {
+                Decompressor decompressor(mf->bytes(), compression);
+                WindowReader reader(decompressor, requiredInputPadding());
+                status = runQuery(reader, config, *sink, stats);
+            }
+            else
+            {
+                // Missing or stale indexes are ignored.
+                const FileStamp stamp = stampOf(mf->fd());
+                const std::optional<LineIndex> line_index = LineIndex::open(lineIndexPath(file), stamp);
+                const std::optional<ValueIndex> value_index =
+                    path.has_value() ? ValueIndex::open(valueIndexPath(file, *path), stamp, *path) : std::nullopt;
+                const std::optional<ZoneMap> zone_map = ZoneMap::open(zoneMapPath(file), stamp);
+                // A value index or zone map reads only parts of the mapping,
+                // so it takes precedence over streaming the whole file.
+                if (io_backend != IoBackend::Mmap && !value_index.has_value() && !zone_map.has_value())
+                {
+                    std::unique_ptr<ByteSource> source;
+                    if (io_backend == IoBackend::Pread)
+                    {
+                        source = std::make_unique<PreadSource>(mf->fd(), max_resident != 0);
+                    }
+                    else
+                    {
+                        source = std::make_unique<IoUringSource>(mf->fd(), max_resident != 0);
+                    }
+                    WindowReader reader(*source, requiredInputPadding());
+                    status = runQuery(reader, config, *sink, stats);
+                }
+                else
+                {
+                    if (!value_index.has_value())
+                    {
+                        mf->adviseSequential();
+                    }
+                    const QueryInput input{mf->bytes(),
+                                           mf->padding(),
+                                           line_index ? &*line_index : nullptr,
+                                           value_index ? &*value_index : nullptr,
+                                           zone_map ? &*zone_map : nullptr,
+                                           &*mf,
+                                           max_resident};
+                    status = runQuery(input, config, *sink, stats);
+                }
+            }
             if (status == QueryStatus::ParseError)
             {
                 return static_cast<int>(ExitCode::ParseError);
             }
+            if (config.group_by.has_value())
+            {
+                std::string text;
+                for (const auto &[value, count] : stats.groups.sorted())
+                {
+                    text += std::to_string(count);
+                    text.push_back('\t');
+                    text += value;
+                    text.push_back('\n');
+                }
+                sink->write(std::as_bytes(std::span(text)));
+            }
+            else if (config.distinct.has_value())
+            {
+                const std::string text = std::to_string(stats.distinct.estimate()) + "\n";
+                sink->write(std::as_bytes(std::span(text)));
+            }
+            // runFiles() already wrote the per-file counts.
+            else if (config.output == OutputMode::Count && !(file_set && with_filename_seen))
+            {
+                const std::string text = std::to_string(stats.matches) + "\n";
+                sink->write(std::as_bytes(std::span(text)));
+            }
+            if (config.output == OutputMode::Quiet && stats.matches == 0)
+            {
+                return static_cast<int>(ExitCode::NoMatch);
+            }
         }
         catch (const std::exception &e)
         {
@@ -396,9 +1351,14 @@ namespace jlq
         return static_cast<int>(ExitCode::Success);
     }
 
+    int run(std::span<const std::string_view> args, std::ostream &out, std::ostream &err)
+    {
+        return run(args, out, err, -1);
+    }
+
     int run(std::span<const std::string_view> args)
     {
-        return run(args, std::cout, std::cerr);
+        return run(args, std::cout, std::cerr, STDOUT_FILENO);
     }
 
 } // namespace jlq
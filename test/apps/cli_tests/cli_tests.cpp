@@ -1,11 +1,15 @@
 #include "TempFile.hpp"
 #include "test_harness.hpp"
 #include "jlq/cli.hpp"
+#include <filesystem>
+#include <fstream>
 #include <sstream>
 #include <string>
 #include <string_view>
 #include <vector>
 
+#include <unistd.h>
+
 namespace
 {
     struct RunResult
@@ -154,3 +158,511 @@ JLQ_TEST_CASE("CLI preserves final-line newline behavior")
     JLQ_CHECK_EQ(r.rc, 0);
     JLQ_CHECK_EQ(r.out, std::string("{\"a\":{\"b\":\"x\"}}"));
 }
+
+JLQ_TEST_CASE("CLI validates --engine")
+{
+    jlq::test::TempFile tmp("jlq_cli_test_", ".jsonl");
+    tmp.writeAll("{\"a\":{\"b\":\"x\"}}\n{\"a\":{\"b\":\"y\"}}\n{\"a\":{\"b\":\"x\"}}");
+
+    const auto bad = runArgs({"jlq", tmp.path().string(), "--path", "a.b", "--value", "x", "--engine", "fast"});
+    JLQ_CHECK_EQ(bad.rc, 1);
+
+    const auto ok = runArgs({"jlq", tmp.path().string(), "--path", "a.b", "--value", "x", "--engine", "stream"});
+    JLQ_CHECK_EQ(ok.rc, 0);
+    JLQ_CHECK_EQ(ok.out, std::string("{\"a\":{\"b\":\"x\"}}\n{\"a\":{\"b\":\"x\"}}"));
+}
+
+JLQ_TEST_CASE("CLI --count, --quiet and --max-count")
+{
+    jlq::test::TempFile tmp("jlq_cli_test_", ".jsonl");
+    tmp.writeAll("{\"a\":\"x\"}\n{\"a\":\"y\"}\n{\"a\":\"x\"}\n");
+    const std::string file = tmp.path().string();
+
+    const auto count = runArgs({"jlq", file, "--path", "a", "--value", "x", "--count"});
+    JLQ_CHECK_EQ(count.rc, 0);
+    JLQ_CHECK_EQ(count.out, std::string("2\n"));
+
+    const auto capped = runArgs({"jlq", file, "--path", "a", "--value", "x", "--count", "--max-count", "1"});
+    JLQ_CHECK_EQ(capped.out, std::string("1\n"));
+
+    const auto first = runArgs({"jlq", file, "--path", "a", "--value", "x", "--max-count", "1"});
+    JLQ_CHECK_EQ(first.rc, 0);
+    JLQ_CHECK_EQ(first.out, std::string("{\"a\":\"x\"}\n"));
+
+    const auto found = runArgs({"jlq", file, "--path", "a", "--value", "y", "--quiet"});
+    JLQ_CHECK_EQ(found.rc, 0);
+    JLQ_CHECK(found.out.empty());
+
+    const auto missing = runArgs({"jlq", file, "--path", "a", "--value", "z", "--quiet"});
+    JLQ_CHECK_EQ(missing.rc, 4);
+    JLQ_CHECK(missing.out.empty());
+
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "a", "--value", "x", "--count", "--quiet"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "a", "--value", "x", "--max-count", "-1"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "a", "--value", "x", "--max-count"}).rc, 1);
+}
+
+JLQ_TEST_CASE("CLI index writes a sidecar that queries use until the file changes")
+{
+    jlq::test::TempFile tmp("jlq_cli_test_", ".jsonl");
+    tmp.writeAll("{\"a\":\"x\"}\n\n{\"a\":\"y\"}\r\n{\"a\":\"x\"}");
+    const std::string file = tmp.path().string();
+    const std::string sidecar = file + ".jlqidx";
+
+    JLQ_CHECK_EQ(runArgs({"jlq", "index"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", "index", "/definitely/does/not/exist.jsonl"}).rc, 2);
+
+    const auto indexed = runArgs({"jlq", "index", file});
+    JLQ_CHECK_EQ(indexed.rc, 0);
+    JLQ_CHECK(std::filesystem::exists(sidecar));
+
+    const auto r = runArgs({"jlq", file, "--path", "a", "--value", "x"});
+    JLQ_CHECK_EQ(r.rc, 0);
+    JLQ_CHECK_EQ(r.out, std::string("{\"a\":\"x\"}\n{\"a\":\"x\"}"));
+
+    // A rewritten file makes the sidecar stale; it must be ignored.
+    tmp.writeAll("{\"a\":\"x\"}\n{\"a\":\"z\"}\n");
+    const auto stale = runArgs({"jlq", file, "--path", "a", "--value", "x"});
+    JLQ_CHECK_EQ(stale.rc, 0);
+    JLQ_CHECK_EQ(stale.out, std::string("{\"a\":\"x\"}\n"));
+
+    std::filesystem::remove(sidecar);
+}
+
+JLQ_TEST_CASE("CLI index --path answers lookups on that path")
+{
+    jlq::test::TempFile tmp("jlq_cli_test_", ".jsonl");
+    tmp.writeAll("{\"user\":{\"id\":7}}\n{\"user\":{\"id\":8}}\n{\"user\":{\"id\":7.0}}\n");
+    const std::string file = tmp.path().string();
+
+    JLQ_CHECK_EQ(runArgs({"jlq", "index", file, "--path"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", "index", file, "--path", "user..id"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", "index", file, "--path", "user.id"}).rc, 0);
+    JLQ_CHECK(std::filesystem::exists(file + ".user.id.jlqval"));
+
+    const auto r = runArgs({"jlq", file, "--path", "user.id", "--type", "number", "--value", "7"});
+    JLQ_CHECK_EQ(r.rc, 0);
+    JLQ_CHECK_EQ(r.out, std::string("{\"user\":{\"id\":7}}\n{\"user\":{\"id\":7.0}}\n"));
+
+    const auto count = runArgs({"jlq", file, "--path", "user.id", "--type", "number", "--value", "8", "--count"});
+    JLQ_CHECK_EQ(count.out, std::string("1\n"));
+
+    std::filesystem::remove(file + ".user.id.jlqval");
+}
+
+JLQ_TEST_CASE("CLI index --zones writes a zone map used by queries")
+{
+    jlq::test::TempFile tmp("jlq_cli_test_", ".jsonl");
+    tmp.writeAll("{\"a\":\"x\",\"n\":1}\n{\"a\":\"y\",\"n\":2}\n{\"a\":\"x\",\"n\":3}\n");
+    const std::string file = tmp.path().string();
+
+    JLQ_CHECK_EQ(runArgs({"jlq", "index", file, "--zones"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", "index", file, "--zones", "a", "--path", "n"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", "index", file, "--zones", "a", "--zones", ".n"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", "index", file, "--zones", "a", "--zones", "n"}).rc, 0);
+    JLQ_CHECK(std::filesystem::exists(file + ".jlqzone"));
+
+    const auto r = runArgs({"jlq", file, "--path", "a", "--value", "x"});
+    JLQ_CHECK_EQ(r.rc, 0);
+    JLQ_CHECK_EQ(r.out, std::string("{\"a\":\"x\",\"n\":1}\n{\"a\":\"x\",\"n\":3}\n"));
+
+    const auto count = runArgs({"jlq", file, "--path", "n", "--type", "number", "--value", "9", "--count"});
+    JLQ_CHECK_EQ(count.out, std::string("0\n"));
+
+    std::filesystem::remove(file + ".jlqzone");
+}
+
+JLQ_TEST_CASE("CLI --where combines conditions with --and, --or and --not")
+{
+    jlq::test::TempFile tmp("jlq_cli_test_", ".jsonl");
+    tmp.writeAll("{\"s\":500,\"svc\":\"api\",\"r\":\"eu\"}\n"
+                 "{\"s\":\"500\",\"svc\":\"api\",\"r\":\"us\"}\n"
+                 "{\"s\":500,\"svc\":\"web\",\"r\":\"us\"}\n");
+    const std::string file = tmp.path().string();
+
+    const auto both = runArgs({"jlq", file, "--where", "s=500", "--where", "svc=api"});
+    JLQ_CHECK_EQ(both.rc, 0);
+    JLQ_CHECK_EQ(both.out, std::string("{\"s\":500,\"svc\":\"api\",\"r\":\"eu\"}\n"));
+
+    const auto quoted = runArgs({"jlq", file, "--where", "s=\"500\"", "--count"});
+    JLQ_CHECK_EQ(quoted.out, std::string("1\n"));
+
+    // NOT binds tighter than AND, which binds tighter than OR.
+    const auto mixed = runArgs(
+        {"jlq", file, "--where", "svc=web", "--or", "--not", "--where", "r=us", "--and", "--where", "s=500", "--count"});
+    JLQ_CHECK_EQ(mixed.out, std::string("2\n"));
+
+    const auto with_path = runArgs({"jlq", file, "--path", "r", "--value", "us", "--where", "s=500"});
+    JLQ_CHECK_EQ(with_path.out, std::string("{\"s\":500,\"svc\":\"web\",\"r\":\"us\"}\n"));
+
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--where", "s"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--where", "s=1", "--or"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--and", "--where", "s=1"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--where", "s=\"a"}).rc, 0);
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--where", "s=1", "--value", "x"}).rc, 1);
+}
+
+JLQ_TEST_CASE("CLI --type number compares integers exactly beyond 2^53")
+{
+    jlq::test::TempFile tmp("jlq_cli_test_", ".jsonl");
+    tmp.writeAll("{\"id\":9007199254740993}\n"
+                 "{\"id\":9007199254740992 }\n"
+                 "{\"id\":9007199254740992.0}\n"
+                 "{\"id\":9.007199254740992e15}\n"
+                 "{\"id\":18446744073709551615}\n"
+                 "{\"id\":18446744073709551614}\n"
+                 "{\"id\":-9223372036854775808}\n"
+                 "{\"id\":1}\n"
+                 "{\"id\":1.0}\n"
+                 "{\"id\":\"1\"}\n"
+                 "{\"id\":-0}\n"
+                 "{\"id\":0.5}\n");
+    const std::string file = tmp.path().string();
+    auto count = [&](const std::string &value)
+    {
+        return runArgs({"jlq", file, "--path", "id", "--type", "number", "--value", value, "--count"}).out;
+    };
+
+    JLQ_CHECK_EQ(count("9007199254740993"), std::string("1\n"));
+    JLQ_CHECK_EQ(count("9007199254740992"), std::string("3\n"));
+    JLQ_CHECK_EQ(count("18446744073709551615"), std::string("1\n"));
+    JLQ_CHECK_EQ(count("18446744073709551614"), std::string("1\n"));
+    JLQ_CHECK_EQ(count("-9223372036854775808"), std::string("1\n"));
+    JLQ_CHECK_EQ(count("1"), std::string("2\n"));
+    JLQ_CHECK_EQ(count("1e0"), std::string("2\n"));
+    JLQ_CHECK_EQ(count("0"), std::string("1\n"));
+    JLQ_CHECK_EQ(count("-0"), std::string("1\n"));
+    JLQ_CHECK_EQ(count("0.5"), std::string("1\n"));
+    // Beyond 64 bits the query is a double, which both uint64 values round to.
+    JLQ_CHECK_EQ(count("18446744073709551616"), std::string("2\n"));
+}
+
+JLQ_TEST_CASE("CLI integers stay exact beyond 2^53 with --where and --values-from")
+{
+    jlq::test::TempFile tmp("jlq_cli_test_", ".jsonl");
+    tmp.writeAll("{\"id\":9007199254740992,\"k\":1}\n"
+                 "{\"id\":9007199254740993,\"k\":1}\n"
+                 "{\"id\":9007199254740993.0,\"k\":1}\n"
+                 "{\"id\":18446744073709551615,\"k\":1}\n"
+                 "{\"id\":18446744073709551614,\"k\":2}\n"
+                 "{\"id\":-9007199254740992,\"k\":3}\n"
+                 "{\"id\":-9007199254740993,\"k\":3}\n");
+    const std::string file = tmp.path().string();
+
+    // --value combined with --where.
+    const std::string big = "9007199254740993";
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "id", "--type", "number", "--value", big, "--where", "k=1", "--count"}).out,
+                 std::string("1\n"));
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "id", "--type", "number", "--value", "9007199254740992", "--where", "k=1",
+                          "--count"})
+                     .out,
+                 std::string("2\n"));
+
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--where", "id=" + big, "--count"}).out, std::string("1\n"));
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--where", "id=9007199254740992", "--count"}).out, std::string("2\n"));
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--where", "id=18446744073709551615", "--count"}).out, std::string("1\n"));
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--where", "id=" + big, "--or", "--where", "k=2", "--count"}).out,
+                 std::string("2\n"));
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--where", "k=1", "--where", "id=" + big, "--threads", "2", "--engine", "stream",
+                          "--count"})
+                     .out,
+                 std::string("1\n"));
+
+    jlq::test::TempFile ids("jlq_cli_ids_", ".txt");
+    ids.writeAll(big + "\n18446744073709551614\n");
+    const std::string ids_file = ids.path().string();
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "id", "--values-from", ids_file, "--count"}).out, std::string("2\n"));
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "id", "--values-from", ids_file, "--type", "number", "--count"}).out,
+                 std::string("2\n"));
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "id", "--values-from", ids_file, "--where", "k=1", "--count"}).out,
+                 std::string("1\n"));
+
+    // 2^53 itself is exact too: 2^53 + 1 rounds to the same double.
+    jlq::test::TempFile edges("jlq_cli_ids_", ".txt");
+    edges.writeAll("9007199254740992\n-9007199254740992\n");
+    const std::string edges_file = edges.path().string();
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "id", "--values-from", edges_file, "--type", "number", "--count"}).out,
+                 std::string("3\n"));
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "id", "--values-from", edges_file, "--where", "k=3", "--count"}).out,
+                 std::string("1\n"));
+}
+
+JLQ_TEST_CASE("CLI range options and --where comparisons select numbers")
+{
+    jlq::test::TempFile tmp("jlq_cli_test_", ".jsonl");
+    tmp.writeAll("{\"n\":1}\n"
+                 "{\"n\":2.5}\n"
+                 "{\"n\":\"3\"}\n"
+                 "{\"n\":10}\n");
+    const std::string file = tmp.path().string();
+
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "n", "--gt", "1", "--count"}).out, std::string("2\n"));
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "n", "--ge", "1", "--lt", "10", "--count"}).out, std::string("2\n"));
+    const auto between = runArgs({"jlq", file, "--path", "n", "--type", "number", "--between", "2", "3"});
+    JLQ_CHECK_EQ(between.rc, 0);
+    JLQ_CHECK_EQ(between.out, std::string("{\"n\":2.5}\n"));
+
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--where", "n>=2.5", "--where", "n<10", "--count"}).out, std::string("1\n"));
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--where", "n<=1", "--or", "--where", "n>9", "--count"}).out, std::string("2\n"));
+
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--gt", "1"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "n", "--gt", "1", "--value", "2"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "n", "--gt", "1", "--type", "string"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "n", "--gt", "1", "--ge", "2"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "n", "--between", "1"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "n", "--lt", "x"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--where", "n>x"}).rc, 1);
+}
+
+JLQ_TEST_CASE("CLI range bounds written as integers are exact beyond 2^53")
+{
+    jlq::test::TempFile tmp("jlq_cli_test_", ".jsonl");
+    tmp.writeAll("{\"n\":9007199254740992}\n"
+                 "{\"n\":9007199254740993}\n"
+                 "{\"n\":9007199254740994}\n"
+                 "{\"n\":18446744073709551615}\n");
+    const std::string file = tmp.path().string();
+    auto count = [&](const std::string &op, const std::string &bound)
+    {
+        return runArgs({"jlq", file, "--path", "n", op, bound, "--count"}).out;
+    };
+
+    JLQ_CHECK_EQ(count("--ge", "9007199254740993"), std::string("3\n"));
+    JLQ_CHECK_EQ(count("--gt", "9007199254740993"), std::string("2\n"));
+    JLQ_CHECK_EQ(count("--lt", "9007199254740993"), std::string("1\n"));
+    JLQ_CHECK_EQ(count("--le", "9007199254740993"), std::string("2\n"));
+    JLQ_CHECK_EQ(count("--gt", "18446744073709551614"), std::string("1\n"));
+    const auto between = runArgs({"jlq", file, "--path", "n", "--between", "9007199254740993", "9007199254740993"});
+    JLQ_CHECK_EQ(between.out, std::string("{\"n\":9007199254740993}\n"));
+
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--where", "n>=9007199254740993", "--count"}).out, std::string("3\n"));
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--where", "n<9007199254740993", "--count"}).out, std::string("1\n"));
+    // A bound that is not written as an integer stays a double.
+    JLQ_CHECK_EQ(count("--ge", "9007199254740993.0"), std::string("4\n"));
+}
+
+JLQ_TEST_CASE("CLI --values-from matches any listed value")
+{
+    jlq::test::TempFile tmp("jlq_cli_test_", ".jsonl");
+    tmp.writeAll("{\"id\":1}\n"
+                 "{\"id\":\"1\"}\n"
+                 "{\"id\":\"u\\u0032\"}\n"
+                 "{\"id\":3}\n");
+    const std::string file = tmp.path().string();
+    jlq::test::TempFile ids("jlq_cli_ids_", ".txt");
+    ids.writeAll("1\r\n\"u2\"\n\n7\n");
+    const std::string ids_file = ids.path().string();
+
+    const auto inferred = runArgs({"jlq", file, "--path", "id", "--values-from", ids_file});
+    JLQ_CHECK_EQ(inferred.rc, 0);
+    JLQ_CHECK_EQ(inferred.out, std::string("{\"id\":1}\n{\"id\":\"u\\u0032\"}\n"));
+
+    // With --type, every line is read as that type.
+    const auto strings = runArgs({"jlq", file, "--path", "id", "--values-from", ids_file, "--type", "string"});
+    JLQ_CHECK_EQ(strings.out, std::string("{\"id\":\"1\"}\n"));
+    const auto numbers = runArgs({"jlq", file, "--path", "id", "--values-from", ids_file, "--type", "number"});
+    JLQ_CHECK_EQ(numbers.rc, 1);
+    JLQ_CHECK(numbers.err.find(":2: invalid value") != std::string::npos);
+
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--values-from", ids_file}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "id", "--values-from", ids_file, "--value", "1"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "id", "--values-from", ids_file, "--gt", "1"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "id", "--values-from", ids_file + ".missing"}).rc, 2);
+}
+
+JLQ_TEST_CASE("CLI --io backends give the mapping's matches")
+{
+    jlq::test::TempFile tmp("jlq_cli_test_", ".jsonl");
+    // Several read windows and io_uring batches, with an unterminated last line.
+    std::string text;
+    for (int i = 0; i < 150000; ++i)
+    {
+        text += "{\"id\":" + std::to_string(i % 1000) + ",\"pad\":\"" + std::string(static_cast<std::size_t>(i % 37), 'p') +
+                "\"}\n";
+    }
+    text += "{\"id\":7}";
+    tmp.writeAll(text);
+    const std::string file = tmp.path().string();
+
+    const auto mapped = runArgs({"jlq", file, "--path", "id", "--value", "7", "--type", "number"});
+    JLQ_CHECK_EQ(mapped.rc, 0);
+    JLQ_CHECK(mapped.out.ends_with("{\"id\":7}"));
+    for (const std::string backend : {"mmap", "pread", "io_uring"})
+    {
+        const auto r = runArgs({"jlq", file, "--path", "id", "--value", "7", "--type", "number", "--io", backend});
+        // Kernels (or sandboxes) without io_uring report an OS error.
+        if (backend == "io_uring" && r.rc == 2)
+        {
+            JLQ_CHECK(r.err.find("io_uring") != std::string::npos);
+            continue;
+        }
+        JLQ_CHECK_EQ(r.rc, 0);
+        JLQ_CHECK_EQ(r.out, mapped.out);
+    }
+
+    for (const std::string backend : {"mmap", "pread"})
+    {
+        const auto r = runArgs({"jlq", file, "--path", "id", "--value", "7", "--type", "number", "--io", backend,
+                                "--max-rss", "1M"});
+        JLQ_CHECK_EQ(r.out, mapped.out);
+    }
+
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "id", "--value", "7", "--io", "aio"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "id", "--value", "7", "--max-rss", "0"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "id", "--value", "7", "--max-rss", "12X"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", "-", "--path", "id", "--value", "7", "--io", "pread"}).rc, 1);
+}
+
+JLQ_TEST_CASE("CLI queries several files, directories and patterns in order")
+{
+    const auto dir = std::filesystem::temp_directory_path() / ("jlq_cli_files_" + std::to_string(::getpid()));
+    std::filesystem::create_directories(dir / "sub");
+    const auto write = [](const std::filesystem::path &path, std::string_view contents)
+    {
+        std::ofstream(path, std::ios::binary) << contents;
+    };
+    write(dir / "a.jsonl", "{\"k\":1}\n{\"k\":2}\n");
+    // No trailing newline: the next file's output must start on its own line.
+    write(dir / "b.jsonl", "{\"k\":1,\"f\":\"b\"}");
+    write(dir / "sub" / "c.jsonl", "{\"k\":1,\"f\":\"c\"}\n");
+    write(dir / "a.jsonl.jlqidx", "not an index");
+    const std::string a = (dir / "a.jsonl").string();
+    const std::string b = (dir / "b.jsonl").string();
+    const std::string c = (dir / "sub" / "c.jsonl").string();
+
+    const std::string all = "{\"k\":1}\n{\"k\":1,\"f\":\"b\"}\n{\"k\":1,\"f\":\"c\"}\n";
+    for (const std::string threads : {"1", "3"})
+    {
+        const auto files = runArgs({"jlq", a, b, c, "--path", "k", "--value", "1", "--type", "number", "--threads", threads});
+        JLQ_CHECK_EQ(files.rc, 0);
+        JLQ_CHECK_EQ(files.out, all);
+        // Directories list their files sorted, skipping sidecars.
+        JLQ_CHECK_EQ(runArgs({"jlq", dir.string(), "--path", "k", "--value", "1", "--type", "number", "--threads", threads}).out,
+                     all);
+    }
+    JLQ_CHECK_EQ(runArgs({"jlq", (dir / "*.jsonl").string(), "--path", "k", "--value", "1", "--type", "number"}).out,
+                 std::string("{\"k\":1}\n{\"k\":1,\"f\":\"b\"}\n"));
+
+    const auto named = runArgs({"jlq", a, c, "--path", "k", "--value", "1", "--type", "number", "--with-filename"});
+    JLQ_CHECK_EQ(named.out, a + ":{\"k\":1}\n" + c + ":{\"k\":1,\"f\":\"c\"}\n");
+    const auto counts = runArgs({"jlq", a, c, "--path", "k", "--value", "2", "--type", "number", "--with-filename", "--count"});
+    JLQ_CHECK_EQ(counts.out, a + ":1\n" + c + ":0\n");
+    JLQ_CHECK_EQ(runArgs({"jlq", a, b, c, "--path", "k", "--value", "1", "--type", "number", "--count"}).out,
+                 std::string("3\n"));
+    JLQ_CHECK_EQ(runArgs({"jlq", a, b, c, "--path", "k", "--value", "1", "--type", "number", "--max-count", "2"}).out,
+                 std::string("{\"k\":1}\n{\"k\":1,\"f\":\"b\"}\n"));
+
+    // A missing file fails after the output of the files before it.
+    const auto missing = runArgs({"jlq", a, a + ".missing", c, "--path", "k", "--value", "1", "--type", "number"});
+    JLQ_CHECK_EQ(missing.rc, 2);
+    JLQ_CHECK_EQ(missing.out, std::string("{\"k\":1}\n"));
+    JLQ_CHECK(missing.err.find(a + ".missing") != std::string::npos);
+    JLQ_CHECK_EQ(runArgs({"jlq", (dir / "*.none").string(), "--path", "k", "--value", "1"}).rc, 2);
+    JLQ_CHECK_EQ(runArgs({"jlq", a, "-", "--path", "k", "--value", "1"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", a, c, "--path", "k", "--value", "1", "--io", "pread"}).rc, 1);
+
+    std::filesystem::remove_all(dir);
+}
+
+JLQ_TEST_CASE("CLI --select prints the selected values of each match")
+{
+    jlq::test::TempFile tmp("jlq_cli_test_", ".jsonl");
+    tmp.writeAll("{\"k\":1,\"a\":{\"b\":\"x\\ty\"},\"c\":[{\"d\":2.50}]}\n"
+                 "{\"k\":2,\"a\":{\"b\":\"z\"}}\n"
+                 "{\"k\":1,\"a\":{\"b\": true },\"c\":[{\"d\":{\"e\": [1,\t2]}}]}\n");
+    const std::string file = tmp.path().string();
+
+    const std::string json = "{\"a.b\":\"x\\ty\",\"c.0.d\":2.50}\n"
+                             "{\"a.b\":true,\"c.0.d\":{\"e\": [1,\t2]}}\n";
+    const std::string tsv = "x\\ty\t2.50\n"
+                            "true\t{\"e\": [1, 2]}\n";
+    for (const std::string engine : {"line", "stream"})
+    {
+        for (const std::string threads : {"1", "2"})
+        {
+            const auto r = runArgs({"jlq", file, "--path", "k", "--value", "1", "--type", "number", "--select", "a.b,c.0.d",
+                                    "--engine", engine, "--threads", threads, "--ordered"});
+            JLQ_CHECK_EQ(r.rc, 0);
+            JLQ_CHECK_EQ(r.out, json);
+            JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "k", "--value", "1", "--type", "number", "--select", "a.b,c.0.d",
+                                  "--format", "tsv", "--engine", engine, "--threads", threads, "--ordered"})
+                             .out,
+                         tsv);
+        }
+    }
+
+    // Missing values print null, or an empty field.
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "k", "--value", "2", "--type", "number", "--select", "k,c.0.d"}).out,
+                 std::string("{\"k\":2,\"c.0.d\":null}\n"));
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "k", "--value", "2", "--type", "number", "--select", "c,k", "--format", "tsv"}).out,
+                 std::string("\t2\n"));
+
+    // --select shapes printed lines only.
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "k", "--value", "1", "--select", "k", "--count"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "k", "--value", "1", "--select", "k", "--quiet"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "k", "--value", "1", "--select", "k", "--distinct", "a"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "k", "--value", "1", "--select", "a,,k"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "k", "--value", "1", "--select", "k", "--format", "csv"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "k", "--value", "1", "--format", "tsv"}).rc, 1);
+}
+
+JLQ_TEST_CASE("CLI --group-by counts matches per value")
+{
+    jlq::test::TempFile tmp("jlq_cli_test_", ".jsonl");
+    tmp.writeAll("{\"k\":1,\"svc\":{\"name\":\"api\"}}\n"
+                 "{\"k\":1,\"svc\":{\"name\":\"db\"}}\n"
+                 "{\"k\":2,\"svc\":{\"name\":\"db\"}}\n"
+                 "{\"k\":1,\"svc\":{\"name\": \"api\" }}\n"
+                 "{\"k\":1}\n"
+                 "{\"k\":1,\"svc\":{\"name\":\"api\"}}\n");
+    const std::string file = tmp.path().string();
+
+    for (const std::string threads : {"1", "3"})
+    {
+        const auto r = runArgs({"jlq", file, "--path", "k", "--value", "1", "--type", "number", "--group-by", "svc.name",
+                                "--count", "--threads", threads});
+        JLQ_CHECK_EQ(r.rc, 0);
+        JLQ_CHECK_EQ(r.out, std::string("3\t\"api\"\n1\t\"db\"\n1\tnull\n"));
+    }
+    JLQ_CHECK_EQ(runArgs({"jlq", file, file, "--path", "k", "--value", "2", "--type", "number", "--group-by", "svc",
+                          "--count"})
+                     .out,
+                 std::string("2\t{\"name\":\"db\"}\n"));
+
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "k", "--value", "1", "--group-by", "svc.name"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "k", "--value", "1", "--group-by", "svc..name", "--count"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "k", "--value", "1", "--group-by", "svc", "--count", "--max-count", "1"}).rc,
+                 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "k", "--value", "1", "--group-by", "svc", "--count", "--with-filename"}).rc,
+                 1);
+}
+
+JLQ_TEST_CASE("CLI --distinct estimates the distinct values among matches")
+{
+    jlq::test::TempFile tmp("jlq_cli_test_", ".jsonl");
+    tmp.writeAll("{\"k\":1,\"u\":\"a\"}\n"
+                 "{\"k\":1,\"u\":\"b\"}\n"
+                 "{\"k\":2,\"u\":\"c\"}\n"
+                 "{\"k\":1,\"u\": \"a\" }\n"
+                 "{\"k\":1}\n"
+                 "{\"k\":1,\"u\":7}\n");
+    const std::string file = tmp.path().string();
+
+    for (const std::string threads : {"1", "3"})
+    {
+        const auto r = runArgs({"jlq", file, "--path", "k", "--value", "1", "--type", "number", "--distinct", "u",
+                                "--threads", threads});
+        JLQ_CHECK_EQ(r.rc, 0);
+        JLQ_CHECK_EQ(r.out, std::string("3\n"));
+    }
+    JLQ_CHECK_EQ(runArgs({"jlq", file, file, "--path", "k", "--value", "1", "--type", "number", "--distinct", "u",
+                          "--count"})
+                     .out,
+                 std::string("3\n"));
+
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "k", "--value", "1", "--distinct", "u", "--quiet"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "k", "--value", "1", "--distinct", "u", "--max-count", "1"}).rc, 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "k", "--value", "1", "--distinct", "u", "--group-by", "u", "--count"}).rc,
+                 1);
+    JLQ_CHECK_EQ(runArgs({"jlq", file, "--path", "k", "--value", "1", "--distinct", "u."}).rc, 1);
+}
@@ -1,18 +1,42 @@
+#include "TempFile.hpp"
 #include "test_harness.hpp"
 
+#include "BoundedQueue.hpp"
+#include "Decompressor.hpp"
+#include "FileSet.hpp"
+#include "HyperLogLog.hpp"
+#include "LineIndex.hpp"
 #include "LineScanner.hpp"
+#include "MappedFile.hpp"
+#include "OutputSink.hpp"
 #include "path.hpp"
 #include "Query.hpp"
+#include "ValueIndex.hpp"
+#include "ValueSet.hpp"
+#include "WindowReader.hpp"
+#include "ZoneMap.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <optional>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <vector>
 
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <zlib.h>
+#include <zstd.h>
+
 namespace
 {
     [[nodiscard]] std::span<const std::byte> asBytes(const std::string &s)
@@ -145,6 +169,53 @@ JLQ_TEST_CASE("LineScanner trims a single trailing CR for parsing")
     JLQ_CHECK(line.had_newline);
 }
 
+JLQ_TEST_CASE("LineScanner finds lines across 64-byte block boundaries")
+{
+    // Reference: the straightforward byte loop the SIMD scanner must agree with.
+    auto reference = [](const std::string &input)
+    {
+        std::vector<std::string> lines;
+        std::size_t begin = 0;
+        while (begin < input.size())
+        {
+            std::size_t end = input.find('\n', begin);
+            const bool nl = (end != std::string::npos);
+            end = nl ? end : input.size();
+            std::string raw = input.substr(begin, end - begin);
+            begin = nl ? end + 1 : end;
+            if (!raw.empty() && raw != "\r")
+            {
+                lines.push_back(raw + (nl ? "\n" : ""));
+            }
+        }
+        return lines;
+    };
+
+    std::string input;
+    for (std::size_t len = 0; len < 200; ++len)
+    {
+        input += std::string(len, static_cast<char>('a' + len % 26));
+        input += (len % 7 == 0) ? "\r\n" : "\n";
+    }
+    input += "tail-without-newline";
+
+    jlq::LineScanner scanner(asBytes(input));
+    std::vector<std::string> scanned;
+    std::vector<jlq::ScannedLine> batch(13);
+    for (std::size_t n = scanner.nextBatch(batch); n != 0; n = scanner.nextBatch(batch))
+    {
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            const auto &line = batch[i];
+            std::string raw(reinterpret_cast<const char *>(line.raw.data()), line.raw.size());
+            JLQ_CHECK(line.json.size() == line.raw.size() || raw.ends_with('\r'));
+            scanned.push_back(raw + (line.had_newline ? "\n" : ""));
+        }
+    }
+
+    JLQ_CHECK(scanned == reference(input));
+}
+
 JLQ_TEST_CASE("runQuery matches strings and preserves CRLF bytes")
 {
     const std::string input = "{\"a\":{\"b\":\"x\"}}\r\n{\"a\":{\"b\":\"y\"}}\n";
@@ -230,6 +301,31 @@ JLQ_TEST_CASE("runQuery strict mode fails fast on malformed JSON")
     JLQ_CHECK_EQ(out.str(), std::string(""));
 }
 
+JLQ_TEST_CASE("runQuery parses lines in place without reading into the next line")
+{
+    // Each first half would be valid JSON if the parser looked past its '\n'.
+    const std::string lines = "{\"a\":{\"b\":\"x\"\n}}\n{\"a\":{\"b\":12\n3}}\n{\"a\":{\"b\":\"x\"}}\n";
+    std::string buffer = lines + std::string(jlq::requiredInputPadding(), '\0');
+
+    jlq::QueryConfig cfg;
+    cfg.path_segments = jlq::parseDotPath("a.b");
+    cfg.value = std::string_view("x");
+
+    const jlq::QueryInput input{asBytes(buffer).first(lines.size()), jlq::requiredInputPadding()};
+    std::ostringstream out;
+    JLQ_CHECK_EQ(jlq::runQuery(input, cfg, out), jlq::QueryStatus::Ok);
+    JLQ_CHECK_EQ(out.str(), std::string("{\"a\":{\"b\":\"x\"}}\n"));
+
+    cfg.value = 123.0;
+    std::ostringstream numbers;
+    JLQ_CHECK_EQ(jlq::runQuery(input, cfg, numbers), jlq::QueryStatus::Ok);
+    JLQ_CHECK_EQ(numbers.str(), std::string(""));
+
+    cfg.strict = true;
+    std::ostringstream strict;
+    JLQ_CHECK_EQ(jlq::runQuery(input, cfg, strict), jlq::QueryStatus::ParseError);
+}
+
 JLQ_TEST_CASE("runQuery oversize line is skipped by default and errors in strict")
 {
     std::string big;
@@ -255,3 +351,1682 @@ JLQ_TEST_CASE("runQuery oversize line is skipped by default and errors in strict
         JLQ_CHECK_EQ(status, jlq::QueryStatus::ParseError);
     }
 }
+
+namespace
+{
+    // Large enough to be split into several chunks by the parallel scan.
+    [[nodiscard]] std::string makeNumberedInput(std::size_t lines)
+    {
+        std::string input;
+        for (std::size_t i = 0; i < lines; ++i)
+        {
+            input += "{\"n\":" + std::to_string(i) + ",\"a\":{\"b\":\"" + ((i % 3 == 0) ? "x" : "y") + "\"}}";
+            input += (i % 5 == 0) ? "\r\n" : "\n";
+        }
+        return input;
+    }
+} // namespace
+
+JLQ_TEST_CASE("runQuery with threads and --ordered matches the serial output")
+{
+    const std::string input = makeNumberedInput(50000);
+
+    jlq::QueryConfig cfg;
+    cfg.path_segments = jlq::parseDotPath("a.b");
+    cfg.value = std::string_view("x");
+
+    std::ostringstream serial;
+    JLQ_CHECK_EQ(jlq::runQuery(asBytes(input), cfg, serial), jlq::QueryStatus::Ok);
+
+    cfg.threads = 4;
+    cfg.ordered = true;
+    std::ostringstream parallel;
+    JLQ_CHECK_EQ(jlq::runQuery(asBytes(input), cfg, parallel), jlq::QueryStatus::Ok);
+    JLQ_CHECK_EQ(parallel.str(), serial.str());
+}
+
+JLQ_TEST_CASE("runQuery with threads emits every match once when unordered")
+{
+    const std::string input = makeNumberedInput(50000);
+
+    jlq::QueryConfig cfg;
+    cfg.path_segments = jlq::parseDotPath("a.b");
+    cfg.value = std::string_view("x");
+
+    std::ostringstream serial;
+    JLQ_CHECK_EQ(jlq::runQuery(asBytes(input), cfg, serial), jlq::QueryStatus::Ok);
+
+    cfg.threads = 3;
+    std::ostringstream parallel;
+    JLQ_CHECK_EQ(jlq::runQuery(asBytes(input), cfg, parallel), jlq::QueryStatus::Ok);
+
+    auto sortedLines = [](const std::string &text)
+    {
+        std::vector<std::string> lines;
+        std::istringstream in(text);
+        for (std::string l; std::getline(in, l);)
+        {
+            lines.push_back(l);
+        }
+        std::sort(lines.begin(), lines.end());
+        return lines;
+    };
+    JLQ_CHECK(sortedLines(parallel.str()) == sortedLines(serial.str()));
+}
+
+JLQ_TEST_CASE("runQuery with threads and --ordered stops at the first malformed line in strict mode")
+{
+    std::string input = makeNumberedInput(40000);
+    const std::size_t bad_at = input.size() / 2;
+    input.insert(input.find('\n', bad_at) + 1, "{\"a\":\n");
+
+    jlq::QueryConfig cfg;
+    cfg.strict = true;
+    cfg.path_segments = jlq::parseDotPath("a.b");
+    cfg.value = std::string_view("x");
+
+    std::ostringstream serial;
+    JLQ_CHECK_EQ(jlq::runQuery(asBytes(input), cfg, serial), jlq::QueryStatus::ParseError);
+
+    cfg.threads = 4;
+    cfg.ordered = true;
+    std::ostringstream parallel;
+    JLQ_CHECK_EQ(jlq::runQuery(asBytes(input), cfg, parallel), jlq::QueryStatus::ParseError);
+    JLQ_CHECK_EQ(parallel.str(), serial.str());
+    JLQ_CHECK(!serial.str().empty());
+}
+
+JLQ_TEST_CASE("BoundedQueue is FIFO and reports full and empty")
+{
+    jlq::BoundedQueue<int> queue(3);
+    JLQ_CHECK_EQ(queue.capacity(), static_cast<std::size_t>(4));
+
+    for (int i = 0; i < 4; ++i)
+    {
+        int v = i;
+        JLQ_CHECK(queue.tryPush(v));
+    }
+    int extra = 99;
+    JLQ_CHECK(!queue.tryPush(extra));
+    JLQ_CHECK_EQ(extra, 99);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        int v = -1;
+        JLQ_CHECK(queue.tryPop(v));
+        JLQ_CHECK_EQ(v, i);
+    }
+    int none = -1;
+    JLQ_CHECK(!queue.tryPop(none));
+}
+
+JLQ_TEST_CASE("BoundedQueue delivers every element once across producers and consumers")
+{
+    constexpr std::size_t producers = 3;
+    constexpr std::size_t consumers = 3;
+    constexpr std::size_t per_producer = 20000;
+
+    jlq::BoundedQueue<std::size_t> queue(64);
+    std::atomic<std::size_t> popped{0};
+    std::atomic<std::size_t> sum{0};
+    {
+        std::vector<std::jthread> threads;
+        for (std::size_t p = 0; p < producers; ++p)
+        {
+            threads.emplace_back([&queue, p]
+                                 {
+                for (std::size_t i = 0; i < per_producer; ++i)
+                {
+                    std::size_t v = p * per_producer + i + 1;
+                    while (!queue.tryPush(v))
+                    {
+                        std::this_thread::yield();
+                    }
+                } });
+        }
+        for (std::size_t c = 0; c < consumers; ++c)
+        {
+            threads.emplace_back([&]
+                                 {
+                while (popped.load() < producers * per_producer)
+                {
+                    std::size_t v = 0;
+                    if (queue.tryPop(v))
+                    {
+                        sum.fetch_add(v);
+                        popped.fetch_add(1);
+                    }
+                    else
+                    {
+                        std::this_thread::yield();
+                    }
+                } });
+        }
+    }
+
+    const std::size_t n = producers * per_producer;
+    JLQ_CHECK_EQ(popped.load(), n);
+    JLQ_CHECK_EQ(sum.load(), n * (n + 1) / 2);
+}
+
+JLQ_TEST_CASE("runQuery stream engine matches the line engine on irregular input")
+{
+    // Lines the stream must not attribute to a single document: malformed,
+    // several values per line, values spanning lines, blanks, scalars.
+    const std::vector<std::string> fragments = {
+        "{\"a\":{\"b\":\"x\"}}",
+        "  {\"a\":{\"b\":\"x\"}}  ",
+        "{\"a\":{\"b\":\"y\"}}\r",
+        "{\"a\":{\"b\":\"x\"}} {\"a\":{\"b\":\"x\"}}",
+        "{\"a\":{\"b\":\"x\"}}}",
+        "{\"a\":",
+        "{\"b\":\"x\"}}",
+        "[1,2",
+        "3]",
+        "   ",
+        "42",
+        "\"x\"",
+        "{bad}",
+        "{\"a\":{\"b\":\"\xff\"}}",
+        "{\"a\":{\"b\":\"x\"},\"c\":[1,{\"d\":null}]}",
+    };
+
+    std::uint32_t state = 12345;
+    auto nextRandom = [&state]
+    {
+        state = state * 1103515245U + 12345U;
+        return (state >> 16) & 0x7fffU;
+    };
+
+    for (int round = 0; round < 40; ++round)
+    {
+        std::string input;
+        const std::size_t lines = 1 + nextRandom() % 60;
+        for (std::size_t i = 0; i < lines; ++i)
+        {
+            input += fragments[nextRandom() % fragments.size()];
+            if (i + 1 < lines || nextRandom() % 2 == 0)
+            {
+                input += "\n";
+            }
+        }
+
+        for (const bool strict : {false, true})
+        {
+            jlq::QueryConfig cfg;
+            cfg.strict = strict;
+            cfg.path_segments = jlq::parseDotPath("a.b");
+            cfg.value = std::string_view("x");
+
+            std::ostringstream line_out;
+            const auto line_status = jlq::runQuery(asBytes(input), cfg, line_out);
+
+            cfg.engine = jlq::ParseEngine::Stream;
+            std::ostringstream stream_out;
+            const auto stream_status = jlq::runQuery(asBytes(input), cfg, stream_out);
+
+            JLQ_CHECK_EQ(stream_status, line_status);
+            JLQ_CHECK_EQ(stream_out.str(), line_out.str());
+        }
+    }
+}
+
+JLQ_TEST_CASE("StreamSink writes appended ranges in order")
+{
+    const std::string input = "abcdefghij";
+    const auto bytes = asBytes(input);
+
+    std::ostringstream out;
+    {
+        jlq::StreamSink sink(out);
+        sink.append(bytes.subspan(0, 2));
+        sink.append(bytes.subspan(2, 3)); // adjacent: merged
+        sink.append(bytes.subspan(8, 2));
+        sink.append(bytes.subspan(1, 0));
+        sink.append(bytes.subspan(5, 1));
+        JLQ_CHECK_EQ(out.str(), std::string());
+        sink.flush();
+    }
+    JLQ_CHECK_EQ(out.str(), std::string("abcdeijf"));
+}
+
+JLQ_TEST_CASE("FdSink writes small and zero-copy ranges to pipes and files")
+{
+    std::string contents;
+    for (std::size_t i = 0; contents.size() < 512 * 1024; ++i)
+    {
+        contents += "{\"id\":" + std::to_string(i) + "}\n";
+    }
+    jlq::test::TempFile source_file("jlq_sink_", ".jsonl");
+    source_file.writeAll(contents);
+    const jlq::MappedFile mf = jlq::MappedFile::openReadonly(source_file.path().string());
+    const auto bytes = mf.bytes();
+
+    // Small, adjacent, large (kernel copy) and overlapping ranges, in an order
+    // that is not the file order.
+    const std::vector<std::pair<std::size_t, std::size_t>> ranges = {
+        {0, 100}, {100, 200}, {300, 200000}, {50, 10}, {10000, 70000}, {bytes.size() - 5, 5}};
+    std::string expected;
+    for (const auto &[offset, length] : ranges)
+    {
+        expected.append(contents, offset, length);
+    }
+
+    auto writeRanges = [&](int fd)
+    {
+        jlq::FdSink sink(fd, jlq::ZeroCopySource{mf.fd(), bytes});
+        for (const auto &[offset, length] : ranges)
+        {
+            sink.append(bytes.subspan(offset, length));
+        }
+        sink.flush();
+    };
+
+    int pipe_fds[2] = {-1, -1};
+    JLQ_CHECK_EQ(::pipe(pipe_fds), 0);
+    std::string piped;
+    {
+        std::jthread reader([&]
+                            {
+            char buf[4096];
+            for (ssize_t n = ::read(pipe_fds[0], buf, sizeof(buf)); n > 0; n = ::read(pipe_fds[0], buf, sizeof(buf)))
+            {
+                piped.append(buf, static_cast<std::size_t>(n));
+            } });
+        writeRanges(pipe_fds[1]);
+        ::close(pipe_fds[1]);
+    }
+    ::close(pipe_fds[0]);
+    JLQ_CHECK(piped == expected);
+
+    jlq::test::TempFile out_file("jlq_sink_out_", ".jsonl");
+    const int out_fd = ::open(out_file.path().c_str(), O_WRONLY | O_TRUNC | O_CLOEXEC);
+    JLQ_CHECK(out_fd != -1);
+    writeRanges(out_fd);
+    ::close(out_fd);
+    const jlq::MappedFile written = jlq::MappedFile::openReadonly(out_file.path().string());
+    JLQ_CHECK(std::string(reinterpret_cast<const char *>(written.bytes().data()), written.size()) == expected);
+}
+
+JLQ_TEST_CASE("runQuery counts, caps and stops at the match limit")
+{
+    const std::string input = makeNumberedInput(50000);
+    const std::size_t total = (50000 + 2) / 3;
+
+    jlq::QueryConfig base;
+    base.path_segments = jlq::parseDotPath("a.b");
+    base.value = std::string_view("x");
+
+    std::ostringstream serial;
+    JLQ_CHECK_EQ(jlq::runQuery(asBytes(input), base, serial), jlq::QueryStatus::Ok);
+    std::string first_ten;
+    for (std::size_t pos = 0, n = 0; n < 10; ++n)
+    {
+        const std::size_t end = serial.str().find('\n', pos) + 1;
+        first_ten += serial.str().substr(pos, end - pos);
+        pos = end;
+    }
+
+    for (const std::size_t threads : {std::size_t{1}, std::size_t{4}})
+    {
+        for (const bool ordered : {false, true})
+        {
+            jlq::QueryConfig cfg = base;
+            cfg.threads = threads;
+            cfg.ordered = ordered;
+
+            auto run = [&](const jlq::QueryConfig &c, std::string &text)
+            {
+                std::ostringstream out;
+                jlq::StreamSink sink(out);
+                jlq::QueryStats stats;
+                JLQ_CHECK_EQ(jlq::runQuery(jlq::QueryInput{asBytes(input)}, c, sink, stats), jlq::QueryStatus::Ok);
+                text = out.str();
+                return stats.matches;
+            };
+            std::string text;
+
+            cfg.output = jlq::OutputMode::Count;
+            JLQ_CHECK_EQ(run(cfg, text), total);
+            JLQ_CHECK(text.empty());
+
+            cfg.max_count = 7;
+            JLQ_CHECK_EQ(run(cfg, text), std::size_t{7});
+
+            cfg.output = jlq::OutputMode::Lines;
+            cfg.max_count = 10;
+            JLQ_CHECK_EQ(run(cfg, text), std::size_t{10});
+            JLQ_CHECK_EQ(static_cast<std::size_t>(std::count(text.begin(), text.end(), '\n')), std::size_t{10});
+            if (threads == 1 || ordered)
+            {
+                JLQ_CHECK_EQ(text, first_ten);
+            }
+
+            cfg.max_count = 0;
+            JLQ_CHECK_EQ(run(cfg, text), std::size_t{0});
+            JLQ_CHECK(text.empty());
+
+            cfg.output = jlq::OutputMode::Quiet;
+            cfg.max_count.reset();
+            JLQ_CHECK_EQ(run(cfg, text), std::size_t{1});
+            JLQ_CHECK(text.empty());
+
+            cfg.value = std::string_view("z");
+            JLQ_CHECK_EQ(run(cfg, text), std::size_t{0});
+        }
+    }
+}
+
+JLQ_TEST_CASE("runQuery quiet mode in strict mode fails only on errors before the first match")
+{
+    jlq::QueryConfig cfg;
+    cfg.strict = true;
+    cfg.output = jlq::OutputMode::Quiet;
+    cfg.path_segments = jlq::parseDotPath("a");
+    cfg.value = std::string_view("x");
+
+    std::ostringstream out;
+    JLQ_CHECK_EQ(jlq::runQuery(asBytes(std::string("{\"a\":\"x\"}\n{bad\n")), cfg, out), jlq::QueryStatus::Ok);
+    JLQ_CHECK_EQ(jlq::runQuery(asBytes(std::string("{bad\n{\"a\":\"x\"}\n")), cfg, out), jlq::QueryStatus::ParseError);
+    JLQ_CHECK(out.str().empty());
+}
+
+namespace
+{
+    // Lines of varying length, with empty lines, CR-only lines and CRLF endings.
+    [[nodiscard]] std::string makeIrregularLines(std::size_t lines, bool trailing_newline)
+    {
+        std::string input;
+        for (std::size_t i = 0; i < lines; ++i)
+        {
+            switch (i % 7)
+            {
+            case 3:
+                break;
+            case 5:
+                input += "\r";
+                break;
+            default:
+                input += "{\"n\":" + std::to_string(i) + ",\"a\":{\"b\":\"" + ((i % 4 == 0) ? "x" : "y") + "\"}," +
+                         "\"pad\":\"" + std::string(i % 150, 'p') + "\"}" + ((i % 2 == 0) ? "\r" : "");
+                break;
+            }
+            if (i + 1 < lines || trailing_newline)
+            {
+                input += "\n";
+            }
+        }
+        return input;
+    }
+
+    [[nodiscard]] std::vector<jlq::ScannedLine> drain(auto &source)
+    {
+        std::vector<jlq::ScannedLine> all;
+        std::vector<jlq::ScannedLine> batch(37);
+        for (std::size_t n = source.nextBatch(batch); n != 0; n = source.nextBatch(batch))
+        {
+            all.insert(all.end(), batch.begin(), batch.begin() + static_cast<std::ptrdiff_t>(n));
+        }
+        return all;
+    }
+
+    [[nodiscard]] bool sameLines(const std::vector<jlq::ScannedLine> &a, const std::vector<jlq::ScannedLine> &b)
+    {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const auto &x, const auto &y)
+                          { return x.raw.data() == y.raw.data() && x.raw.size() == y.raw.size() &&
+                                   x.json.size() == y.json.size() && x.had_newline == y.had_newline &&
+                                   x.oversized == y.oversized; });
+    }
+} // namespace
+
+JLQ_TEST_CASE("LineIndex yields the same lines as LineScanner")
+{
+    for (const bool trailing_newline : {true, false})
+    {
+        const std::string input = makeIrregularLines(5000, trailing_newline);
+        const auto bytes = asBytes(input);
+        const jlq::FileStamp stamp{input.size(), 42};
+
+        jlq::test::TempFile tmp("jlq_index_", ".jlqidx");
+        jlq::LineIndex::write(tmp.path().string(), bytes, stamp);
+        const auto index = jlq::LineIndex::open(tmp.path().string(), stamp);
+        JLQ_CHECK(index.has_value());
+        JLQ_CHECK_EQ(index->lineCount(), std::size_t{5000});
+
+        jlq::LineScanner scanner(bytes);
+        const auto scanned = drain(scanner);
+        auto cursor = index->cursor(bytes);
+        JLQ_CHECK(sameLines(drain(cursor), scanned));
+
+        // Ranges split anywhere concatenate to the whole file.
+        std::vector<jlq::ScannedLine> pieces;
+        for (std::size_t first = 0; first < 5000; first += 777)
+        {
+            auto part = index->cursor(bytes, first, first + 777);
+            const auto lines = drain(part);
+            pieces.insert(pieces.end(), lines.begin(), lines.end());
+        }
+        JLQ_CHECK(sameLines(pieces, scanned));
+
+        // Jump to line N.
+        std::size_t offset = 0;
+        for (std::size_t line = 0; line < 2100; ++line)
+        {
+            if (line == 0 || line == 1023 || line == 1024 || line == 2099)
+            {
+                JLQ_CHECK_EQ(index->lineStart(line), static_cast<std::uint64_t>(offset));
+            }
+            offset = input.find('\n', offset) + 1;
+        }
+    }
+}
+
+JLQ_TEST_CASE("LineIndex rejects stale and damaged sidecars")
+{
+    const std::string input = makeIrregularLines(100, true);
+    const jlq::FileStamp stamp{input.size(), 42};
+    jlq::test::TempFile tmp("jlq_index_", ".jlqidx");
+    jlq::LineIndex::write(tmp.path().string(), asBytes(input), stamp);
+
+    JLQ_CHECK(jlq::LineIndex::open(tmp.path().string(), stamp).has_value());
+    JLQ_CHECK(!jlq::LineIndex::open(tmp.path().string(), jlq::FileStamp{input.size(), 43}).has_value());
+    JLQ_CHECK(!jlq::LineIndex::open(tmp.path().string(), jlq::FileStamp{input.size() + 1, 42}).has_value());
+    JLQ_CHECK(!jlq::LineIndex::open(tmp.path().string() + ".missing", stamp).has_value());
+
+    ::truncate(tmp.path().c_str(), 60);
+    JLQ_CHECK(!jlq::LineIndex::open(tmp.path().string(), stamp).has_value());
+}
+
+JLQ_TEST_CASE("runQuery with a line index matches the scanned result")
+{
+    const std::string input = makeIrregularLines(20000, false);
+    const jlq::FileStamp stamp{input.size(), 7};
+    jlq::test::TempFile tmp("jlq_index_", ".jlqidx");
+    jlq::LineIndex::write(tmp.path().string(), asBytes(input), stamp);
+    const auto index = jlq::LineIndex::open(tmp.path().string(), stamp);
+    JLQ_CHECK(index.has_value());
+
+    jlq::QueryConfig cfg;
+    cfg.path_segments = jlq::parseDotPath("a.b");
+    cfg.value = std::string_view("x");
+
+    std::ostringstream scanned;
+    JLQ_CHECK_EQ(jlq::runQuery(asBytes(input), cfg, scanned), jlq::QueryStatus::Ok);
+
+    for (const std::size_t threads : {std::size_t{1}, std::size_t{3}})
+    {
+        cfg.threads = threads;
+        cfg.ordered = true;
+        std::ostringstream indexed;
+        JLQ_CHECK_EQ(jlq::runQuery(jlq::QueryInput{asBytes(input), 0, &*index}, cfg, indexed), jlq::QueryStatus::Ok);
+        JLQ_CHECK_EQ(indexed.str(), scanned.str());
+    }
+}
+
+JLQ_TEST_CASE("runQuery over a mapping under a residency budget matches the plain scan")
+{
+    const std::string input = makeIrregularLines(20000, false);
+    jlq::test::TempFile tmp("jlq_resident_", ".jsonl");
+    tmp.writeAll(input);
+    const jlq::MappedFile mf = jlq::MappedFile::openReadonly(tmp.path().string(), jlq::requiredInputPadding());
+
+    jlq::QueryConfig cfg;
+    cfg.path_segments = jlq::parseDotPath("a.b");
+    cfg.value = std::string_view("x");
+
+    std::ostringstream scanned;
+    JLQ_CHECK_EQ(jlq::runQuery(asBytes(input), cfg, scanned), jlq::QueryStatus::Ok);
+
+    // Budgets far below the file size release pages the workers may still
+    // read; those fault back in.
+    for (const std::size_t budget : {std::size_t{0}, std::size_t{16} << 10, std::size_t{256} << 10})
+    {
+        for (const std::size_t threads : {std::size_t{1}, std::size_t{3}})
+        {
+            cfg.threads = threads;
+            cfg.ordered = true;
+            jlq::QueryInput in{mf.bytes(), mf.padding()};
+            in.file = &mf;
+            in.max_resident = budget;
+            std::ostringstream out;
+            JLQ_CHECK_EQ(jlq::runQuery(in, cfg, out), jlq::QueryStatus::Ok);
+            JLQ_CHECK_EQ(out.str(), scanned.str());
+        }
+    }
+}
+
+JLQ_TEST_CASE("runFiles over split and whole files matches the concatenated scan")
+{
+    // Large enough to be split into several chunks; the last line of the big
+    // file has no newline.
+    const std::string big = makeIrregularLines(120000, false);
+    const std::string small = makeIrregularLines(300, true);
+    jlq::test::TempFile big_file("jlq_files_", ".jsonl");
+    jlq::test::TempFile small_file("jlq_files_", ".jsonl");
+    big_file.writeAll(big);
+    small_file.writeAll(small);
+    const std::vector<std::string> paths{small_file.path().string(), big_file.path().string(),
+                                         small_file.path().string()};
+
+    jlq::QueryConfig cfg;
+    cfg.path_segments = jlq::parseDotPath("a.b");
+    cfg.value = std::string_view("x");
+
+    std::ostringstream expected;
+    for (const std::string *input : {&small, &big, &small})
+    {
+        std::ostringstream part;
+        JLQ_CHECK_EQ(jlq::runQuery(asBytes(*input), cfg, part), jlq::QueryStatus::Ok);
+        expected << part.str() << (part.str().ends_with('\n') ? "" : "\n");
+    }
+
+    for (const std::size_t threads : {std::size_t{1}, std::size_t{4}})
+    {
+        cfg.threads = threads;
+        std::ostringstream out;
+        jlq::StreamSink sink(out);
+        jlq::QueryStats stats;
+        JLQ_CHECK_EQ(jlq::runFiles(paths, cfg, jlq::FileSetOptions{}, sink, stats), jlq::QueryStatus::Ok);
+        const std::string text = out.str();
+        JLQ_CHECK_EQ(text, expected.str());
+        JLQ_CHECK_EQ(stats.matches, static_cast<std::size_t>(std::count(text.begin(), text.end(), '\n')));
+
+        // The cap applies across files.
+        cfg.max_count = stats.matches - 5;
+        std::ostringstream capped;
+        jlq::StreamSink capped_sink(capped);
+        JLQ_CHECK_EQ(jlq::runFiles(paths, cfg, jlq::FileSetOptions{}, capped_sink, stats), jlq::QueryStatus::Ok);
+        JLQ_CHECK_EQ(stats.matches, *cfg.max_count);
+        JLQ_CHECK(expected.str().starts_with(capped.str()));
+        cfg.max_count.reset();
+    }
+}
+
+JLQ_TEST_CASE("ValueIndex lookups return exactly the scanned matches")
+{
+    const std::vector<std::string> lines = {
+        R"({"a":{"b":"x"}})",
+        R"({"a":{"b":"x\u0041"}})",
+        R"({"a":{"b":"xA"},"c":1})",
+        R"({"a":{"b":1}})",
+        R"({"a":{"b":1.0}})",
+        R"({"a":{"b":1e0}})",
+        R"({"a":{"b":-0}})",
+        R"({"a":{"b":0}})",
+        R"({"a":{"b":true}})",
+        R"({"a":{"b":null}})",
+        R"({"a":{"b":[1]}})",
+        R"({"a":{"c":"x"}})",
+        R"({"a":{"b":123456789012345678901234567890}})",
+        R"({"a":{"b":tru}})",
+        R"([1,2])",
+        R"(42)",
+        R"({bad)",
+        "",
+        R"({"a":{"b":"x"}})",
+    };
+    std::string input;
+    for (const auto &line : lines)
+    {
+        input += line + "\n";
+    }
+    const jlq::FileStamp stamp{input.size(), 1};
+    const auto path = jlq::parseDotPath("a.b");
+
+    jlq::test::TempFile tmp("jlq_vindex_", ".jlqval");
+    jlq::ValueIndex::write(tmp.path().string(), asBytes(input), stamp, "a.b", path);
+    JLQ_CHECK(!jlq::ValueIndex::open(tmp.path().string(), stamp, "a.c").has_value());
+    JLQ_CHECK(!jlq::ValueIndex::open(tmp.path().string(), jlq::FileStamp{input.size(), 2}, "a.b").has_value());
+    const auto index = jlq::ValueIndex::open(tmp.path().string(), stamp, "a.b");
+    JLQ_CHECK(index.has_value());
+    JLQ_CHECK(index->irregularLines() > 0);
+
+    const std::vector<jlq::QueryValue> values = {
+        std::string_view("x"), std::string_view("xA"), std::string_view("y"), 1.0, 0.0, -0.0, 2.0, true, false,
+        std::monostate{}};
+    for (const auto &value : values)
+    {
+        for (const bool strict : {false, true})
+        {
+            jlq::QueryConfig cfg;
+            cfg.path_segments = path;
+            cfg.value = value;
+            cfg.strict = strict;
+
+            std::ostringstream scanned;
+            const auto scanned_status = jlq::runQuery(asBytes(input), cfg, scanned);
+            std::ostringstream looked_up;
+            const auto lookup_status = jlq::runQuery(jlq::QueryInput{asBytes(input), 0, nullptr, &*index}, cfg, looked_up);
+            JLQ_CHECK_EQ(lookup_status, scanned_status);
+            JLQ_CHECK_EQ(looked_up.str(), scanned.str());
+        }
+    }
+
+    jlq::QueryConfig cfg;
+    cfg.path_segments = path;
+    cfg.value = std::string_view("x");
+    JLQ_CHECK_EQ(index->candidates(cfg.value).size(), std::size_t{2});
+}
+
+JLQ_TEST_CASE("ZoneMap-pruned queries return exactly the scanned result")
+{
+    // Clustered values, so that most small blocks can be skipped, plus
+    // irregular lines that only strict queries must still reach.
+    std::string input;
+    for (int i = 0; i < 600; ++i)
+    {
+        if (i % 97 == 13)
+        {
+            input += R"({"a":{"b":tru}})" "\n";
+        }
+        else if (i % 150 == 0)
+        {
+            input += R"({"a":{"b":null},"c":"x\u0041"})" "\n";
+        }
+        else if (i < 200)
+        {
+            input += R"({"a":{"b":"s)" + std::to_string(i / 10) + R"("},"c":true})" "\n";
+        }
+        else if (i < 400)
+        {
+            input += R"({"a":{"b":)" + std::to_string(i) + R"(},"c":-0})" "\n";
+        }
+        else
+        {
+            input += R"({"a":{"b":)" + std::string(i % 3 == 0 ? "true" : "false") + "}}\n";
+        }
+    }
+    input += R"({"a":{"b":"s3"}})";
+    const jlq::FileStamp stamp{input.size(), 5};
+
+    jlq::test::TempFile tmp("jlq_zones_", ".jlqzone");
+    const std::string_view paths[] = {"c", "a.b"};
+    jlq::ZoneMap::write(tmp.path().string(), asBytes(input), stamp, paths, 256);
+    JLQ_CHECK(!jlq::ZoneMap::open(tmp.path().string(), jlq::FileStamp{input.size(), 6}).has_value());
+    const auto zones = jlq::ZoneMap::open(tmp.path().string(), stamp);
+    JLQ_CHECK(zones.has_value());
+    JLQ_CHECK(zones->blockCount() > 20);
+    JLQ_CHECK_EQ(zones->slotOf(jlq::parseDotPath("a.b")), std::optional<std::size_t>{1});
+    JLQ_CHECK(!zones->slotOf(jlq::parseDotPath("a")).has_value());
+
+    JLQ_CHECK(zones->candidateBlocks(asBytes(input), 1, std::string_view("s7"), false).size() <= 2);
+    JLQ_CHECK(zones->candidateBlocks(asBytes(input), 1, 250.0, false).size() == 1);
+
+    const std::vector<std::pair<std::string_view, jlq::QueryValue>> queries = {
+        {"a.b", std::string_view("s3")}, {"a.b", std::string_view("s99")}, {"a.b", 250.0}, {"a.b", 1000.0},
+        {"a.b", true}, {"a.b", false}, {"a.b", std::monostate{}}, {"c", std::string_view("xA")}, {"c", 0.0},
+        {"c", true}, {"d", std::string_view("s3")}};
+    for (const auto &[path, value] : queries)
+    {
+        for (const bool strict : {false, true})
+        {
+            for (const std::size_t threads : {std::size_t{1}, std::size_t{3}})
+            {
+                jlq::QueryConfig cfg;
+                cfg.path_segments = jlq::parseDotPath(path);
+                cfg.value = value;
+                cfg.strict = strict;
+                cfg.threads = threads;
+                cfg.ordered = true;
+
+                std::ostringstream scanned;
+                const auto scanned_status = jlq::runQuery(asBytes(input), cfg, scanned);
+                std::ostringstream pruned;
+                const auto pruned_status =
+                    jlq::runQuery(jlq::QueryInput{asBytes(input), 0, nullptr, nullptr, &*zones}, cfg, pruned);
+                JLQ_CHECK_EQ(pruned_status, scanned_status);
+                JLQ_CHECK_EQ(pruned.str(), scanned.str());
+            }
+        }
+    }
+}
+
+namespace
+{
+    enum class Outcome
+    {
+        Match,
+        NoMatch,
+        Malformed,
+    };
+
+    // Runs a strict query on a single line.
+    [[nodiscard]] Outcome outcomeOf(const std::string &line, const jlq::QueryConfig &cfg)
+    {
+        std::ostringstream out;
+        if (jlq::runQuery(asBytes(line), cfg, out) == jlq::QueryStatus::ParseError)
+        {
+            return Outcome::Malformed;
+        }
+        return out.str().empty() ? Outcome::NoMatch : Outcome::Match;
+    }
+} // namespace
+
+JLQ_TEST_CASE("runQuery filters combine predicates with three-valued logic")
+{
+    const std::vector<std::string> lines = {
+        R"({"s":500,"svc":"api","r":"eu","t":{"a":1,"b":[true,"x"]}})",
+        R"({"s":"500","svc":"api","r":"us","t":{"a":"1"}})",
+        R"({"s":200,"svc":"web","r":"eu","t":{"b":[false,"y"],"a":2}})",
+        R"({"s":500,"s":200,"svc":"web","r":null,"t":[]})",
+        R"({"s":500,"svc":"a\u0070i","r":"eu","t":{"a":1,"b":[tru,"x"]}})",
+        R"({"s":1e999,"svc":"api","t":{"a":1}})",
+        R"({"svc":"api","r":"eu","t":{"a":1,"b":[true,"x"]},"s":500})",
+        R"({"s":500,"svc":"api")",
+        R"([{"s":500}])",
+        R"("api")",
+    };
+    const std::vector<jlq::Predicate> predicates = {
+        {jlq::parseDotPath("s"), 500.0},
+        {jlq::parseDotPath("svc"), std::string_view("api")},
+        {jlq::parseDotPath("r"), std::monostate{}},
+        {jlq::parseDotPath("t.a"), 1.0},
+        {jlq::parseDotPath("t.b.0"), true},
+        {jlq::parseDotPath("t.b.1"), std::string_view("x")},
+    };
+
+    using Kind = jlq::FilterOp::Kind;
+    auto pred = [](std::size_t i)
+    { return jlq::FilterOp{Kind::Predicate, i}; };
+    const jlq::FilterOp and_op{Kind::And, 0};
+    const jlq::FilterOp or_op{Kind::Or, 0};
+    const jlq::FilterOp not_op{Kind::Not, 0};
+    const std::vector<std::vector<jlq::FilterOp>> programs = {
+        {pred(0)},
+        {pred(0), pred(1), and_op},
+        {pred(0), pred(1), and_op, pred(2), or_op},
+        {pred(3), pred(4), not_op, and_op, pred(5), and_op},
+        {pred(4), pred(5), or_op, not_op},
+        {pred(0), pred(3), and_op, pred(1), pred(2), not_op, and_op, or_op},
+    };
+
+    // Kleene logic over single-predicate outcomes.
+    auto combine = [](std::vector<Outcome> stack, const std::vector<jlq::FilterOp> &program)
+    {
+        std::vector<Outcome> work;
+        for (const auto &op : program)
+        {
+            if (op.kind == Kind::Predicate)
+            {
+                work.push_back(stack[op.predicate]);
+                continue;
+            }
+            if (op.kind == Kind::Not)
+            {
+                auto &top = work.back();
+                top = (top == Outcome::Match) ? Outcome::NoMatch : (top == Outcome::NoMatch) ? Outcome::Match : top;
+                continue;
+            }
+            const Outcome b = work.back();
+            work.pop_back();
+            Outcome &a = work.back();
+            const Outcome dominant = (op.kind == Kind::And) ? Outcome::NoMatch : Outcome::Match;
+            if (a == dominant || b == dominant)
+            {
+                a = dominant;
+            }
+            else if (a == Outcome::Malformed || b == Outcome::Malformed)
+            {
+                a = Outcome::Malformed;
+            }
+        }
+        return work.back();
+    };
+
+    std::string input;
+    for (const auto &line : lines)
+    {
+        std::vector<Outcome> single;
+        for (const auto &p : predicates)
+        {
+            jlq::QueryConfig cfg;
+            cfg.path_segments = p.path_segments;
+            cfg.value = p.value;
+            cfg.strict = true;
+            single.push_back(outcomeOf(line, cfg));
+        }
+
+        for (const auto &program : programs)
+        {
+            jlq::QueryConfig cfg;
+            cfg.strict = true;
+            cfg.filter = jlq::Filter{predicates, program};
+            JLQ_CHECK(outcomeOf(line, cfg) == combine(single, program));
+        }
+        input += line + "\n";
+    }
+
+    // Whole-file runs agree across engines and threads, with and without a
+    // --path predicate folded in.
+    for (const auto &program : programs)
+    {
+        for (const bool with_path : {false, true})
+        {
+            jlq::QueryConfig cfg;
+            cfg.filter = jlq::Filter{predicates, program};
+            if (with_path)
+            {
+                cfg.path_segments = jlq::parseDotPath("r");
+                cfg.value = std::string_view("eu");
+            }
+            std::ostringstream serial;
+            JLQ_CHECK_EQ(jlq::runQuery(asBytes(input), cfg, serial), jlq::QueryStatus::Ok);
+
+            cfg.engine = jlq::ParseEngine::Stream;
+            std::ostringstream streamed;
+            JLQ_CHECK_EQ(jlq::runQuery(asBytes(input), cfg, streamed), jlq::QueryStatus::Ok);
+            JLQ_CHECK_EQ(streamed.str(), serial.str());
+
+            cfg.threads = 3;
+            cfg.ordered = true;
+            std::ostringstream threaded;
+            JLQ_CHECK_EQ(jlq::runQuery(asBytes(input), cfg, threaded), jlq::QueryStatus::Ok);
+            JLQ_CHECK_EQ(threaded.str(), serial.str());
+        }
+    }
+}
+
+JLQ_TEST_CASE("runQuery numeric ranges compare integers exactly")
+{
+    const std::vector<std::string> lines = {
+        R"({"a":1})",
+        R"({"a":2})",
+        R"({"a":2.5})",
+        R"({"a":3})",
+        R"({"a":-0})",
+        R"({"a":1e2})",
+        R"({"a":9007199254740992})",
+        R"({"a":9007199254740993})",
+        R"({"a":18446744073709551616})",
+        R"({"a":"3"})",
+        R"({"a":true})",
+        R"({"a":null})",
+        R"({"b":3})",
+        R"({"a":-7})",
+        R"({"a":18446744073709551615})",
+    };
+    std::string input;
+    for (const auto &line : lines)
+    {
+        input += line + "\n";
+    }
+
+    using Bound = jlq::NumberRange::Bound;
+    using Integer = jlq::IntegerValue;
+    const std::vector<std::pair<jlq::NumberRange, std::vector<std::size_t>>> cases = {
+        {jlq::NumberRange::make(Bound{2, false}, std::nullopt), {2, 3, 5, 6, 7, 8, 14}},
+        {jlq::NumberRange::make(Bound{2, true}, Bound{3, false}), {1, 2}},
+        {jlq::NumberRange::make(Bound{-1, true}, Bound{1, true}), {0, 4}},
+        {jlq::NumberRange::make(std::nullopt, Bound{-0.5, false}), {13}},
+        {jlq::NumberRange::make(Bound{2.4, false}, Bound{2.5, true}), {2}},
+        // 2^53 + 1 is only distinguishable from 2^53 as an integer.
+        {jlq::NumberRange::make(Bound{9007199254740992.0, false}, std::nullopt), {7, 8, 14}},
+        // Ends written as integers are exact, although their doubles are not.
+        {jlq::NumberRange::make(Bound{9007199254740992.0, true, Integer{9007199254740993}}, std::nullopt), {7, 8, 14}},
+        {jlq::NumberRange::make(std::nullopt, Bound{9007199254740992.0, false, Integer{9007199254740993}}),
+         {0, 1, 2, 3, 4, 5, 6, 13}},
+        {jlq::NumberRange::make(Bound{9007199254740992.0, true, Integer{9007199254740993}},
+                                Bound{9007199254740992.0, true, Integer{9007199254740993}}),
+         {7}},
+        {jlq::NumberRange::make(Bound{9223372036854775808.0, false, Integer{9223372036854775807}}, std::nullopt),
+         {8, 14}},
+        {jlq::NumberRange::make(std::nullopt, Bound{18446744073709551616.0, false, Integer{0, 18446744073709551615U, true}}),
+         {0, 1, 2, 3, 4, 5, 6, 7, 13}},
+        {jlq::NumberRange::make(Bound{1e19, true}, std::nullopt), {8, 14}},
+        {jlq::NumberRange::make(Bound{4, false}, Bound{5, false}), {}},
+        {jlq::NumberRange::make(Bound{1e20, false}, std::nullopt), {}},
+    };
+
+    jlq::test::TempFile tmp("jlq_range_zones_", ".jlqzone");
+    const std::string_view paths[] = {"a"};
+    jlq::ZoneMap::write(tmp.path().string(), asBytes(input), jlq::FileStamp{input.size(), 1}, paths, 32);
+    const auto zones = jlq::ZoneMap::open(tmp.path().string(), jlq::FileStamp{input.size(), 1});
+    JLQ_CHECK(zones.has_value());
+    JLQ_CHECK(zones->candidateBlocks(asBytes(input), 0, cases.back().first, false).empty());
+
+    for (const auto &[range, expected_lines] : cases)
+    {
+        std::string expected;
+        for (const std::size_t i : expected_lines)
+        {
+            expected += lines[i] + "\n";
+        }
+
+        jlq::QueryConfig cfg;
+        cfg.path_segments = jlq::parseDotPath("a");
+        cfg.range = range;
+        std::ostringstream serial;
+        JLQ_CHECK_EQ(jlq::runQuery(asBytes(input), cfg, serial), jlq::QueryStatus::Ok);
+        JLQ_CHECK_EQ(serial.str(), expected);
+
+        cfg.threads = 3;
+        cfg.ordered = true;
+        cfg.engine = jlq::ParseEngine::Stream;
+        std::ostringstream threaded;
+        JLQ_CHECK_EQ(jlq::runQuery(asBytes(input), cfg, threaded), jlq::QueryStatus::Ok);
+        JLQ_CHECK_EQ(threaded.str(), expected);
+
+        std::ostringstream pruned;
+        JLQ_CHECK_EQ(jlq::runQuery(jlq::QueryInput{asBytes(input), 0, nullptr, nullptr, &*zones}, cfg, pruned),
+                     jlq::QueryStatus::Ok);
+        JLQ_CHECK_EQ(pruned.str(), expected);
+
+        // The same range as a --where condition, next to an equality on the
+        // same path.
+        jlq::QueryConfig where;
+        where.filter = jlq::Filter{{jlq::Predicate{jlq::parseDotPath("a"), std::monostate{}, range},
+                                    jlq::Predicate{jlq::parseDotPath("a"), 3.0}},
+                                   {jlq::FilterOp{jlq::FilterOp::Kind::Predicate, 0},
+                                    jlq::FilterOp{jlq::FilterOp::Kind::Predicate, 1},
+                                    jlq::FilterOp{jlq::FilterOp::Kind::Or, 0}}};
+        std::string expected_or;
+        for (std::size_t i = 0; i < lines.size(); ++i)
+        {
+            if (i == 3 || std::find(expected_lines.begin(), expected_lines.end(), i) != expected_lines.end())
+            {
+                expected_or += lines[i] + "\n";
+            }
+        }
+        std::ostringstream filtered;
+        JLQ_CHECK_EQ(jlq::runQuery(asBytes(input), where, filtered), jlq::QueryStatus::Ok);
+        JLQ_CHECK_EQ(filtered.str(), expected_or);
+    }
+
+    // A malformed number is an error for strict range queries.
+    jlq::QueryConfig cfg;
+    cfg.path_segments = jlq::parseDotPath("a");
+    cfg.range = jlq::NumberRange::make(Bound{0, true}, std::nullopt);
+    cfg.strict = true;
+    std::ostringstream out;
+    JLQ_CHECK_EQ(jlq::runQuery(asBytes(std::string(R"({"a":1e999})")), cfg, out), jlq::QueryStatus::ParseError);
+}
+
+JLQ_TEST_CASE("ValueSet holds distinct values under query equality")
+{
+    jlq::ValueSet set;
+    JLQ_CHECK(!set.contains(std::string_view("a")));
+    for (int i = 0; i < 1000; ++i)
+    {
+        set.insert(std::string_view("id" + std::to_string(i)));
+        set.insert(static_cast<double>(i));
+    }
+    set.insert(std::string_view("id7"));
+    set.insert(-0.0);
+    set.insert(true);
+    set.insert(std::monostate{});
+    JLQ_CHECK_EQ(set.size(), std::size_t{2002});
+
+    JLQ_CHECK(set.contains(std::string_view("id999")));
+    JLQ_CHECK(!set.contains(std::string_view("id1000")));
+    JLQ_CHECK(set.contains(0.0));
+    JLQ_CHECK(set.contains(-0.0));
+    JLQ_CHECK(set.contains(999.0));
+    JLQ_CHECK(!set.contains(0.5));
+    JLQ_CHECK(!set.contains(std::string_view("7")));
+    JLQ_CHECK(set.contains(true));
+    JLQ_CHECK(!set.contains(false));
+    JLQ_CHECK(set.contains(std::monostate{}));
+    JLQ_CHECK(!set.hasIntegers());
+
+    // Integers beyond 2^53 keep their exact value next to the shared double.
+    set.insert(9007199254740992.0, jlq::IntegerValue{9007199254740993});
+    set.insert(9007199254740992.0, jlq::IntegerValue{9007199254740993});
+    set.insert(18446744073709551616.0, jlq::IntegerValue{0, 18446744073709551615U, true});
+    JLQ_CHECK(set.hasIntegers());
+    JLQ_CHECK_EQ(set.size(), std::size_t{2004});
+    auto integer = [](std::int64_t value)
+    {
+        return jlq::NumberValue{static_cast<double>(value), jlq::IntegerValue{value}, true};
+    };
+    JLQ_CHECK(set.contains(integer(9007199254740993)));
+    JLQ_CHECK(!set.contains(integer(9007199254740992)));
+    // As a double, 9007199254740993.0 is 2^53.
+    JLQ_CHECK(!set.contains(jlq::NumberValue{9007199254740992.0}));
+    JLQ_CHECK(set.contains(jlq::NumberValue{18446744073709551616.0, jlq::IntegerValue{0, 18446744073709551615U, true}, true}));
+    JLQ_CHECK(!set.contains(jlq::NumberValue{18446744073709551616.0, jlq::IntegerValue{0, 18446744073709551614U, true}, true}));
+    JLQ_CHECK(set.contains(integer(999)));
+    JLQ_CHECK(!set.contains(integer(1000)));
+}
+
+JLQ_TEST_CASE("runQuery matches every path shape and value type")
+{
+    const std::string input = "{\"a\":{\"b\":{\"c\":{\"d\":{\"e\":\"s\"}}}},\"k\":[{\"n\":1}]}\n"
+                              "{\"a\":{\"b\":{\"c\":{\"d\":true}}},\"k\":[{\"n\":null}]}\n"
+                              "{\"a\":{\"b\":{\"c\":2.0}},\"k\":{\"0\":{\"n\":1}}}\n"
+                              "{\"a\":{\"b\":\"s\"},\"k\":[]}\n"
+                              "{\"a\":null}\n";
+    struct Case
+    {
+        const char *path;
+        jlq::QueryValue value;
+        std::size_t matches;
+    };
+    const Case cases[] = {
+        {"a", std::monostate{}, 1},
+        {"a.b", std::string_view("s"), 1},
+        {"a.b.c", 2.0, 1},
+        {"a.b.c.d", true, 1},
+        {"a.b.c.d", false, 0},
+        {"a.b.c.d.e", std::string_view("s"), 1},
+        {"k.0.n", 1.0, 1},
+        {"k.0.n", std::monostate{}, 1},
+    };
+    for (const Case &c : cases)
+    {
+        for (const auto engine : {jlq::ParseEngine::Line, jlq::ParseEngine::Stream})
+        {
+            jlq::QueryConfig cfg;
+            cfg.path_segments = jlq::parseDotPath(c.path);
+            cfg.value = c.value;
+            cfg.engine = engine;
+            cfg.output = jlq::OutputMode::Count;
+            std::ostringstream out;
+            jlq::StreamSink sink(out);
+            jlq::QueryStats stats;
+            JLQ_CHECK_EQ(jlq::runQuery(jlq::QueryInput{asBytes(input), 0}, cfg, sink, stats), jlq::QueryStatus::Ok);
+            JLQ_CHECK_EQ(stats.matches, c.matches);
+        }
+    }
+}
+
+JLQ_TEST_CASE("runQuery string matches do not depend on how the string is escaped")
+{
+    const std::string input = "{\"s\":\"x\"}\n"
+                              "{\"s\":\"\\u0078\" }\n"
+                              "{\"s\":\"xy\"}\n"
+                              "{\"s\":[\"x\"]}\n"
+                              "{\"s\":\"a\\\"b\\\\c\\n\"}\n"
+                              "{\"s\":\"a\\u0022b\\\\c\\u000A\"}\n"
+                              "{\"s\":\"a\\\"b\\\\c\"}\n"
+                              "{\"s\":\"a\\qb\"}\n";
+    struct Case
+    {
+        std::string_view value;
+        std::size_t matches;
+    };
+    const Case cases[] = {
+        {"x", 2},
+        {"xy", 1},
+        {"a\"b\\c\n", 2},
+        {"a\"b\\c", 1},
+    };
+    for (const Case &c : cases)
+    {
+        for (const bool where : {false, true})
+        {
+            jlq::QueryConfig cfg;
+            if (where)
+            {
+                jlq::Predicate predicate;
+                predicate.path_segments = jlq::parseDotPath("s");
+                predicate.value = c.value;
+                cfg.filter = jlq::Filter{{predicate}, {jlq::FilterOp{}}};
+            }
+            else
+            {
+                cfg.path_segments = jlq::parseDotPath("s");
+                cfg.value = c.value;
+            }
+            cfg.output = jlq::OutputMode::Count;
+            std::ostringstream out;
+            jlq::StreamSink sink(out);
+            jlq::QueryStats stats;
+            JLQ_CHECK_EQ(jlq::runQuery(jlq::QueryInput{asBytes(input), 0}, cfg, sink, stats), jlq::QueryStatus::Ok);
+            JLQ_CHECK_EQ(stats.matches, c.matches);
+
+            // The invalid escape on the last line is still an error.
+            cfg.strict = true;
+            JLQ_CHECK_EQ(jlq::runQuery(jlq::QueryInput{asBytes(input), 0}, cfg, sink, stats),
+                         jlq::QueryStatus::ParseError);
+        }
+    }
+}
+
+JLQ_TEST_CASE("runQuery counts matches per --group-by value across workers")
+{
+    // Every third line matches; "s" cycles through 7 values and is missing
+    // from every eleventh line.
+    std::string input;
+    std::vector<std::size_t> expected(8, 0);
+    for (std::size_t i = 0; i < 30000; ++i)
+    {
+        const bool match = (i % 3 == 0);
+        input += "{\"a\":\"" + std::string(match ? "x" : "y") + "\"";
+        if (i % 11 != 0)
+        {
+            input += ",\"s\": \"g" + std::to_string(i % 7) + "\" ";
+        }
+        input += "}\n";
+        if (match)
+        {
+            ++expected[(i % 11 != 0) ? i % 7 : 7];
+        }
+    }
+
+    jlq::QueryConfig base;
+    base.path_segments = jlq::parseDotPath("a");
+    base.value = std::string_view("x");
+    base.output = jlq::OutputMode::Count;
+    base.group_by = jlq::parseDotPath("s");
+
+    for (const std::size_t threads : {std::size_t{1}, std::size_t{4}})
+    {
+        for (const auto engine : {jlq::ParseEngine::Line, jlq::ParseEngine::Stream})
+        {
+            jlq::QueryConfig cfg = base;
+            cfg.threads = threads;
+            cfg.engine = engine;
+            std::ostringstream out;
+            jlq::StreamSink sink(out);
+            jlq::QueryStats stats;
+            JLQ_CHECK_EQ(jlq::runQuery(jlq::QueryInput{asBytes(input), 0}, cfg, sink, stats), jlq::QueryStatus::Ok);
+            JLQ_CHECK_EQ(stats.matches, std::size_t{10000});
+            JLQ_CHECK(out.str().empty());
+
+            const auto groups = stats.groups.sorted();
+            JLQ_CHECK_EQ(groups.size(), std::size_t{8});
+            std::size_t total = 0;
+            for (std::size_t i = 0; i < groups.size(); ++i)
+            {
+                const auto &[key, count] = groups[i];
+                const std::size_t g = (key == "null") ? 7 : static_cast<std::size_t>(key[2] - '0');
+                JLQ_CHECK_EQ(count, expected[g]);
+                JLQ_CHECK(i == 0 || groups[i - 1].second >= count);
+                total += count;
+            }
+            JLQ_CHECK_EQ(total, std::size_t{10000});
+        }
+    }
+}
+
+JLQ_TEST_CASE("runQuery --group-by counts lines the stream engine re-parses once")
+{
+    // Lines holding several values or spanning lines make the stream engine
+    // fall back to parsing a line it has already evaluated on its own.
+    const std::vector<std::string> fragments = {
+        "{\"a\":1,\"b\":\"x\"}",
+        "{\"a\":1,\"b\":\"y\"} {\"a\":1,\"b\":\"z\"}",
+        "{\"a\":1,\"b\":\"w\"}}",
+        "{\"a\":",
+        "1}",
+        "{\"a\":1}",
+        "{\"a\":2,\"b\":\"x\"}",
+    };
+    std::string input;
+    for (std::size_t i = 0; i < 20000; ++i)
+    {
+        input += fragments[(i * 7 + i / 5) % fragments.size()] + "\n";
+    }
+
+    jlq::QueryConfig base;
+    base.path_segments = jlq::parseDotPath("a");
+    base.value = 1.0;
+    base.output = jlq::OutputMode::Count;
+    base.group_by = jlq::parseDotPath("b");
+    base.distinct = jlq::parseDotPath("b");
+
+    auto run = [&](jlq::ParseEngine engine, std::size_t threads)
+    {
+        jlq::QueryConfig cfg = base;
+        cfg.engine = engine;
+        cfg.threads = threads;
+        std::ostringstream out;
+        jlq::StreamSink sink(out);
+        jlq::QueryStats stats;
+        JLQ_CHECK_EQ(jlq::runQuery(jlq::QueryInput{asBytes(input), 0}, cfg, sink, stats), jlq::QueryStatus::Ok);
+        return stats;
+    };
+
+    const jlq::QueryStats expected = run(jlq::ParseEngine::Line, 1);
+    JLQ_CHECK(expected.matches > 0);
+    for (const std::size_t threads : {std::size_t{1}, std::size_t{4}})
+    {
+        const jlq::QueryStats stats = run(jlq::ParseEngine::Stream, threads);
+        JLQ_CHECK_EQ(stats.matches, expected.matches);
+        JLQ_CHECK(stats.groups.sorted() == expected.groups.sorted());
+        JLQ_CHECK_EQ(stats.distinct.estimate(), expected.distinct.estimate());
+        std::size_t total = 0;
+        for (const auto &group : stats.groups.sorted())
+        {
+            total += group.second;
+        }
+        JLQ_CHECK_EQ(total, expected.matches);
+    }
+}
+
+JLQ_TEST_CASE("HyperLogLog estimates distinct counts and merges sketches")
+{
+    jlq::HyperLogLog empty;
+    JLQ_CHECK_EQ(empty.estimate(), std::uint64_t{0});
+
+    jlq::HyperLogLog small;
+    for (int repeat = 0; repeat < 3; ++repeat)
+    {
+        for (int i = 0; i < 10; ++i)
+        {
+            small.add("\"u" + std::to_string(i) + "\"");
+        }
+    }
+    JLQ_CHECK_EQ(small.estimate(), std::uint64_t{10});
+
+    // Two overlapping halves merge into the sketch of the whole.
+    jlq::HyperLogLog whole;
+    jlq::HyperLogLog first;
+    jlq::HyperLogLog second;
+    for (int i = 0; i < 200000; ++i)
+    {
+        const std::string value = std::to_string(i);
+        whole.add(value);
+        (i < 120000 ? first : second).add(value);
+        if (i >= 80000 && i < 120000)
+        {
+            second.add(value);
+        }
+    }
+    first.merge(second);
+    JLQ_CHECK_EQ(first.estimate(), whole.estimate());
+    const double error = std::abs(static_cast<double>(whole.estimate()) - 200000.0) / 200000.0;
+    JLQ_CHECK(error < 0.05);
+
+    jlq::HyperLogLog copy;
+    copy.merge(whole);
+    JLQ_CHECK_EQ(copy.estimate(), whole.estimate());
+}
+
+JLQ_TEST_CASE("runQuery with a value set matches the union of single-value queries")
+{
+    std::string input;
+    for (int i = 0; i < 400; ++i)
+    {
+        switch (i % 5)
+        {
+        case 0:
+            input += R"({"a":{"b":)" + std::to_string(i) + "}}\n";
+            break;
+        case 1:
+            input += R"({"a":{"b":"s)" + std::to_string(i) + R"("}})" "\n";
+            break;
+        case 2:
+            input += R"({"a":{"b":"\u0073)" + std::to_string(i - 1) + R"("},"c":1})" "\n";
+            break;
+        case 3:
+            input += (i % 3 == 0) ? R"({"a":{"b":null}})" "\n" : R"({"a":{"b":[1]}})" "\n";
+            break;
+        default:
+            input += (i == 99) ? R"({"a":{"b":tru}})" "\n" : R"({"a":{"b":false}})" "\n";
+            break;
+        }
+    }
+    const jlq::FileStamp stamp{input.size(), 3};
+    const auto path = jlq::parseDotPath("a.b");
+
+    jlq::test::TempFile vindex("jlq_set_vindex_", ".jlqval");
+    jlq::ValueIndex::write(vindex.path().string(), asBytes(input), stamp, "a.b", path);
+    const auto index = jlq::ValueIndex::open(vindex.path().string(), stamp, "a.b");
+    jlq::test::TempFile zindex("jlq_set_zones_", ".jlqzone");
+    const std::string_view zone_paths[] = {"a.b"};
+    jlq::ZoneMap::write(zindex.path().string(), asBytes(input), stamp, zone_paths, 256);
+    const auto zones = jlq::ZoneMap::open(zindex.path().string(), stamp);
+    JLQ_CHECK(index.has_value() && zones.has_value());
+
+    const std::vector<std::vector<jlq::QueryValue>> sets = {
+        {},
+        {std::string_view("s11"), 20.0, -0.0},
+        {std::string_view("s301"), std::string_view("s396"), 395.0, std::monostate{}},
+        {false, std::string_view("missing"), 1e9},
+    };
+    for (const auto &members : sets)
+    {
+        jlq::ValueSet set;
+        for (const auto &value : members)
+        {
+            set.insert(value);
+        }
+        for (const bool strict : {false, true})
+        {
+            jlq::QueryConfig cfg;
+            cfg.path_segments = path;
+            cfg.strict = strict;
+
+            // The expected output, in input order: lines matching any member.
+            std::string expected;
+            jlq::QueryStatus expected_status = jlq::QueryStatus::Ok;
+            {
+                jlq::QueryConfig all = cfg;
+                std::vector<std::string> matched;
+                std::size_t begin = 0;
+                while (begin < input.size())
+                {
+                    const std::size_t end = input.find('\n', begin) + 1;
+                    const std::string line = input.substr(begin, end - begin);
+                    for (const auto &value : members)
+                    {
+                        all.value = value;
+                        std::ostringstream one;
+                        if (jlq::runQuery(asBytes(line), all, one) == jlq::QueryStatus::ParseError)
+                        {
+                            expected_status = jlq::QueryStatus::ParseError;
+                        }
+                        if (!one.str().empty())
+                        {
+                            expected += one.str();
+                            break;
+                        }
+                    }
+                    if (strict && expected_status == jlq::QueryStatus::ParseError)
+                    {
+                        break;
+                    }
+                    begin = end;
+                }
+            }
+
+            cfg.values = &set;
+            std::ostringstream scanned;
+            const auto scanned_status = jlq::runQuery(asBytes(input), cfg, scanned);
+            JLQ_CHECK_EQ(scanned_status, expected_status);
+            JLQ_CHECK_EQ(scanned.str(), expected);
+
+            std::ostringstream looked_up;
+            JLQ_CHECK_EQ(jlq::runQuery(jlq::QueryInput{asBytes(input), 0, nullptr, &*index}, cfg, looked_up),
+                         scanned_status);
+            JLQ_CHECK_EQ(looked_up.str(), scanned.str());
+
+            cfg.threads = 3;
+            cfg.ordered = true;
+            cfg.engine = jlq::ParseEngine::Stream;
+            std::ostringstream pruned;
+            JLQ_CHECK_EQ(jlq::runQuery(jlq::QueryInput{asBytes(input), 0, nullptr, nullptr, &*zones}, cfg, pruned),
+                         scanned_status);
+            JLQ_CHECK_EQ(pruned.str(), scanned.str());
+
+            // Folded into a filter, the set is checked by the compiled plan.
+            jlq::QueryConfig filtered = cfg;
+            filtered.threads = 1;
+            filtered.filter = jlq::Filter{{jlq::Predicate{jlq::parseDotPath("c"), 1.0}},
+                                          {jlq::FilterOp{jlq::FilterOp::Kind::Predicate, 0},
+                                           jlq::FilterOp{jlq::FilterOp::Kind::Not, 0}}};
+            if (!strict)
+            {
+                std::ostringstream plan;
+                JLQ_CHECK_EQ(jlq::runQuery(asBytes(input), filtered, plan), jlq::QueryStatus::Ok);
+                std::string expected_plan;
+                std::size_t begin = 0;
+                while (begin < expected.size())
+                {
+                    const std::size_t end = expected.find('\n', begin) + 1;
+                    const std::string line = expected.substr(begin, end - begin);
+                    if (line.find("\"c\"") == std::string::npos)
+                    {
+                        expected_plan += line;
+                    }
+                    begin = end;
+                }
+                JLQ_CHECK_EQ(plan.str(), expected_plan);
+            }
+        }
+    }
+}
+
+namespace
+{
+    // Hands out its input in reads of 1 to 7 bytes.
+    class TrickleSource final : public jlq::ByteSource
+    {
+    public:
+        explicit TrickleSource(std::string bytes) : bytes_{std::move(bytes)} {}
+
+        std::size_t read(std::span<std::byte> out) override
+        {
+            const std::size_t n = std::min({out.size(), bytes_.size() - pos_, 1 + pos_ % 7});
+            std::memcpy(out.data(), bytes_.data() + pos_, n);
+            pos_ += n;
+            return n;
+        }
+
+    private:
+        std::string bytes_;
+        std::size_t pos_{0};
+    };
+
+    class FailingSource final : public jlq::ByteSource
+    {
+    public:
+        std::size_t read(std::span<std::byte>) override { throw std::runtime_error("read failed"); }
+    };
+
+    [[nodiscard]] std::string gzipCompress(const std::string &text)
+    {
+        z_stream zs{};
+        JLQ_CHECK_EQ(deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY), Z_OK);
+        std::string out(deflateBound(&zs, static_cast<uLong>(text.size())), '\0');
+        zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(text.data()));
+        zs.avail_in = static_cast<uInt>(text.size());
+        zs.next_out = reinterpret_cast<Bytef *>(out.data());
+        zs.avail_out = static_cast<uInt>(out.size());
+        JLQ_CHECK_EQ(deflate(&zs, Z_FINISH), Z_STREAM_END);
+        out.resize(zs.total_out);
+        deflateEnd(&zs);
+        return out;
+    }
+
+    [[nodiscard]] std::string zstdCompress(const std::string &text)
+    {
+        std::string out(ZSTD_compressBound(text.size()), '\0');
+        const std::size_t n = ZSTD_compress(out.data(), out.size(), text.data(), text.size(), 3);
+        JLQ_CHECK(ZSTD_isError(n) == 0);
+        out.resize(n);
+        return out;
+    }
+} // namespace
+
+JLQ_TEST_CASE("WindowReader cuts input into windows of whole lines")
+{
+    std::string input;
+    for (int i = 0; i < 300; ++i)
+    {
+        // Some lines are longer than a whole buffer.
+        input += R"({"i":)" + std::to_string(i) + R"(,"s":")" + std::string(static_cast<std::size_t>(i % 41), 'x') + "\"}\n";
+    }
+    input += R"({"i":"last"})";
+
+    for (const std::size_t buffer_bytes : {std::size_t{16}, std::size_t{100}, std::size_t{4096}})
+    {
+        TrickleSource source(input);
+        jlq::WindowReader reader(source, 32, buffer_bytes, 3);
+        std::string joined;
+        std::size_t windows = 0;
+        while (const auto window = reader.next())
+        {
+            JLQ_CHECK(!window->bytes.empty());
+            JLQ_CHECK(window->padding >= 32);
+            const std::string text(reinterpret_cast<const char *>(window->bytes.data()), window->bytes.size());
+            JLQ_CHECK(text.back() == '\n' || joined.size() + text.size() == input.size());
+            joined += text;
+            ++windows;
+        }
+        JLQ_CHECK_EQ(joined, input);
+        JLQ_CHECK(windows > 1);
+        JLQ_CHECK(!reader.next().has_value());
+    }
+
+    FailingSource failing;
+    jlq::WindowReader reader(failing, 0);
+    JLQ_CHECK([&]
+              {
+        try
+        {
+            static_cast<void>(reader.next());
+        }
+        catch (const std::runtime_error &)
+        {
+            return true;
+        }
+        return false; }());
+
+    // Abandoning a reader mid-input stops its thread.
+    TrickleSource endless(std::string(1 << 20, '\n'));
+    jlq::WindowReader abandoned(endless, 0, 64, 2);
+    JLQ_CHECK(abandoned.next().has_value());
+}
+
+JLQ_TEST_CASE("WindowReader bounds line length and hands out pipe input as it arrives")
+{
+    {
+        const std::string input = "short\n" + std::string(1000, 'x') + "\nafter\n" + std::string(500, 'y');
+        TrickleSource source(input);
+        jlq::WindowReader reader(source, 0, 16, 2, 100);
+        std::string joined;
+        while (const auto window = reader.next())
+        {
+            joined.append(reinterpret_cast<const char *>(window->bytes.data()), window->bytes.size());
+        }
+        // Overlong lines keep one byte past the limit, so they still read as oversized.
+        JLQ_CHECK_EQ(joined, "short\n" + std::string(101, 'x') + "\nafter\n" + std::string(101, 'y'));
+    }
+
+    int fds[2];
+    JLQ_CHECK_EQ(::pipe(fds), 0);
+    std::string rest;
+    for (int i = 0; i < 20000; ++i)
+    {
+        rest += R"({"i":)" + std::to_string(i) + "}\n";
+    }
+    std::atomic<bool> first_seen{false};
+    std::jthread writer([&]
+                        {
+        const auto writeAll = [&](const std::string &text)
+        {
+            for (std::size_t done = 0; done < text.size();)
+            {
+                const ssize_t n = ::write(fds[1], text.data() + done, text.size() - done);
+                JLQ_CHECK(n > 0);
+                done += static_cast<std::size_t>(n);
+            }
+        };
+        writeAll("first\n");
+        // The line is handed out before the buffer fills (or the writer gives up).
+        for (int waited = 0; !first_seen.load() && waited < 500; ++waited)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        writeAll(rest);
+        ::close(fds[1]); });
+
+    {
+        jlq::FdSource source(fds[0]);
+        jlq::WindowReader reader(source, 8);
+        const auto first = reader.next();
+        JLQ_CHECK(first.has_value());
+        JLQ_CHECK_EQ(std::string(reinterpret_cast<const char *>(first->bytes.data()), first->bytes.size()),
+                     std::string("first\n"));
+        first_seen = true;
+        std::string joined;
+        while (const auto window = reader.next())
+        {
+            joined.append(reinterpret_cast<const char *>(window->bytes.data()), window->bytes.size());
+        }
+        JLQ_CHECK_EQ(joined, rest);
+    }
+    writer.join();
+    ::close(fds[0]);
+
+    // Abandoning a reader waiting on an idle pipe does not wait for input.
+    JLQ_CHECK_EQ(::pipe(fds), 0);
+    {
+        jlq::FdSource source(fds[0]);
+        jlq::WindowReader reader(source, 0);
+    }
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+JLQ_TEST_CASE("runQuery over windows matches the query over the whole input")
+{
+    std::string input;
+    for (int i = 0; i < 500; ++i)
+    {
+        input += (i == 321) ? std::string(R"({"a":tru})") : R"({"a":)" + std::to_string(i % 10) + R"(,"pad":")" +
+                                                               std::string(static_cast<std::size_t>(i % 23), 'p') + "\"}";
+        input += (i % 50 == 0) ? "\r\n" : "\n";
+    }
+
+    jlq::QueryConfig base;
+    base.path_segments = jlq::parseDotPath("a");
+    base.value = 3.0;
+    std::vector<jlq::QueryConfig> configs(6, base);
+    configs[1].threads = 3;
+    configs[1].ordered = true;
+    configs[2].engine = jlq::ParseEngine::Stream;
+    configs[3].max_count = 7;
+    configs[4].strict = true;
+    configs[5].output = jlq::OutputMode::Count;
+    for (const auto &cfg : configs)
+    {
+        std::ostringstream whole;
+        jlq::StreamSink whole_sink(whole);
+        jlq::QueryStats whole_stats;
+        const auto whole_status = jlq::runQuery(jlq::QueryInput{asBytes(input)}, cfg, whole_sink, whole_stats);
+
+        TrickleSource source(input);
+        jlq::WindowReader reader(source, jlq::requiredInputPadding(), 256, 3);
+        std::ostringstream windowed;
+        jlq::StreamSink windowed_sink(windowed);
+        jlq::QueryStats windowed_stats;
+        const auto windowed_status = jlq::runQuery(reader, cfg, windowed_sink, windowed_stats);
+        windowed_sink.flush();
+
+        JLQ_CHECK_EQ(windowed_status, whole_status);
+        JLQ_CHECK_EQ(windowed_stats.matches, whole_stats.matches);
+        JLQ_CHECK_EQ(windowed.str(), whole.str());
+    }
+}
+
+JLQ_TEST_CASE("Decompressor streams gzip and zstd input, concatenated or not")
+{
+    std::string text;
+    for (int i = 0; i < 20000; ++i)
+    {
+        text += R"({"n":)" + std::to_string(i) + "}\n";
+    }
+    const std::string half_a = text.substr(0, text.size() / 3);
+    const std::string half_b = text.substr(text.size() / 3);
+
+    const std::vector<std::pair<std::string, jlq::Compression>> inputs = {
+        {gzipCompress(text), jlq::Compression::Gzip},
+        {gzipCompress(half_a) + gzipCompress(half_b), jlq::Compression::Gzip},
+        {zstdCompress(text), jlq::Compression::Zstd},
+        {zstdCompress(half_a) + zstdCompress(half_b), jlq::Compression::Zstd},
+    };
+    for (const auto &[compressed, compression] : inputs)
+    {
+        JLQ_CHECK(jlq::detectCompression(asBytes(compressed)) == compression);
+        jlq::Decompressor decompressor(asBytes(compressed), compression);
+        std::string out;
+        std::vector<std::byte> buffer(1000);
+        while (const std::size_t n = decompressor.read(buffer))
+        {
+            out.append(reinterpret_cast<const char *>(buffer.data()), n);
+        }
+        JLQ_CHECK_EQ(out, text);
+
+        // A truncated stream is an error, not a short read.
+        const std::string truncated = compressed.substr(0, compressed.size() / 2);
+        jlq::Decompressor partial(asBytes(truncated), compression);
+        JLQ_CHECK([&]
+                  {
+            try
+            {
+                while (partial.read(buffer) != 0)
+                {
+                }
+            }
+            catch (const std::runtime_error &)
+            {
+                return true;
+            }
+            return false; }());
+    }
+    JLQ_CHECK(jlq::detectCompression(asBytes(text)) == jlq::Compression::None);
+    JLQ_CHECK(jlq::detectCompression({}) == jlq::Compression::None);
+}
@@ -3,6 +3,9 @@
 #include "MappedFile.hpp"
 #include <cstddef>
 #include <string>
+#include <utility>
+
+#include <unistd.h>
 
 JLQ_TEST_CASE("MappedFile maps and exposes bytes")
 {
@@ -35,3 +38,28 @@ JLQ_TEST_CASE("MappedFile supports empty files")
     JLQ_CHECK(mf.empty());
     JLQ_CHECK_EQ(mf.bytes().size(), static_cast<std::size_t>(0));
 }
+
+JLQ_TEST_CASE("MappedFile guarantees zeroed padding after the file")
+{
+    const long page = ::sysconf(_SC_PAGESIZE);
+    JLQ_CHECK(page > 0);
+
+    // Exactly one page: no slack in the last file page, so padding must come
+    // from an extra zero page.
+    jlq::test::TempFile tmp("jlq_test_", ".txt");
+    tmp.writeAll(std::string(static_cast<std::size_t>(page), 'x'));
+
+    jlq::MappedFile mf = jlq::MappedFile::openReadonly(tmp.path().string(), 64);
+    JLQ_CHECK_EQ(mf.size(), static_cast<std::size_t>(page));
+    JLQ_CHECK(mf.padding() >= static_cast<std::size_t>(64));
+
+    const std::byte *end = mf.bytes().data() + mf.size();
+    for (std::size_t i = 0; i < mf.padding(); ++i)
+    {
+        JLQ_CHECK(end[i] == std::byte{0});
+    }
+
+    jlq::MappedFile moved = std::move(mf);
+    JLQ_CHECK_EQ(moved.size(), static_cast<std::size_t>(page));
+    JLQ_CHECK_EQ(mf.padding(), static_cast<std::size_t>(0));
+}
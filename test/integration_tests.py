@@ -126,6 +126,60 @@ def test_array_index_out_of_bounds_is_not_match(tmp_path: Path, jlq_bin: str | N
     assert result.returncode == 0
     assert result.stdout == ""
 
+def test_gzip_input_matches_plain_input(tmp_path: Path, jlq_bin: str | None) -> None:
+    """Gzip-compressed input (detected by magic bytes) gives the plain file's matches."""
+    import gzip
+
+    binary = jlq_bin or "./build/debug/bin/jlq"
+    jsonl_file = tmp_path / "plain.jsonl"
+    subprocess.run([
+        "python3", "scripts/gen_jsonl.py",
+        "--lines", "2000",
+        "--path", "user.id",
+        "--type", "number",
+        "--value", "42",
+        "--match-rate", "0.1",
+        "--crlf-rate", "0.1",
+        "--malformed-rate", "0.05",
+        "--out", str(jsonl_file)
+    ], check=True)
+    gz_file = tmp_path / "data.jsonl.gz"
+    gz_file.write_bytes(gzip.compress(jsonl_file.read_bytes()))
+
+    args = ["--path", "user.id", "--value", "42", "--type", "number"]
+    plain = run_jlq([str(jsonl_file)] + args, binary=binary)
+    compressed = run_jlq([str(gz_file)] + args + ["--threads", "2", "--ordered"], binary=binary)
+    assert plain.returncode == 0
+    assert compressed.returncode == 0
+    assert compressed.stdout == plain.stdout
+    assert len(plain.stdout.splitlines()) > 0
+
+def test_stdin_input_matches_file_input(tmp_path: Path, jlq_bin: str | None) -> None:
+    """JSONL piped to stdin (`-` or options only) gives the file's matches."""
+    binary = jlq_bin or "./build/debug/bin/jlq"
+    jsonl_file = tmp_path / "plain.jsonl"
+    subprocess.run([
+        "python3", "scripts/gen_jsonl.py",
+        "--lines", "2000",
+        "--path", "user.id",
+        "--type", "number",
+        "--value", "42",
+        "--match-rate", "0.1",
+        "--crlf-rate", "0.1",
+        "--malformed-rate", "0.05",
+        "--out", str(jsonl_file)
+    ], check=True)
+
+    args = ["--path", "user.id", "--value", "42", "--type", "number"]
+    plain = run_jlq([str(jsonl_file)] + args, binary=binary)
+    assert plain.returncode == 0
+    assert len(plain.stdout.splitlines()) > 0
+    for stdin_args in (["-"] + args + ["--threads", "2", "--ordered"], args):
+        with jsonl_file.open("rb") as stdin:
+            piped = subprocess.run([binary] + stdin_args, stdin=stdin, capture_output=True, text=True)
+        assert piped.returncode == 0
+        assert piped.stdout == plain.stdout
+
 def test_performance_smoke(tmp_path: Path, jlq_bin: str | None) -> None:
     """A smoke test for performance to ensure no major regressions."""
     # Use release binary if it exists, otherwise debug